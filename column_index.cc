@@ -0,0 +1,58 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+
+#include "column_index.h"
+#include <algorithm>
+#include <cassert>
+
+namespace {
+    /// @return true if c is the first byte of a UTF-8 character.
+    inline bool is_first_byte(char c)
+    {
+	return (static_cast<unsigned char>(c) & 0xC0) != 0x80;
+    }
+}
+
+column_index::column_index(const char *s, size_t len, unsigned tab_width, size_t interval) :
+    tab_width_(tab_width),
+    columns_(0),
+    characters_(0)
+{
+    assert(tab_width_ > 0);
+    checkpoint_.push_back(checkpoint { 0, 0 });
+    for(size_t i = 0; i < len; ++i) {
+	if (! is_first_byte(s[i])) {
+	    continue;
+	}
+	if (i >= checkpoint_.back().offset_ + interval) {
+	    checkpoint_.push_back(checkpoint { columns_, i });
+	}
+	columns_ += (s[i] == '\t') ? tab_width_ - columns_ % tab_width_ : 1;
+	++characters_;
+    }
+}
+
+size_t
+column_index::find(const char *s, size_t len, uint64_t col, uint64_t& start) const
+{
+    // the last checkpoint at or before col
+    auto cp = std::upper_bound(checkpoint_.begin(), checkpoint_.end(), col, [](uint64_t c, const checkpoint& p) { return c < p.column_; });
+    assert(cp != checkpoint_.begin());
+    --cp;
+    size_t i = cp->offset_;
+    uint64_t c = cp->column_;
+    while (i < len) {
+	const uint64_t w = (s[i] == '\t') ? tab_width_ - c % tab_width_ : 1;
+	if (c + w > col) {
+	    break;
+	}
+	c += w;
+	do {
+	    ++i;
+	} while (i < len && ! is_first_byte(s[i]));
+    }
+    start = c;
+    return i;
+}
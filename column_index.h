@@ -0,0 +1,59 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#pragma once
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * index of the screen columns of a UTF-8 encoded line.
+ *
+ * Every character occupies one column, a tab character advances to
+ * the next multiple of the tab width. The index records the column
+ * and byte offset of a character about every interval bytes, so the
+ * bytes displayed at a column of a very long line are found without
+ * decoding the line from its start.
+ */
+class column_index
+{
+public:
+    /// the character at byte offset_ starts at column_.
+    struct checkpoint
+    {
+	uint64_t column_;
+	size_t offset_;
+    };
+
+private:
+    unsigned tab_width_;
+    std::vector<checkpoint> checkpoint_;
+    uint64_t columns_;
+    size_t characters_;
+
+public:
+    /**
+     * index the line [s..s+len).
+     * @param interval minimum number of bytes between checkpoints.
+     */
+    column_index(const char *s, size_t len, unsigned tab_width, size_t interval = 4096);
+
+    /// @return the number of columns of the line.
+    uint64_t columns() const { return columns_; }
+
+    /// @return the number of characters of the line.
+    size_t characters() const { return characters_; }
+
+    /// @return the number of checkpoints.
+    size_t size() const { return checkpoint_.size(); }
+
+    /**
+     * find the character displayed at a column.
+     * @param s, len the indexed line.
+     * @param col a column.
+     * @param[out] start the column where the found character starts, at most col.
+     * @return the byte offset of the character that covers col; len if col is after the end of the line.
+     */
+    size_t find(const char *s, size_t len, uint64_t col, uint64_t& start) const;
+};
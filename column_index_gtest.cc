@@ -0,0 +1,70 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+
+#include "gtest/gtest.h"
+#include "column_index.h"
+#include <random>
+#include <string>
+
+TEST(column_index, empty)
+{
+    const std::string s;
+    column_index idx(s.data(), s.size(), 8);
+    ASSERT_EQ(0u, idx.columns());
+    ASSERT_EQ(0u, idx.characters());
+    uint64_t start = 99;
+    ASSERT_EQ(0u, idx.find(s.data(), s.size(), 0, start));
+    ASSERT_EQ(0u, start);
+    ASSERT_EQ(0u, idx.find(s.data(), s.size(), 10, start));
+}
+
+TEST(column_index, columns)
+{
+    // "a\tb\xC3\xA4c": a at 0, tab covers 1..3, b at 4, a-umlaut at 5, c at 6
+    const std::string s = "a\tb\xC3\xA4" "c";
+    column_index idx(s.data(), s.size(), 4);
+    ASSERT_EQ(7u, idx.columns());
+    ASSERT_EQ(5u, idx.characters());
+    uint64_t start;
+    ASSERT_EQ(0u, idx.find(s.data(), s.size(), 0, start));
+    ASSERT_EQ(0u, start);
+    ASSERT_EQ(1u, idx.find(s.data(), s.size(), 1, start));
+    ASSERT_EQ(1u, start);
+    ASSERT_EQ(1u, idx.find(s.data(), s.size(), 3, start));
+    ASSERT_EQ(1u, start);
+    ASSERT_EQ(2u, idx.find(s.data(), s.size(), 4, start));
+    ASSERT_EQ(4u, start);
+    ASSERT_EQ(3u, idx.find(s.data(), s.size(), 5, start));
+    ASSERT_EQ(5u, start);
+    ASSERT_EQ(5u, idx.find(s.data(), s.size(), 6, start));
+    ASSERT_EQ(6u, start);
+    ASSERT_EQ(6u, idx.find(s.data(), s.size(), 7, start));
+    ASSERT_EQ(7u, start);
+    ASSERT_EQ(6u, idx.find(s.data(), s.size(), 100, start));
+    ASSERT_EQ(7u, start);
+}
+
+TEST(column_index, checkpoints_find_the_same_offsets)
+{
+    std::mt19937 gen(1);
+    const char *chars[] = { "a", "\t", "\xC3\xA4", "\xE2\x82\xAC", "\xF0\x9F\x98\x80" };
+    std::string s;
+    while (s.size() < 100000) {
+	s += chars[gen() % 5];
+    }
+    column_index linear(s.data(), s.size(), 8, s.size() + 1);
+    column_index indexed(s.data(), s.size(), 8, 64);
+    ASSERT_EQ(1u, linear.size());
+    ASSERT_LT(1000u, indexed.size());
+    ASSERT_EQ(linear.columns(), indexed.columns());
+    ASSERT_EQ(linear.characters(), indexed.characters());
+    for(uint64_t col = 0; col <= linear.columns() + 1; col += 1 + gen() % 50) {
+	uint64_t start_linear, start_indexed;
+	const size_t i = linear.find(s.data(), s.size(), col, start_linear);
+	ASSERT_EQ(i, indexed.find(s.data(), s.size(), col, start_indexed));
+	ASSERT_EQ(start_linear, start_indexed);
+	ASSERT_LE(start_indexed, col);
+    }
+}
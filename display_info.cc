@@ -4,217 +4,241 @@
  */
 
 #include "display_info.h"
+#include "errno_str.h"
 #include "file_index.h"
 #include <algorithm>
 #include <cassert>
 #include <fstream>
 
 DisplayInfo::DisplayInfo() :
-    topLineIt(displayedLineNum.end()),
-    bottomLineIt(displayedLineNum.end())
+    displayedLineNum(std::make_shared<line_set_display>(line_set())),
+    displayGeneration(0),
+    topLine(0),
+    bottomLine(0)
 { }
 
 void
 DisplayInfo::go_to_approx(const line_number_t line_num)
 {
-    if (line_num == 0 || displayedLineNum.empty()) {
+    if (line_num == 0 || displayedLineNum->empty()) {
+	top();
+    } else if (! displayedLineNum->floor(line_num, topLine)) {
+	// line_num is before the first line
 	top();
-    } else {
-	topLineIt = std::lower_bound(displayedLineNum.begin(), displayedLineNum.end(), line_num);
-	if (topLineIt == displayedLineNum.begin()) {
-	    // do nothing
-	} else if (topLineIt == displayedLineNum.end()) {
-	    --topLineIt;
-	} else if (*topLineIt == line_num) {
-	    // do nothing
-	} else {
-	    --topLineIt;
-	}
     }
 }
 
 void
-DisplayInfo::assign(lineNum_vector_t&& v)
+DisplayInfo::assign(display_set::ptr_t s)
 {
-    unsigned old_line_num = 0;
-    if (topLineIt != displayedLineNum.end()) {
-	old_line_num = *topLineIt;
-    }
-
-    displayedLineNum = std::move(v);
-    topLineIt = bottomLineIt = displayedLineNum.begin();
+    assert(s);
+    const line_number_t old_line_num = topLine;
+    displayedLineNum = s;
+    ++displayGeneration;
+    topLine = bottomLine = displayedLineNum->first();
     go_to_approx(old_line_num);
 }
 
+void
+DisplayInfo::assign(line_set&& v)
+{
+    assign(std::make_shared<line_set_display>(std::move(v)));
+}
+
 bool
 DisplayInfo::start()
 {
-    bottomLineIt = topLineIt;
-    return bottomLineIt != displayedLineNum.end();
+    bottomLine = topLine;
+    return bottomLine != 0;
 }
 
 line_number_t
 DisplayInfo::current() const
 {
-    if (bottomLineIt == displayedLineNum.end()) {
-	return 0;
-    }
-    return *bottomLineIt;
+    return bottomLine;
 }
 
 bool
 DisplayInfo::next()
 {
-    if (isLastLineDisplayed()) {
+    if (bottomLine == 0) {
 	return false;
     }
-    ++bottomLineIt;
-    return true;
+    return displayedLineNum->next(bottomLine, bottomLine);
 }
 
 bool
 DisplayInfo::prev()
 {
-    if (bottomLineIt == displayedLineNum.begin()) {
+    if (bottomLine == 0) {
 	return false;
     }
-    --bottomLineIt;
-    return true;
+    return displayedLineNum->prev(bottomLine, bottomLine);
 }
 
 bool
 DisplayInfo::isFirstLineDisplayed() const
 {
-    return topLineIt == displayedLineNum.begin();
+    return topLine == displayedLineNum->first();
 }
 
 bool
 DisplayInfo::isLastLineDisplayed() const
 {
-    displayedLineNum_t::iterator i = bottomLineIt;
-    return ++i == displayedLineNum.end();
+    return bottomLine == displayedLineNum->last();
 }
 
 void
 DisplayInfo::down()
 {
-    auto it = topLineIt;
-    if (it == displayedLineNum.end()) {
+    if (topLine == 0) {
 	return;
     }
-    if (++it != displayedLineNum.end()) {
-	topLineIt = it;
-    }
+    displayedLineNum->next(topLine, topLine);
 }
 
 void
 DisplayInfo::up()
 {
-    if (topLineIt != displayedLineNum.begin()) {
-	--topLineIt;
-    }
+    displayedLineNum->prev(topLine, topLine);
 }
 
 void
 DisplayInfo::top()
 {
-    topLineIt = displayedLineNum.begin();
+    topLine = displayedLineNum->first();
 }
 
 void
 DisplayInfo::page_down()
 {
-    topLineIt = bottomLineIt;
+    topLine = bottomLine;
 }
 
 line_number_t
 DisplayInfo::bottomLineNum() const
 {
-    if (bottomLineIt == displayedLineNum.end()) {
-	return 0;
-    }
-    return *bottomLineIt;
+    return bottomLine;
 }
 
 std::string
 DisplayInfo::info() const
 {
-    return "top #" + std::to_string(*topLineIt) + " bottom #" + std::to_string(*bottomLineIt);
+    return "top #" + std::to_string(topLine) + " bottom #" + std::to_string(bottomLine);
 }
 
 line_number_t
 DisplayInfo::lastLineNum() const
 {
-    if (displayedLineNum.size() == 0) {
-	return 0;
-    }
-    return displayedLineNum[displayedLineNum.size() - 1];
+    return displayedLineNum->last();
 }
 
 bool
 DisplayInfo::go_to(const line_number_t lineNum)
 {
-    displayedLineNum_t::iterator i = std::find(displayedLineNum.begin(), displayedLineNum.end(), lineNum);
-    if (i == displayedLineNum.end()) {
+    line_number_t n;
+    if (! displayedLineNum->ceiling(lineNum, n) || n != lineNum) {
 	return false;
     }
-    bottomLineIt = topLineIt = i;
+    bottomLine = topLine = lineNum;
     return true;
 }
 
-void
+bool
 DisplayInfo::go_to_perc(unsigned p)
 {
-    if (p == 0) {
+    // counting the lines of a lazy intersection would block the caller
+    if (! has_counts()) {
+	return false;
+    }
+    const uint64_t s = displayedLineNum->size();
+    if (p == 0 || s == 0) {
 	top();
-	return;
+	return true;
     }
     if (p > 100) {
 	p = 100;
     }
-    go_to_approx(static_cast<uint64_t>(lastLineNum()) * static_cast<uint64_t>(p) / static_cast<uint64_t>(100u) + 1u);
+    uint64_t k = s * p / 100u;
+    if (k >= s) {
+	k = s - 1;
+    }
+    topLine = displayedLineNum->select(k);
+    return true;
 }
 
-line_number_t
-DisplayInfo::topLineNum() const
+uint64_t
+DisplayInfo::position(const line_number_t lineNum) const
 {
-    if (topLineIt == displayedLineNum.end()) {
+    return displayedLineNum->rank(lineNum);
+}
+
+unsigned
+DisplayInfo::perc(const line_number_t lineNum) const
+{
+    const uint64_t s = displayedLineNum->size();
+    if (s == 0) {
 	return 0;
     }
-    return *topLineIt;
+    return static_cast<unsigned>(position(lineNum) * 100u / s);
+}
+
+line_number_t
+DisplayInfo::topLineNum() const
+{
+    return topLine;
 }
 
 bool
-DisplayInfo::save(const std::string& filename, file_index& fi)
+display_snapshot::save(const std::string& filename, const file_index& fi, std::string *err) const
 {
     if (filename.empty()) {
+	if (err) {
+	    *err = "no file name";
+	}
 	return false;
     }
 
-    // if this object does not manage lines, create an empty file
-    if (displayedLineNum.empty()) {
+    // if the snapshot does not contain lines, create an empty file
+    if (lines_->empty()) {
 	std::ofstream os(filename);
 	if (! os) {
+	    if (err) {
+		*err = errno_str();
+	    }
 	    return false;
 	}
 	return true;
     }
 
-    assert(displayedLineNum.size() > 0);
+    assert(! lines_->empty());
 
-    // check that the last (highest) line number managed by this
-    // object is included in fi.
-    if (displayedLineNum[displayedLineNum.size()-1] >= fi.size()) {
+    // check that the last (highest) line number of the snapshot is
+    // included in fi.
+    if (lines_->last() > fi.size()) {
+	if (err) {
+	    *err = "the file has not been read completely";
+	}
 	return false;
     }
 
     std::ofstream os(filename);
     if (! os) {
+	if (err) {
+	    *err = errno_str();
+	}
 	return false;
     }
-    for(auto n : displayedLineNum) {
-	os << fi.line(n) << std::endl;
-    }
+    line_number_t n = lines_->first();
+    do {
+	os << fi.parsed_line(n) << std::endl;
+    } while (os && lines_->next(n, n));
 
+    if (! os) {
+	if (err) {
+	    *err = errno_str();
+	}
+	return false;
+    }
     return true;
 }
@@ -4,20 +4,49 @@
  */
 
 #pragma once
-#include "types.h"
+#include "display_set.h"
 #include <vector>
 #include <string>
 #include <memory>
 
 class file_index;
 
-class DisplayInfo
+/**
+ * an immutable snapshot of the displayed lines.
+ * Background jobs keep a snapshot while the UI thread assigns new
+ * lines to the DisplayInfo object, so the lines of a job never change.
+ */
+struct display_snapshot
 {
-    typedef lineNum_vector_t displayedLineNum_t;
+    /// the displayed line numbers, never nullptr.
+    display_set::ptr_t lines_;
+    /// the DisplayInfo::generation() of lines_.
+    unsigned generation_;
+
+    display_snapshot(display_set::ptr_t lines, unsigned generation) : lines_(lines), generation_(generation) {}
+
+    /**
+     * save the lines from fi to filename.
+     * This function can be called from a background thread.
+     * @param filename a file name. The file is created if it does not exist.
+     * @param fi the file index, all lines must be parsed.
+     * @param err if not nullptr it is set to the reason of a failure.
+     * @return true if filename could be created and all lines could be written;
+     *         false if a file error happened or fi does not contain all lines of the snapshot.
+     */
+    bool save(const std::string& filename, const file_index& fi, std::string *err = nullptr) const;
+};
 
-    displayedLineNum_t displayedLineNum;
-    displayedLineNum_t::iterator topLineIt;
-    displayedLineNum_t::iterator bottomLineIt;
+class DisplayInfo
+{
+    /// the displayed line numbers, never nullptr.
+    display_set::ptr_t displayedLineNum;
+    /// incremented whenever displayedLineNum is assigned.
+    unsigned displayGeneration;
+    /// line number of the top line on the display; 0 if nothing is displayed.
+    line_number_t topLine;
+    /// line number of the current/bottom line of an iteration; 0 if nothing is displayed.
+    line_number_t bottomLine;
 
 public:
 
@@ -25,10 +54,30 @@ public:
 
     DisplayInfo();
 
-    void assign(lineNum_vector_t&& v);
+    /**
+     * display the line numbers of s.
+     * If possible the display stays on the current top line, otherwise it moves to the previous line.
+     * @param s line numbers, must not be nullptr.
+     */
+    void assign(display_set::ptr_t s);
+
+    /// display a materialized set of line numbers.
+    void assign(line_set&& v);
+
+    /// @return the displayed line numbers.
+    display_set::ptr_t lines() const { return displayedLineNum; }
+
+    /// @return the generation of the displayed line numbers, which changes with every assign().
+    unsigned generation() const { return displayGeneration; }
+
+    /// @return the displayed line numbers for a background job.
+    display_snapshot snapshot() const { return display_snapshot(displayedLineNum, displayGeneration); }
 
     /// @return the number of lines managed by this object.
-    unsigned size() const { return displayedLineNum.size(); }
+    uint64_t size() const { return displayedLineNum->size(); }
+
+    /// @return true if size(), position() and perc() are available without computing all displayed lines.
+    bool has_counts() const { return displayedLineNum->has_counts(); }
 
     /**
      * start an iteration over the lines.
@@ -91,10 +140,21 @@ public:
     void go_to_approx(const line_number_t line_num);
 
     /**
-     * position the object onto a line number approximately p percent into the lines.
+     * position the object onto the line p percent into the displayed lines.
      * @param p percentage, between [0..100].
+     * @return false if the displayed lines are not counted yet, see has_counts(); then the position is not changed.
      */
-    void go_to_perc(unsigned p);
+    bool go_to_perc(unsigned p);
+
+    /**
+     * @param lineNum a line number.
+     * @return the position of lineNum in the displayed lines, the first line has position 1.
+     *         If lineNum is not displayed, the position of the previous displayed line; 0 if there is none.
+     */
+    uint64_t position(const line_number_t lineNum) const;
+
+    /// @return the percentage of the position of lineNum in the displayed lines, between [0..100].
+    unsigned perc(const line_number_t lineNum) const;
 
     /**
      * check if the first line is displayed.
@@ -140,5 +200,5 @@ public:
      * @return true if filename could be created and all lines could be written;
      *         false if a file error happened or fi does not contain all lines handled by this.
      */
-    bool save(const std::string& filename, file_index& fi);
+    bool save(const std::string& filename, const file_index& fi) const { return snapshot().save(filename, fi); }
 };
@@ -10,9 +10,9 @@
 #include "to_wide.h"
 
 namespace {
-    lineNum_vector_t s()
+    line_set s()
     {
-	lineNum_vector_t a;
+	line_set a;
 	for(unsigned i = 1; i <= 100; ++i) {
 	    a.push_back(i);
 	}
@@ -72,7 +72,7 @@ TEST(DisplayInfo, down_does_not_go_too_low2)
     DisplayInfo i; i.assign(s());
 
     // now set it to zero lines
-    lineNum_vector_t zero;
+    line_set zero;
     i.assign(std::move(zero));;
 
     ASSERT_FALSE(i.start());
@@ -129,7 +129,7 @@ TEST(DisplayInfo, stays_near_current_line_if_new_set_is_assigned)
     ASSERT_EQ(7u, i.current());
 
     // a set with only every 5th line
-    lineNum_vector_t a;
+    line_set a;
     for(unsigned i = 1; i <= 100; i += 5) {
 	a.push_back(i);
     }
@@ -180,7 +180,7 @@ TEST(DisplayInfo, save_with_invalid_file_index)
 {
     // create a DisplayInfo object with line number 1 million
     DisplayInfo i;
-    lineNum_vector_t a;
+    line_set a;
     a.push_back(100000);
     i.assign(std::move(a));
 
@@ -188,13 +188,16 @@ TEST(DisplayInfo, save_with_invalid_file_index)
 
     TemporaryFile tmp;
     ASSERT_FALSE(i.save(to_utf8(tmp.filename()), fi));
+    std::string err;
+    ASSERT_FALSE(i.snapshot().save(to_utf8(tmp.filename()), fi, &err));
+    ASSERT_EQ("the file has not been read completely", err);
 }
 
 TEST(DisplayInfo, save_with_2_lines)
 {
     // create a DisplayInfo object with the first 2 lines
     DisplayInfo i;
-    lineNum_vector_t a;
+    line_set a;
     a.push_back(1);
     a.push_back(2);
     i.assign(std::move(a));
@@ -209,3 +212,129 @@ TEST(DisplayInfo, save_with_2_lines)
     fi2.parse_all();
     ASSERT_EQ(2u, fi2.size());
 }
+
+TEST(DisplayInfo, save_all_lines_of_a_file)
+{
+    auto fi = std::make_shared<file_index>("README.md");
+    fi->parse_all();
+    DisplayInfo i;
+    i.assign(std::make_shared<identity_display>(fi));
+    ASSERT_EQ(fi->size(), i.size());
+
+    TemporaryFile tmp;
+    ASSERT_TRUE(i.save(to_utf8(tmp.filename()), *fi));
+
+    file_index fi2(to_utf8(tmp.filename()));
+    fi2.parse_all();
+    ASSERT_EQ(fi->size(), fi2.size());
+}
+
+TEST(DisplayInfo, snapshot_keeps_the_lines_of_its_generation)
+{
+    auto fi = std::make_shared<file_index>("README.md");
+    fi->parse_all();
+    DisplayInfo i;
+    const unsigned g = i.generation();
+    line_set a;
+    a.push_back(1);
+    a.push_back(2);
+    i.assign(std::move(a));
+    ASSERT_NE(g, i.generation());
+    const display_snapshot snap = i.snapshot();
+    ASSERT_EQ(i.generation(), snap.generation_);
+
+    // the UI assigns new lines while a background job uses the snapshot
+    i.assign(std::make_shared<identity_display>(fi));
+    ASSERT_NE(snap.generation_, i.generation());
+    ASSERT_EQ(2u, snap.lines_->size());
+
+    TemporaryFile tmp;
+    ASSERT_TRUE(snap.save(to_utf8(tmp.filename()), *fi));
+    file_index fi2(to_utf8(tmp.filename()));
+    fi2.parse_all();
+    ASSERT_EQ(2u, fi2.size());
+}
+
+TEST(DisplayInfo, navigate_identity_display)
+{
+    line_number_t size = 100;
+    DisplayInfo i;
+    i.assign(std::make_shared<identity_display>([&size]() { return size; }));
+    ASSERT_EQ(100u, i.size());
+    ASSERT_EQ(100u, i.lastLineNum());
+    ASSERT_TRUE(i.go_to(50));
+    ASSERT_FALSE(i.go_to(101));
+    i.up();
+    i.start();
+    ASSERT_EQ(49u, i.current());
+    ASSERT_TRUE(i.next());
+    ASSERT_EQ(50u, i.current());
+
+    // the display grows with the file
+    size = 200;
+    ASSERT_EQ(200u, i.lastLineNum());
+    ASSERT_TRUE(i.go_to(150));
+    i.go_to_perc(100);
+    ASSERT_EQ(200u, i.topLineNum());
+}
+
+TEST(DisplayInfo, percentages_use_positions_in_the_view)
+{
+    // 100 lines, most of them at the end of the file
+    line_set a;
+    a.push_back(1);
+    a.add_range(1000000, 1000098);
+    DisplayInfo i;
+    i.assign(std::move(a));
+
+    ASSERT_EQ(1u, i.position(1));
+    ASSERT_EQ(1u, i.position(999999));
+    ASSERT_EQ(2u, i.position(1000000));
+    ASSERT_EQ(100u, i.position(1000098));
+    ASSERT_EQ(1u, i.perc(1));
+    ASSERT_EQ(52u, i.perc(1000050));
+    ASSERT_EQ(100u, i.perc(1000098));
+
+    i.go_to_perc(50);
+    ASSERT_EQ(1000049u, i.topLineNum());
+    ASSERT_EQ(51u, i.perc(i.topLineNum()));
+    i.go_to_perc(1);
+    ASSERT_EQ(1000000u, i.topLineNum());
+    i.go_to_perc(0);
+    ASSERT_EQ(1u, i.topLineNum());
+    i.go_to_perc(200);
+    ASSERT_EQ(1000098u, i.topLineNum());
+}
+
+TEST(DisplayInfo, go_to_in_large_view)
+{
+    line_number_t size = 1000000000;
+    DisplayInfo i;
+    i.assign(std::make_shared<identity_display>([&size]() { return size; }));
+    ASSERT_TRUE(i.go_to(size));
+    ASSERT_EQ(size, i.topLineNum());
+    ASSERT_EQ(100u, i.perc(i.topLineNum()));
+    i.go_to_perc(50);
+    ASSERT_EQ(500000001u, i.topLineNum());
+}
+
+TEST(DisplayInfo, go_to_perc_waits_for_counts_of_an_intersection)
+{
+    auto a = std::make_shared<line_set>();
+    auto b = std::make_shared<line_set>();
+    for(unsigned u = 1; u <= 1000; ++u) {
+	a->push_back(u * 2);
+	b->push_back(u * 3);
+    }
+    DisplayInfo i;
+    i.assign(std::make_shared<intersection_display>(std::vector<intersection_display::set_ptr>{a, b}));
+    ASSERT_FALSE(i.has_counts());
+    ASSERT_FALSE(i.go_to_perc(50));
+    // the intersection was not counted on the caller's thread
+    ASSERT_FALSE(i.has_counts());
+    ASSERT_EQ(6u, i.topLineNum());
+
+    i.assign(line_set::intersect(std::vector<const line_set*>{a.get(), b.get()}));
+    ASSERT_TRUE(i.go_to_perc(50));
+    ASSERT_EQ(1002u, i.topLineNum());
+}
@@ -0,0 +1,194 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+
+#include "display_set.h"
+#include "file_index.h"
+#include "filter_engine.h"
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+bool
+display_set::next(value_type n, value_type& out) const
+{
+    if (n == std::numeric_limits<value_type>::max()) {
+	return false;
+    }
+    return ceiling(n + 1, out);
+}
+
+bool
+display_set::prev(value_type n, value_type& out) const
+{
+    if (n <= 1) {
+	return false;
+    }
+    return floor(n - 1, out);
+}
+
+line_set_display::line_set_display(std::shared_ptr<const line_set> s) :
+    s_(s)
+{ }
+
+line_set_display::line_set_display(line_set&& s) :
+    s_(std::make_shared<line_set>(std::move(s)))
+{ }
+
+std::string
+line_set_display::info() const
+{
+    return "line set " + memory_size_str(s_->memory_usage());
+}
+
+identity_display::identity_display(size_func_t size) :
+    size_(size)
+{ }
+
+identity_display::identity_display(std::shared_ptr<file_index> fi) :
+    size_([fi]() { return fi->size(); })
+{ }
+
+bool
+identity_display::ceiling(value_type n, value_type& out) const
+{
+    const value_type s = size_();
+    if (s == 0 || n > s) {
+	return false;
+    }
+    out = (n == 0) ? 1 : n;
+    return true;
+}
+
+bool
+identity_display::floor(value_type n, value_type& out) const
+{
+    const value_type s = size_();
+    if (n == 0 || s == 0) {
+	return false;
+    }
+    out = (n > s) ? s : n;
+    return true;
+}
+
+uint64_t
+identity_display::rank(value_type n) const
+{
+    const value_type s = size_();
+    return (n > s) ? s : n;
+}
+
+std::string
+identity_display::info() const
+{
+    return "all lines";
+}
+
+intersection_display::intersection_display(std::vector<set_ptr> sets) :
+    sets_(sets)
+{
+    assert(! sets_.empty());
+    // seeking into the smallest set first skips the most lines
+    std::sort(sets_.begin(), sets_.end(), [](const set_ptr& a, const set_ptr& b) { return a->size() < b->size(); });
+}
+
+const line_set&
+intersection_display::materialize() const
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (! full_) {
+	std::vector<const line_set*> v;
+	for(const auto& s : sets_) {
+	    v.push_back(s.get());
+	}
+	full_ = std::make_shared<line_set>(parallel_intersect(v));
+    }
+    return *full_;
+}
+
+bool
+intersection_display::has_counts() const
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    return full_ != nullptr;
+}
+
+bool
+intersection_display::ceiling(value_type n, value_type& out) const
+{
+    if (n == 0) {
+	n = 1;
+    }
+    // seek into the sets in turn until all of them include n
+    size_t agree = 0;
+    for(size_t i = 0; agree < sets_.size(); i = (i + 1) % sets_.size()) {
+	value_type c;
+	if (! sets_[i]->ceiling(n, c)) {
+	    return false;
+	}
+	if (c == n) {
+	    ++agree;
+	} else {
+	    n = c;
+	    agree = 1;
+	}
+    }
+    out = n;
+    return true;
+}
+
+bool
+intersection_display::floor(value_type n, value_type& out) const
+{
+    size_t agree = 0;
+    for(size_t i = 0; agree < sets_.size(); i = (i + 1) % sets_.size()) {
+	value_type c;
+	if (! sets_[i]->floor(n, c)) {
+	    return false;
+	}
+	if (c == n) {
+	    ++agree;
+	} else {
+	    n = c;
+	    agree = 1;
+	}
+    }
+    out = n;
+    return true;
+}
+
+display_set::value_type
+intersection_display::first() const
+{
+    value_type n;
+    return ceiling(1, n) ? n : 0;
+}
+
+display_set::value_type
+intersection_display::last() const
+{
+    value_type n;
+    return floor(std::numeric_limits<value_type>::max(), n) ? n : 0;
+}
+
+bool
+intersection_display::contains(value_type n) const
+{
+    for(const auto& s : sets_) {
+	if (! s->contains(n)) {
+	    return false;
+	}
+    }
+    return true;
+}
+
+std::string
+intersection_display::info() const
+{
+    std::string s = "intersection of " + std::to_string(sets_.size()) + " sets";
+    if (! has_counts()) {
+	s += ", not counted";
+    }
+    return s;
+}
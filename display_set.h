@@ -0,0 +1,181 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#pragma once
+#include "line_set.h"
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class file_index;
+
+/**
+ * an ordered set of line numbers which are displayed.
+ *
+ * DisplayInfo navigates through a display_set, which can be backed by
+ * different representations: the unfiltered file, the result of a
+ * single lines filter, or the intersection of several filters, either
+ * materialized or computed on demand. A display_set is immutable after construction and can be
+ * shared between threads; only the unfiltered file grows if the file
+ * index grows.
+ */
+class display_set
+{
+public:
+    typedef line_number_t value_type;
+    typedef std::shared_ptr<const display_set> ptr_t;
+
+    virtual ~display_set() {}
+
+    /// @return the number of line numbers in the set.
+    virtual uint64_t size() const = 0;
+
+    bool empty() const { return first() == 0; }
+
+    /// @return the smallest line number; 0 if the set is empty.
+    virtual value_type first() const = 0;
+
+    /// @return the largest line number; 0 if the set is empty.
+    virtual value_type last() const = 0;
+
+    /// @return true if n is included in the set.
+    virtual bool contains(value_type n) const = 0;
+
+    /**
+     * find the smallest line number >= n.
+     * @return true if such a line number exists and was stored in out.
+     */
+    virtual bool ceiling(value_type n, value_type& out) const = 0;
+
+    /**
+     * find the largest line number <= n.
+     * @return true if such a line number exists and was stored in out.
+     */
+    virtual bool floor(value_type n, value_type& out) const = 0;
+
+    /// @return the number of line numbers <= n.
+    virtual uint64_t rank(value_type n) const = 0;
+
+    /**
+     * @param k index into the set, must be < size().
+     * @return the k-th (starting at 0) smallest line number.
+     */
+    virtual value_type select(uint64_t k) const = 0;
+
+    /// find the smallest line number > n.
+    bool next(value_type n, value_type& out) const;
+
+    /// find the largest line number < n.
+    bool prev(value_type n, value_type& out) const;
+
+    /// @return a human readable description of the representation.
+    virtual std::string info() const = 0;
+
+    /**
+     * @return true if size(), rank() and select() are cheap;
+     *         false if they have to compute the complete set first.
+     */
+    virtual bool has_counts() const { return true; }
+};
+
+/**
+ * a display_set that references a line_set.
+ * The line_set is shared, a lines filter result is displayed without copying it.
+ */
+class line_set_display : public display_set
+{
+    std::shared_ptr<const line_set> s_;
+
+public:
+    /// @param s line set, must not be nullptr.
+    explicit line_set_display(std::shared_ptr<const line_set> s);
+
+    /// take ownership of a materialized line set.
+    explicit line_set_display(line_set&& s);
+
+    /// @return the referenced line set.
+    const line_set& lines() const { return *s_; }
+
+    virtual uint64_t size() const { return s_->size(); }
+    virtual value_type first() const { return s_->first(); }
+    virtual value_type last() const { return s_->last(); }
+    virtual bool contains(value_type n) const { return s_->contains(n); }
+    virtual bool ceiling(value_type n, value_type& out) const { return s_->ceiling(n, out); }
+    virtual bool floor(value_type n, value_type& out) const { return s_->floor(n, out); }
+    virtual uint64_t rank(value_type n) const { return s_->rank(n); }
+    virtual value_type select(uint64_t k) const { return s_->select(k); }
+    virtual std::string info() const;
+};
+
+/**
+ * all line numbers [1..size] of a file.
+ * No line numbers are stored; the set grows as the file index grows.
+ */
+class identity_display : public display_set
+{
+public:
+    typedef std::function<value_type()> size_func_t;
+
+private:
+    size_func_t size_;
+
+public:
+    /// @param size function that returns the current number of lines.
+    explicit identity_display(size_func_t size);
+
+    /// @param fi file index, must not be nullptr. The set contains all lines parsed by fi.
+    explicit identity_display(std::shared_ptr<file_index> fi);
+
+    virtual uint64_t size() const { return size_(); }
+    virtual value_type first() const { return size_() ? 1 : 0; }
+    virtual value_type last() const { return size_(); }
+    virtual bool contains(value_type n) const { return n >= 1 && n <= size_(); }
+    virtual bool ceiling(value_type n, value_type& out) const;
+    virtual bool floor(value_type n, value_type& out) const;
+    virtual uint64_t rank(value_type n) const;
+    virtual value_type select(uint64_t k) const { return static_cast<value_type>(k + 1); }
+    virtual std::string info() const;
+};
+
+/**
+ * the intersection of several line sets, computed on demand.
+ *
+ * Navigation seeks into each line set until all of them agree on a line
+ * number, so only the lines around the display are computed and the
+ * first screen is shown immediately, regardless of the size of the
+ * result. size(), rank() and select() need the complete intersection,
+ * which is computed by the first call and kept afterwards.
+ */
+class intersection_display : public display_set
+{
+public:
+    typedef std::shared_ptr<const line_set> set_ptr;
+
+private:
+    /// the line sets, the smallest set first.
+    std::vector<set_ptr> sets_;
+
+    mutable std::mutex mtx_;
+    /// the complete intersection, nullptr until it was needed.
+    mutable set_ptr full_;
+
+    /// @return the complete intersection.
+    const line_set& materialize() const;
+
+public:
+    /// @param sets line sets, must not be empty and must not contain nullptr.
+    explicit intersection_display(std::vector<set_ptr> sets);
+
+    virtual uint64_t size() const { return materialize().size(); }
+    virtual value_type first() const;
+    virtual value_type last() const;
+    virtual bool contains(value_type n) const;
+    virtual bool ceiling(value_type n, value_type& out) const;
+    virtual bool floor(value_type n, value_type& out) const;
+    virtual uint64_t rank(value_type n) const { return materialize().rank(n); }
+    virtual value_type select(uint64_t k) const { return materialize().select(k); }
+    virtual std::string info() const;
+    virtual bool has_counts() const;
+};
@@ -0,0 +1,116 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+
+#include "gtest/gtest.h"
+#include "display_set.h"
+
+TEST(display_set, identity_matches_range)
+{
+    for(line_number_t size : { 0u, 1u, 5u, 70000u }) {
+	identity_display a([size]() { return size; });
+	line_set_display b(size ? line_set::range(1, size) : line_set());
+	ASSERT_EQ(b.size(), a.size());
+	ASSERT_EQ(b.empty(), a.empty());
+	ASSERT_EQ(b.first(), a.first());
+	ASSERT_EQ(b.last(), a.last());
+	for(line_number_t n : { 0u, 1u, 2u, 4u, 5u, 6u, 65536u, 70000u, 70001u, 0xFFFFFFFFu }) {
+	    ASSERT_EQ(b.contains(n), a.contains(n));
+	    ASSERT_EQ(b.rank(n), a.rank(n));
+	    line_number_t ra = 0, rb = 0;
+	    ASSERT_EQ(b.ceiling(n, rb), a.ceiling(n, ra));
+	    ASSERT_EQ(rb, ra);
+	    ASSERT_EQ(b.floor(n, rb), a.floor(n, ra));
+	    ASSERT_EQ(rb, ra);
+	    ASSERT_EQ(b.next(n, rb), a.next(n, ra));
+	    ASSERT_EQ(rb, ra);
+	    ASSERT_EQ(b.prev(n, rb), a.prev(n, ra));
+	    ASSERT_EQ(rb, ra);
+	}
+	for(uint64_t k = 0; k < size; k += 997) {
+	    ASSERT_EQ(b.select(k), a.select(k));
+	}
+    }
+}
+
+TEST(display_set, identity_grows)
+{
+    line_number_t size = 10;
+    identity_display a([&size]() { return size; });
+    ASSERT_EQ(10u, a.last());
+    ASSERT_FALSE(a.contains(11));
+    size = 20;
+    ASSERT_EQ(20u, a.size());
+    ASSERT_TRUE(a.contains(11));
+}
+
+TEST(display_set, line_set_is_referenced)
+{
+    auto s = std::make_shared<line_set>();
+    s->push_back(3);
+    s->push_back(7);
+    line_set_display d(s);
+    ASSERT_EQ(&*s, &d.lines());
+    line_number_t n = 0;
+    ASSERT_TRUE(d.next(3, n));
+    ASSERT_EQ(7u, n);
+    ASSERT_FALSE(d.next(7, n));
+    ASSERT_TRUE(d.prev(7, n));
+    ASSERT_EQ(3u, n);
+    ASSERT_FALSE(d.prev(3, n));
+}
+
+#include <random>
+namespace {
+    /// create a line set with random line numbers. Every line number in [1..max] is included with probability p.
+    std::shared_ptr<const line_set> random_set(unsigned seed, line_number_t max, double p)
+    {
+	std::mt19937 gen(seed);
+	std::bernoulli_distribution d(p);
+	auto s = std::make_shared<line_set>();
+	for(line_number_t i = 1; i <= max; ++i) {
+	    if (d(gen)) {
+		s->push_back(i);
+	    }
+	}
+	return s;
+    }
+}
+
+TEST(display_set, intersection_matches_materialized_intersection)
+{
+    std::vector<std::vector<std::shared_ptr<const line_set>>> in = {
+	{ random_set(1, 200000, 0.5), random_set(2, 200000, 0.5) },
+	{ random_set(3, 200000, 0.01), random_set(4, 200000, 0.9), random_set(5, 200000, 0.3) },
+	{ random_set(6, 100, 0.1), random_set(7, 200000, 0.1) },
+	{ random_set(8, 1000, 0.5), std::make_shared<line_set>(line_set::range(2000, 3000)) },
+    };
+    for(const auto& sets : in) {
+	std::vector<const line_set*> v;
+	for(const auto& s : sets) {
+	    v.push_back(s.get());
+	}
+	line_set_display b(line_set::intersect(v));
+	intersection_display a(sets);
+	ASSERT_EQ(b.empty(), a.empty());
+	ASSERT_EQ(b.first(), a.first());
+	ASSERT_EQ(b.last(), a.last());
+	for(line_number_t n = 0; n < 200010; n += 7) {
+	    ASSERT_EQ(b.contains(n), a.contains(n));
+	    line_number_t ra = 0, rb = 0;
+	    ASSERT_EQ(b.next(n, rb), a.next(n, ra));
+	    ASSERT_EQ(rb, ra);
+	    ASSERT_EQ(b.prev(n, rb), a.prev(n, ra));
+	    ASSERT_EQ(rb, ra);
+	}
+	// navigation does not compute the complete intersection
+	ASSERT_FALSE(a.has_counts());
+	ASSERT_EQ(b.size(), a.size());
+	ASSERT_TRUE(a.has_counts());
+	for(uint64_t k = 0; k < b.size(); k += 101) {
+	    ASSERT_EQ(b.select(k), a.select(k));
+	    ASSERT_EQ(b.rank(b.select(k)), a.rank(b.select(k)));
+	}
+    }
+}
@@ -3,23 +3,104 @@
  * :indentSize=4:tabSize=8:
  */
 #include "event.h"
-#include <mutex>
+#include <atomic>
 #include <deque>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#define EVENT_PIPE 1
+#endif
 
 namespace {
-    std::mutex lock_;
+    struct node
+    {
+	event e_;
+	node *next_;
+	explicit node(const event& e) : e_(e), next_(nullptr) {}
+    };
+
+    /// the events added by the producers, the most recent event first.
+    std::atomic<node*> added_(nullptr);
+
+    /// the events taken by the consumer, the oldest event first.
     std::deque<event> q_;
+
+#if EVENT_PIPE
+    /**
+     * a pipe that is readable after events were added to an empty added_ list.
+     */
+    class wakeup_pipe
+    {
+	int fd_[2];
+    public:
+	wakeup_pipe()
+	{
+	    if (pipe(fd_) < 0) {
+		fd_[0] = fd_[1] = -1;
+		return;
+	    }
+	    for(int fd : fd_) {
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+		fcntl(fd, F_SETFD, FD_CLOEXEC);
+	    }
+	}
+	int fd() const { return fd_[0]; }
+	// the byte only wakes up poll(), errors are ignored
+	void set()
+	{
+	    if (fd_[1] >= 0) {
+		const char c = 0;
+		if (write(fd_[1], &c, 1)) {}
+	    }
+	}
+	void clear()
+	{
+	    char buf[64];
+	    while(fd_[0] >= 0 && read(fd_[0], buf, sizeof(buf)) > 0) {}
+	}
+    };
+
+    wakeup_pipe wakeup_;
+#endif
+
+    /// move the added events to q_.
+    void take()
+    {
+#if EVENT_PIPE
+	// clear the pipe first, a producer that adds an event after exchange() sets it again
+	wakeup_.clear();
+#endif
+	node *n = added_.exchange(nullptr, std::memory_order_acquire);
+	// reverse the list to the order the events were added
+	node *oldest = nullptr;
+	while(n) {
+	    node *next = n->next_;
+	    n->next_ = oldest;
+	    oldest = n;
+	    n = next;
+	}
+	while(oldest) {
+	    q_.push_back(oldest->e_);
+	    node *next = oldest->next_;
+	    delete oldest;
+	    oldest = next;
+	}
+    }
 }
 
 bool eventPending()
 {
-    std::lock_guard<std::mutex> _(lock_);
+    if (q_.empty()) {
+	take();
+    }
     return ! q_.empty();
 }
 
 event eventGet()
 {
-    std::lock_guard<std::mutex> _(lock_);
+    if (q_.empty()) {
+	take();
+    }
     if (q_.empty()) {
 	throw std::runtime_error("eventGet(): empty q_");
     }
@@ -30,6 +111,23 @@ event eventGet()
 
 void eventAdd(const event& e)
 {
-    std::lock_guard<std::mutex> _(lock_);
-    q_.push_back(e);
+    node *n = new node(e);
+    node *head = added_.load(std::memory_order_relaxed);
+    do {
+	n->next_ = head;
+    } while(! added_.compare_exchange_weak(head, n, std::memory_order_release, std::memory_order_relaxed));
+#if EVENT_PIPE
+    if (! head) {
+	wakeup_.set();
+    }
+#endif
+}
+
+int eventFd()
+{
+#if EVENT_PIPE
+    return wakeup_.fd();
+#else
+    return -1;
+#endif
 }
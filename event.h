@@ -5,6 +5,8 @@
 
 #pragma once
 #include "regex_index.h"
+#include "display_set.h"
+#include "word_set.h"
 
 struct event
 {
@@ -17,15 +19,32 @@ struct event
     /// the index into the regex vector for ri_
     const unsigned ri_idx_;
 
-    explicit event(const std::string& i) : info_(i), ri_idx_(0) {}
-    explicit event(std::shared_ptr<regex_index> ri, const unsigned idx) : ri_(ri), ri_idx_(idx) {}
+    /// the lines to display, computed by a background intersection
+    display_set::ptr_t lines_;
+
+    /// the generation of the background intersection that computed lines_
+    const unsigned lines_gen_;
+
+    /// the vocabulary of the whole file, counted in the background
+    std::shared_ptr<const word_table> vocabulary_;
+
+    explicit event(const std::string& i) : info_(i), ri_idx_(0), lines_gen_(0) {}
+    explicit event(std::shared_ptr<regex_index> ri, const unsigned idx) : ri_(ri), ri_idx_(idx), lines_gen_(0) {}
+    explicit event(display_set::ptr_t lines, const unsigned gen) : ri_idx_(0), lines_(lines), lines_gen_(gen) {}
+    explicit event(std::shared_ptr<const word_table> v) : ri_idx_(0), lines_gen_(0), vocabulary_(v) {}
 
     bool operator== (const event& r) const
     {
-	return info_ == r.info_ && ri_ == r.ri_ && ri_idx_ == r.ri_idx_;
+	return info_ == r.info_ && ri_ == r.ri_ && ri_idx_ == r.ri_idx_ && lines_ == r.lines_ && lines_gen_ == r.lines_gen_ && vocabulary_ == r.vocabulary_;
     }
 };
 
+/*
+ * Any thread can add events. Only a single thread, the UI thread, may
+ * call eventPending() and eventGet(). Adding an event does not take a
+ * lock.
+ */
+
 /// @return true if an event is scheduled for delivery
 bool eventPending();
 /**
@@ -35,3 +54,10 @@ bool eventPending();
 event eventGet();
 /// schedule an event
 void eventAdd(const event& e);
+/**
+ * @return a file descriptor that is readable after events were
+ *         added, to wait for events with poll(); -1 if not supported
+ *         on this platform. The UI thread has to get all pending
+ *         events before it waits again.
+ */
+int eventFd();
@@ -4,6 +4,11 @@
  */
 #include "gtest/gtest.h"
 #include "event.h"
+#include <thread>
+#include <vector>
+#if defined(__unix__) || defined(__APPLE__)
+#include <poll.h>
+#endif
 
 TEST(event, empty_queue)
 {
@@ -24,3 +29,65 @@ TEST(event, add_and_remove_events)
     ASSERT_EQ(expected2, eventGet());
     ASSERT_FALSE(eventPending());
 }
+
+TEST(event, events_of_several_threads_keep_their_order)
+{
+    const unsigned threads = 4, num = 10000;
+    std::vector<std::thread> t;
+    for(unsigned u = 0; u < threads; ++u) {
+	t.push_back(std::thread([u]() {
+		    for(unsigned i = 0; i < num; ++i) {
+			eventAdd(event(std::to_string(u) + ' ' + std::to_string(i)));
+		    }
+		}));
+    }
+    // get events while the threads add them
+    std::vector<unsigned> next(threads, 0);
+    unsigned received = 0;
+    while(received < threads * num) {
+	if (! eventPending()) {
+	    continue;
+	}
+	const std::string s = eventGet().info_;
+	const unsigned u = std::stoul(s);
+	ASSERT_LT(u, threads);
+	ASSERT_EQ(next[u], std::stoul(s.substr(s.find(' ') + 1)));
+	++next[u];
+	++received;
+    }
+    for(auto& th : t) {
+	th.join();
+    }
+    ASSERT_FALSE(eventPending());
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+namespace {
+    /// @return true if fd is readable.
+    bool readable(int fd)
+    {
+	struct pollfd p;
+	p.fd = fd;
+	p.events = POLLIN;
+	return poll(&p, 1, 0) == 1;
+    }
+}
+
+TEST(event, fd_is_readable_after_events_were_added)
+{
+    const int fd = eventFd();
+    ASSERT_LE(0, fd);
+    ASSERT_FALSE(readable(fd));
+    eventAdd(event("ex1"));
+    ASSERT_TRUE(readable(fd));
+    eventAdd(event("ex2"));
+    ASSERT_EQ(std::string("ex1"), eventGet().info_);
+    ASSERT_FALSE(readable(fd));
+    eventAdd(event("ex3"));
+    ASSERT_TRUE(readable(fd));
+    ASSERT_EQ(std::string("ex2"), eventGet().info_);
+    ASSERT_EQ(std::string("ex3"), eventGet().info_);
+    ASSERT_FALSE(eventPending());
+    ASSERT_FALSE(readable(fd));
+}
+#endif
@@ -4,7 +4,6 @@
  */
 #include "file_index.h"
 #include "error.h"
-#include "event.h"
 #include <cassert>
 #include <sysexits.h>
 
@@ -12,6 +11,7 @@ std::atomic_int file_index::abortBackgroundParse_s(-1);
 
 file_index::file_index(const std::string& filename) :
     file_(filename),
+    bytes_(file_.size()),
     has_parsed_all_(false)
 {
     if (file_.empty()) {
@@ -90,6 +90,41 @@ file_index::push_line(const c_t* beg, const c_t* end, const c_t* next, const lin
     line_.push_back(line_t(beg, end, next, num));
 }
 
+bool
+file_index::restore_lines(const uint64_t *beg, const uint8_t *trail, const line_number_t num)
+{
+    assert(size() == 0);
+    assert(beg);
+    assert(trail);
+    if (num == 0 || beg[0] != 0 || beg[num] > bytes_) {
+	return false;
+    }
+    line_.reserve(static_cast<size_t>(num) + 1);
+    const c_t* const base = file_.begin();
+    for(line_number_t i = 0; i < num; ++i) {
+	if (beg[i] >= beg[i + 1]) {
+	    line_.resize(1);
+	    return false;
+	}
+	const c_t* next = base + beg[i + 1];
+	if (trail[i] != 0 && trail[i] <= beg[i + 1] - beg[i]) {
+	    // set the members directly, the constructor would read the end of the line to strip it
+	    line_t l;
+	    l.beg_ = base + beg[i];
+	    l.end_ = next - trail[i];
+	    l.next_ = next;
+	    l.num_ = i + 1;
+	    line_.push_back(l);
+	} else {
+	    push_line(base + beg[i], next, next, i + 1);
+	}
+    }
+    if (beg[num] == bytes_) {
+	has_parsed_all_ = true;
+    }
+    return true;
+}
+
 line_t file_index::line(const line_number_t num)
 {
     if (num > size()) {
@@ -102,17 +137,6 @@ line_t file_index::line(const line_number_t num)
     return l;
 }
 
-lineNum_vector_t
-file_index::lineNum_vector()
-{
-    const line_number_t s = size();
-    lineNum_vector_t v(s);
-    for(line_number_t i = 0; i < s; ++i) {
-	v[i] = i + 1;
-    }
-    return v;
-}
-
 void
 file_index::parse_all(regex_index_vec_t& regex_index_vec, ProgressFunctor *func)
 {
@@ -125,7 +149,10 @@ file_index::parse_all(regex_index_vec_t& regex_index_vec, ProgressFunctor *func)
 
 	const line_t& line = line_[num];
 	for(auto ri : regex_index_vec) {
-	    ri->match(line);
+	    // the matches of restored lines are known
+	    if (num > ri->restored()) {
+		ri->match(line);
+	    }
 	}
 
 	if (func && (num % 10000) == 0) {
@@ -158,7 +185,7 @@ file_index::perc(const line_number_t num)
 }
 
 bool
-file_index::parse_all_in_background(std::shared_ptr<regex_index> ri, const unsigned idx) const
+file_index::parse_all_in_background(std::shared_ptr<regex_index> ri, const unsigned idx, ProgressFunctor *func) const
 {
     if (! has_parsed_all_) {
 	return false;
@@ -169,7 +196,7 @@ file_index::parse_all_in_background(std::shared_ptr<regex_index> ri, const unsig
 
     // iterator over all lines
     const unsigned line_size = line_.size();
-    for(unsigned i = 1; i < line_size; ++i) {
+    for(unsigned i = ri->restored() + 1; i < line_size; ++i) {
 	ri->match(line_[i]);
 	// every 10000 lines do bookkeeping
 	if ((i % 10000) == 0) {
@@ -179,8 +206,10 @@ file_index::parse_all_in_background(std::shared_ptr<regex_index> ri, const unsig
 		return false;
 	    }
 	    // report progress to main window
-	    const unsigned perc = static_cast<double>(i) / static_cast<double>(line_size) * 100.0;
-	    eventAdd(event("#" + std::to_string(idx+1u) + " matching line " + std::to_string(i) + " " + std::to_string(perc) + "%"));
+	    if (func) {
+		const unsigned perc = static_cast<double>(i) / static_cast<double>(line_size) * 100.0;
+		func->progress(i, perc);
+	    }
 	}
     }
 
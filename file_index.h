@@ -16,6 +16,8 @@ class file_index
     typedef char c_t;
 
     doj::memorymap_ptr<c_t> file_;
+    /// size of file_ in bytes, which can be read from background threads without the memory map registry.
+    const uint64_t bytes_;
 
     /**
      * all lines, indexed by their line number.
@@ -64,12 +66,39 @@ public:
 	return line_.size() - 1;
     }
 
+    /// @return the first character of the file.
+    const c_t* data() const { return file_.begin(); }
+
+    /// @return the size of the file in bytes.
+    uint64_t bytes() const { return bytes_; }
+
+    /**
+     * restore lines from a cached line index instead of parsing them.
+     * Lines after the restored lines are parsed as usual.
+     * This function can only be called before any line was parsed.
+     * @param beg offsets of the first character of num + 1 lines. The last offset is the start of the line after the restored lines.
+     * @param trail number of newline and carriage return characters at the end of each line; 0 if not known.
+     * @param num number of lines.
+     * @return true if the lines were restored; false if the offsets do not fit the file.
+     */
+    bool restore_lines(const uint64_t *beg, const uint8_t *trail, const line_number_t num);
+
     /**
      * get line number num.
      * @throws std::runtime_error if the line does not exist.
      */
     line_t line(const line_number_t num);
 
+    /**
+     * get line number num from a background thread.
+     * This function is only valid if parse_all() has been called before and the entire file is indexed.
+     */
+    const line_t& parsed_line(const line_number_t num) const
+    {
+	assert(num >= 1 && num < line_.size());
+	return line_[num];
+    }
+
     /// @return percentage into the file, that line number num is.
     unsigned perc(const line_number_t num);
 
@@ -87,11 +116,9 @@ public:
      * This function is only valid if parse_all() has been called before and the entire file is indexed.
      * @param[in,out] ri regex_index object.
      * @param[in] idx regular expression index of the job.
+     * @param[in] func if not NULL, the progress is reported every 10000 lines.
      * @return true if parsing finished.
      * @return false if parse was aborted.
      */
-    bool parse_all_in_background(std::shared_ptr<regex_index> ri, const unsigned idx) const;
-
-    /// @return the line number vector of all lines in the file.
-    lineNum_vector_t lineNum_vector();
+    bool parse_all_in_background(std::shared_ptr<regex_index> ri, const unsigned idx, ProgressFunctor *func = nullptr) const;
 };
@@ -0,0 +1,258 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "filter_cache.h"
+#include "temporary_file.h"
+#include <cassert>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <limits>
+
+bool parse_memory_size(const std::string& str, uint64_t& bytes)
+{
+    // strtoull() would accept a sign and wrap negative numbers
+    if (str.empty() || ! isdigit(static_cast<unsigned char>(str[0]))) {
+	return false;
+    }
+    char *end = nullptr;
+    errno = 0;
+    const unsigned long long n = strtoull(str.c_str(), &end, 10);
+    if (end == str.c_str() || errno == ERANGE) {
+	return false;
+    }
+    // accept the output of memory_size_str(), e.g. "12 KB"
+    while(*end == ' ') {
+	++end;
+    }
+    std::string suffix(end);
+    if (suffix.size() == 2 && toupper(suffix[1]) == 'B') {
+	suffix.resize(1);
+    }
+    uint64_t m = 1;
+    if (suffix.empty() || (suffix.size() == 1 && toupper(suffix[0]) == 'B')) {
+    } else if (suffix.size() == 1 && toupper(suffix[0]) == 'K') {
+	m = 1024;
+    } else if (suffix.size() == 1 && toupper(suffix[0]) == 'M') {
+	m = 1024 * 1024;
+    } else if (suffix.size() == 1 && toupper(suffix[0]) == 'G') {
+	m = 1024 * 1024 * 1024;
+    } else {
+	return false;
+    }
+    if (n > std::numeric_limits<uint64_t>::max() / m) {
+	return false;
+    }
+    bytes = n * m;
+    return true;
+}
+
+filter_cache::filter_cache(uint64_t budget) :
+    budget_(budget),
+    spill_end_(0),
+    hits_(0),
+    misses_(0)
+{ }
+
+filter_cache::~filter_cache()
+{ }
+
+void
+filter_cache::budget(uint64_t bytes)
+{
+    budget_ = bytes;
+    trim();
+}
+
+uint64_t
+filter_cache::memory(const entry& e)
+{
+    uint64_t m = e.rgx_.size() + e.compressed_.capacity();
+    if (e.ri_) {
+	m += e.ri_->lines().memory_usage();
+    }
+    return m;
+}
+
+void
+filter_cache::add(const std::string& rgx, ri_ptr ri)
+{
+    auto it = map_.find(rgx);
+    if (it != map_.end()) {
+	lru_.erase(it->second);
+	map_.erase(it);
+    }
+    entry e;
+    e.rgx_ = rgx;
+    e.ri_ = ri;
+    e.spill_offset_ = -1;
+    e.spill_size_ = 0;
+    lru_.push_front(std::move(e));
+    map_[rgx] = lru_.begin();
+    trim();
+}
+
+bool
+filter_cache::contains(const std::string& rgx) const
+{
+    return map_.count(rgx) > 0;
+}
+
+filter_cache::ri_ptr
+filter_cache::find(const std::string& rgx)
+{
+    auto it = map_.find(rgx);
+    if (it == map_.end()) {
+	++misses_;
+	return ri_ptr();
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    entry& e = lru_.front();
+    if (! e.ri_ && ! restore(e)) {
+	// the cached data is lost, the regex has to be matched again
+	map_.erase(it);
+	lru_.pop_front();
+	++misses_;
+	return ri_ptr();
+    }
+    ++hits_;
+    ri_ptr ri = e.ri_;
+    trim();
+    return ri;
+}
+
+bool
+filter_cache::spill(entry& e)
+{
+    try {
+	if (! spill_file_) {
+	    spill_file_ = std::make_shared<TemporaryFile>();
+	}
+    } catch (std::runtime_error&) {
+	return false;
+    }
+    FILE *f = spill_file_->file();
+    if (! f || fseek(f, static_cast<long>(spill_end_), SEEK_SET) != 0) {
+	return false;
+    }
+    if (fwrite(e.compressed_.data(), 1, e.compressed_.size(), f) != e.compressed_.size()) {
+	return false;
+    }
+    e.spill_offset_ = spill_end_;
+    e.spill_size_ = e.compressed_.size();
+    spill_end_ += e.compressed_.size();
+    std::string().swap(e.compressed_);
+    return true;
+}
+
+bool
+filter_cache::restore(entry& e)
+{
+    assert(! e.ri_);
+    if (e.compressed_.empty() && e.spill_offset_ >= 0) {
+	FILE *f = spill_file_ ? spill_file_->file() : nullptr;
+	if (! f || fseek(f, static_cast<long>(e.spill_offset_), SEEK_SET) != 0) {
+	    return false;
+	}
+	e.compressed_.resize(e.spill_size_);
+	if (fread(&e.compressed_[0], 1, e.spill_size_, f) != e.spill_size_) {
+	    return false;
+	}
+	// the space in the spill file is not reused
+	e.spill_offset_ = -1;
+    }
+    line_set s;
+    if (! line_set::deserialize(e.compressed_.data(), e.compressed_.size(), s)) {
+	return false;
+    }
+    e.ri_ = std::make_shared<regex_index>(e.rgx_, std::move(s));
+    std::string().swap(e.compressed_);
+    return true;
+}
+
+void
+filter_cache::trim()
+{
+    if (budget_ == 0) {
+	return;
+    }
+    uint64_t total = 0;
+    for(const auto& e : lru_) {
+	total += memory(e);
+    }
+
+    // compress the least recently used entries
+    for(auto it = lru_.rbegin(); it != lru_.rend() && total > budget_; ++it) {
+	entry& e = *it;
+	// keep entries that are used outside of the cache
+	if (! e.ri_ || e.ri_.use_count() > 1) {
+	    continue;
+	}
+	const uint64_t before = memory(e);
+	e.ri_->lines().serialize(e.compressed_);
+	e.compressed_.shrink_to_fit();
+	e.ri_.reset();
+	total = total - before + memory(e);
+    }
+
+    // spill compressed entries to disk
+    for(auto it = lru_.rbegin(); it != lru_.rend() && total > budget_; ++it) {
+	entry& e = *it;
+	if (e.ri_ || e.compressed_.empty()) {
+	    continue;
+	}
+	const uint64_t before = memory(e);
+	if (! spill(e)) {
+	    break;
+	}
+	total = total - before + memory(e);
+    }
+}
+
+uint64_t
+filter_cache::resident_bytes() const
+{
+    uint64_t b = 0;
+    for(const auto& e : lru_) {
+	if (e.ri_) {
+	    b += e.ri_->lines().memory_usage();
+	}
+    }
+    return b;
+}
+
+uint64_t
+filter_cache::compressed_bytes() const
+{
+    uint64_t b = 0;
+    for(const auto& e : lru_) {
+	b += e.compressed_.size();
+    }
+    return b;
+}
+
+uint64_t
+filter_cache::spilled_bytes() const
+{
+    uint64_t b = 0;
+    for(const auto& e : lru_) {
+	if (e.spill_offset_ >= 0) {
+	    b += e.spill_size_;
+	}
+    }
+    return b;
+}
+
+std::string
+filter_cache::info() const
+{
+    std::string s = "filter cache " + std::to_string(hits_) + "/" + std::to_string(hits_ + misses_) + " hits, ";
+    s += memory_size_str(resident_bytes()) + " resident, ";
+    s += memory_size_str(compressed_bytes()) + " compressed, ";
+    s += memory_size_str(spilled_bytes()) + " on disk";
+    if (budget_ > 0) {
+	s += ", budget " + memory_size_str(budget_);
+    }
+    return s;
+}
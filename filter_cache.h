@@ -0,0 +1,114 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#pragma once
+#include "regex_index.h"
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+
+class TemporaryFile;
+
+/**
+ * parse a memory size like "512M" or "2G".
+ * The suffix B is bytes, the suffixes K, M and G (optionally followed by B) are multiples of 1024
+ * and may be separated by spaces from the number, like memory_size_str() prints them.
+ * @param[in] str the memory size string.
+ * @param[out] bytes the memory size in bytes.
+ * @return true upon success; false if str is not a memory size.
+ */
+bool parse_memory_size(const std::string& str, uint64_t& bytes);
+
+/**
+ * cache of the results of lines filters with a memory budget.
+ *
+ * The key is the normalized regular expression string. If the memory
+ * of all entries exceeds the budget, the least recently used entries
+ * are compressed in memory with line_set::serialize(). If that is not
+ * enough, compressed entries are written to a temporary file.
+ * Restoring an entry only needs to parse the compressed data, which is
+ * much faster than matching the file again.
+ *
+ * Entries whose regex_index is referenced outside of the cache, for
+ * example by a regex slot or a background job, are never evicted.
+ */
+class filter_cache
+{
+public:
+    typedef std::shared_ptr<regex_index> ri_ptr;
+
+private:
+    struct entry
+    {
+	std::string rgx_;
+	/// the regex_index if the entry is resident; nullptr otherwise.
+	ri_ptr ri_;
+	/// the serialized line_set if the entry is compressed.
+	std::string compressed_;
+	/// position in the spill file if the entry was spilled; -1 otherwise.
+	long long spill_offset_;
+	/// number of bytes in the spill file.
+	size_t spill_size_;
+    };
+    typedef std::list<entry> list_t;
+
+    /// entries, the most recently used entry is first.
+    list_t lru_;
+    std::map<std::string, list_t::iterator> map_;
+    /// memory budget in bytes; 0 for an unlimited budget.
+    uint64_t budget_;
+    std::shared_ptr<TemporaryFile> spill_file_;
+    /// size of the spill file.
+    long long spill_end_;
+    uint64_t hits_, misses_;
+
+    /// @return memory used by the entry.
+    static uint64_t memory(const entry& e);
+
+    /// write e.compressed_ to the spill file. @return true upon success.
+    bool spill(entry& e);
+
+    /// restore the regex_index of e. @return true upon success.
+    bool restore(entry& e);
+
+public:
+    /// @param budget memory budget in bytes; 0 for an unlimited budget.
+    explicit filter_cache(uint64_t budget = 0);
+    ~filter_cache();
+
+    uint64_t budget() const { return budget_; }
+    void budget(uint64_t bytes);
+
+    /// add or replace the regex_index for rgx and enforce the budget.
+    void add(const std::string& rgx, ri_ptr ri);
+
+    /// @return true if rgx is cached.
+    bool contains(const std::string& rgx) const;
+
+    /**
+     * @return the regex_index for rgx, which is restored if it was compressed or spilled;
+     *         nullptr if rgx is not cached.
+     */
+    ri_ptr find(const std::string& rgx);
+
+    /// compress and spill the least recently used entries until the memory budget is met.
+    void trim();
+
+    /// @return number of cached entries.
+    size_t size() const { return lru_.size(); }
+
+    uint64_t hits() const { return hits_; }
+    uint64_t misses() const { return misses_; }
+
+    /// @return bytes used by resident entries.
+    uint64_t resident_bytes() const;
+    /// @return bytes used by compressed entries in memory.
+    uint64_t compressed_bytes() const;
+    /// @return bytes used by spilled entries in the spill file.
+    uint64_t spilled_bytes() const;
+
+    /// @return a human readable summary of the cache statistics.
+    std::string info() const;
+};
@@ -0,0 +1,103 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "gtest/gtest.h"
+#include "filter_cache.h"
+
+namespace {
+    /// @return a regex_index with every m-th line of [1..max].
+    filter_cache::ri_ptr make(const std::string& rgx, line_number_t m, line_number_t max)
+    {
+	line_set s;
+	for(line_number_t i = 1; i <= max; i += m) {
+	    s.push_back(i);
+	}
+	s.optimize();
+	return std::make_shared<regex_index>(rgx, std::move(s));
+    }
+}
+
+TEST(filter_cache, parse_memory_size)
+{
+    uint64_t b = 0;
+    ASSERT_TRUE(parse_memory_size("100", b));
+    ASSERT_EQ(100u, b);
+    ASSERT_TRUE(parse_memory_size("2K", b));
+    ASSERT_EQ(2048u, b);
+    ASSERT_TRUE(parse_memory_size("3mb", b));
+    ASSERT_EQ(3u * 1024 * 1024, b);
+    ASSERT_TRUE(parse_memory_size("2G", b));
+    ASSERT_EQ(2ull * 1024 * 1024 * 1024, b);
+    ASSERT_TRUE(parse_memory_size(memory_size_str(500), b));
+    ASSERT_EQ(500u, b);
+    ASSERT_TRUE(parse_memory_size(memory_size_str(12 * 1024 * 1024), b));
+    ASSERT_EQ(12u * 1024 * 1024, b);
+    ASSERT_FALSE(parse_memory_size("", b));
+    ASSERT_FALSE(parse_memory_size("G", b));
+    ASSERT_FALSE(parse_memory_size("1T", b));
+    ASSERT_FALSE(parse_memory_size("-5", b));
+    ASSERT_FALSE(parse_memory_size(" -5M", b));
+    ASSERT_FALSE(parse_memory_size("+5", b));
+    ASSERT_FALSE(parse_memory_size("99999999999999999999", b));
+    ASSERT_FALSE(parse_memory_size("17179869184G", b));
+    ASSERT_TRUE(parse_memory_size("17179869183G", b));
+    ASSERT_EQ(17179869183ull << 30, b);
+}
+
+TEST(filter_cache, unlimited_budget_keeps_entries_resident)
+{
+    filter_cache c;
+    c.add("/a/", make("/a/", 3, 200000));
+    c.add("/b/", make("/b/", 5, 200000));
+    ASSERT_TRUE(c.contains("/a/"));
+    ASSERT_FALSE(c.contains("/c/"));
+    ASSERT_EQ(0u, c.compressed_bytes());
+    ASSERT_TRUE(c.find("/a/") != nullptr);
+    ASSERT_TRUE(c.find("/c/") == nullptr);
+    ASSERT_EQ(1u, c.hits());
+    ASSERT_EQ(1u, c.misses());
+}
+
+TEST(filter_cache, compress_and_restore)
+{
+    filter_cache c(1);
+    auto a = make("/a/", 3, 200000);
+    const line_set expected = a->lines();
+    c.add("/a/", a);
+    // an entry used outside of the cache stays resident
+    ASSERT_EQ(0u, c.compressed_bytes());
+    a.reset();
+    c.budget(expected.memory_usage() - 1);
+    ASSERT_GT(c.compressed_bytes(), 0u);
+    ASSERT_EQ(0u, c.resident_bytes());
+
+    c.budget(0);
+    a = c.find("/a/");
+    ASSERT_TRUE(a != nullptr);
+    ASSERT_EQ(expected, a->lines());
+    ASSERT_EQ(0u, c.compressed_bytes());
+}
+
+TEST(filter_cache, spill_to_disk_and_restore)
+{
+    filter_cache c;
+    std::vector<line_set> expected;
+    for(unsigned u = 0; u < 5; ++u) {
+	auto ri = make("/" + std::to_string(u) + "/", 2 + u, 300000);
+	expected.push_back(ri->lines());
+	c.add("/" + std::to_string(u) + "/", ri);
+    }
+    // the budget is too small for even compressed entries
+    c.budget(1);
+    ASSERT_EQ(0u, c.resident_bytes());
+    ASSERT_EQ(0u, c.compressed_bytes());
+    ASSERT_GT(c.spilled_bytes(), 0u);
+
+    for(unsigned u = 0; u < 5; ++u) {
+	auto ri = c.find("/" + std::to_string(u) + "/");
+	ASSERT_TRUE(ri != nullptr);
+	ASSERT_EQ(expected[u], ri->lines());
+    }
+    ASSERT_EQ(5u, c.hits());
+}
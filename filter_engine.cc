@@ -0,0 +1,246 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "filter_engine.h"
+#include "worker_pool.h"
+#include <algorithm>
+#include <cassert>
+
+namespace {
+    /// number of line numbers in one chunk of a line_set. Partitions are aligned to this size.
+    const uint64_t chunk_lines = 65536;
+    /// minimum number of chunks in a partition.
+    const uint64_t min_partition_chunks = 4;
+}
+
+line_set parallel_intersect(const std::vector<const line_set*>& v, const std::atomic<bool> *cancel)
+{
+    assert(! v.empty());
+    // only the range of the smallest set can contain results
+    const line_set *smallest = *std::min_element(v.begin(), v.end(), [](const line_set *l, const line_set *r) { return l->size() < r->size(); });
+    if (smallest->empty()) {
+	return line_set();
+    }
+    const uint64_t first = smallest->first() / chunk_lines;
+    const uint64_t last = smallest->last() / chunk_lines;
+
+    // use a few partitions per thread, so threads that finish early can pick up more work
+    const uint64_t chunks = last - first + 1;
+    const uint64_t partitions = std::max<uint64_t>(1, std::min<uint64_t>(worker_threads() * 4, chunks / min_partition_chunks));
+    const uint64_t per_partition = (chunks + partitions - 1) / partitions;
+
+    std::vector<line_set> result(partitions);
+    parallel_for(static_cast<unsigned>(partitions), [&](unsigned p) {
+	    if (cancel && *cancel) {
+		return;
+	    }
+	    const uint64_t b = first + p * per_partition;
+	    const uint64_t e = std::min(last + 1, b + per_partition);
+	    if (b < e) {
+		result[p] = line_set::intersect(v, static_cast<line_number_t>(b * chunk_lines), static_cast<line_number_t>(e * chunk_lines - 1));
+	    }
+	});
+
+    line_set s;
+    for(auto& r : result) {
+	s.append(std::move(r));
+    }
+    return s;
+}
+
+filter_engine::filter_engine(size_t max_entries) :
+    max_entries_(max_entries),
+    hits_(0),
+    misses_(0)
+{ }
+
+namespace {
+    typedef filter_engine::set_ptr set_ptr;
+
+    /// @return the used slots, sorted by address.
+    std::vector<set_ptr> used(const std::vector<set_ptr>& slots)
+    {
+	std::vector<set_ptr> v;
+	for(const auto& s : slots) {
+	    if (s) {
+		v.push_back(s);
+	    }
+	}
+	std::sort(v.begin(), v.end());
+	return v;
+    }
+
+    /// @return v without the element s.
+    std::vector<set_ptr> without(const std::vector<set_ptr>& v, const set_ptr& s)
+    {
+	std::vector<set_ptr> r;
+	bool removed = false;
+	for(const auto& i : v) {
+	    if (i == s && !removed) {
+		removed = true;
+	    } else {
+		r.push_back(i);
+	    }
+	}
+	return r;
+    }
+
+    /// @return the addresses of the line sets of slots.
+    std::vector<const line_set*> addresses(const std::vector<set_ptr>& slots)
+    {
+	std::vector<const line_set*> v;
+	for(const auto& s : slots) {
+	    v.push_back(s.get());
+	}
+	return v;
+    }
+
+    /// intersect the sets of v, which must not be empty.
+    set_ptr intersect_all(const std::vector<set_ptr>& v, const std::atomic<bool> *cancel)
+    {
+	if (v.size() == 1) {
+	    return v[0];
+	}
+	std::vector<const line_set*> p;
+	for(const auto& s : v) {
+	    p.push_back(s.get());
+	}
+	return std::make_shared<line_set>(parallel_intersect(p, cancel));
+    }
+}
+
+set_ptr
+filter_engine::find(const std::vector<set_ptr>& sets)
+{
+    for(auto it = cache_.begin(); it != cache_.end(); ++it) {
+	if (it->sets_ == sets) {
+	    cache_.splice(cache_.begin(), cache_, it);
+	    return it->result_;
+	}
+    }
+    return set_ptr();
+}
+
+void
+filter_engine::insert(std::vector<set_ptr>&& sets, set_ptr result)
+{
+    if (find(sets)) {
+	return;
+    }
+    entry e;
+    e.sets_ = std::move(sets);
+    e.result_ = result;
+    cache_.push_front(std::move(e));
+    if (cache_.size() > max_entries_) {
+	cache_.pop_back();
+    }
+}
+
+set_ptr
+filter_engine::intersect(const std::vector<set_ptr>& slots, const std::atomic<bool> *cancel)
+{
+    const std::vector<set_ptr> all = used(slots);
+    if (all.empty()) {
+	return set_ptr();
+    }
+    if (all.size() == 1) {
+	return all[0];
+    }
+
+    set_ptr partial, changed;
+    {
+	std::lock_guard<std::mutex> _(lock_);
+	remove_unused(all);
+
+	// nothing changed, or a slot was cleared whose complement is cached
+	set_ptr r = find(all);
+	if (r) {
+	    ++hits_;
+	    last_ = addresses(slots);
+	    return r;
+	}
+
+	// one slot changed and the intersection of all other slots is cached
+	for(const auto& s : all) {
+	    partial = find(without(all, s));
+	    if (partial) {
+		changed = s;
+		++hits_;
+		break;
+	    }
+	}
+
+	if (! partial) {
+	    ++misses_;
+	    // the slot that changed last is most likely edited again
+	    for(size_t i = slots.size(); i-- > 0; ) {
+		if (slots[i] && (i >= last_.size() || last_[i] != slots[i].get())) {
+		    changed = slots[i];
+		    break;
+		}
+	    }
+	    if (! changed) {
+		changed = all.back();
+	    }
+	}
+	last_ = addresses(slots);
+    }
+
+    if (! partial) {
+	std::vector<set_ptr> others = without(all, changed);
+	partial = intersect_all(others, cancel);
+	if (cancel && *cancel) {
+	    return partial;
+	}
+	if (others.size() > 1) {
+	    std::lock_guard<std::mutex> _(lock_);
+	    insert(std::move(others), partial);
+	}
+    }
+
+    std::vector<set_ptr> v = { partial, changed };
+    set_ptr r = intersect_all(v, cancel);
+    if (! cancel || ! *cancel) {
+	std::lock_guard<std::mutex> _(lock_);
+	insert(std::vector<set_ptr>(all), r);
+    }
+    return r;
+}
+
+void
+filter_engine::remove_unused(const std::vector<set_ptr>& all)
+{
+    cache_.remove_if([&all](const entry& e) {
+	    return ! std::includes(all.begin(), all.end(), e.sets_.begin(), e.sets_.end());
+	});
+}
+
+void
+filter_engine::retain(const std::vector<set_ptr>& slots)
+{
+    const std::vector<set_ptr> all = used(slots);
+    std::lock_guard<std::mutex> _(lock_);
+    remove_unused(all);
+}
+
+size_t
+filter_engine::cache_size() const
+{
+    std::lock_guard<std::mutex> _(lock_);
+    return cache_.size();
+}
+
+uint64_t
+filter_engine::hits() const
+{
+    std::lock_guard<std::mutex> _(lock_);
+    return hits_;
+}
+
+uint64_t
+filter_engine::misses() const
+{
+    std::lock_guard<std::mutex> _(lock_);
+    return misses_;
+}
@@ -0,0 +1,93 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#pragma once
+#include "line_set.h"
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * intersect the line sets of v.
+ * The line numbers are partitioned into ranges, which are intersected
+ * in parallel by the worker pool and joined afterwards.
+ * @param v line sets, must not be empty.
+ * @param cancel if not nullptr and set to true, the intersection stops early and the result is incomplete.
+ * @return the line numbers included in all sets of v.
+ */
+line_set parallel_intersect(const std::vector<const line_set*>& v, const std::atomic<bool> *cancel = nullptr);
+
+/**
+ * intersect the line sets of the filter slots.
+ *
+ * The engine caches the intersection of all slots except the one that
+ * was changed last. If the user edits the same slot again, only one
+ * intersection of two sets is needed instead of intersecting all slots.
+ *
+ * Cache entries are identified by the line sets they were computed
+ * from, so they stay valid if slots are reordered and are dropped as
+ * soon as one of their line sets is no longer used by any slot.
+ * All functions can be called from any thread.
+ */
+class filter_engine
+{
+public:
+    typedef std::shared_ptr<const line_set> set_ptr;
+
+private:
+    struct entry
+    {
+	/// the line sets of the intersection, sorted by address.
+	std::vector<set_ptr> sets_;
+	/// intersection of all sets_.
+	set_ptr result_;
+    };
+
+    /// maximum number of entries in cache_.
+    const size_t max_entries_;
+    /// cached intersections, the most recently used entry is first.
+    std::list<entry> cache_;
+    /// the addresses of the slots of the previous call to intersect(), which do not keep the line sets alive.
+    std::vector<const line_set*> last_;
+    uint64_t hits_, misses_;
+    mutable std::mutex lock_;
+
+    /// @return the cached intersection of sets, which must be sorted by address; nullptr if not cached.
+    set_ptr find(const std::vector<set_ptr>& sets);
+
+    /// add the intersection of sets to the cache.
+    void insert(std::vector<set_ptr>&& sets, set_ptr result);
+
+    /// drop entries with line sets that are not in all, which must be sorted by address.
+    void remove_unused(const std::vector<set_ptr>& all);
+
+public:
+    explicit filter_engine(size_t max_entries = 8);
+
+    /**
+     * intersect the line sets of all slots.
+     * @param slots line sets of the filter slots; nullptr for an unused slot.
+     * @param cancel if not nullptr and set to true, the intersection stops early and the result is incomplete.
+     * @return the line numbers included in all used slots; nullptr if no slot is used.
+     */
+    set_ptr intersect(const std::vector<set_ptr>& slots, const std::atomic<bool> *cancel = nullptr);
+
+    /**
+     * drop the cached intersections that use line sets which are not in slots,
+     * so the line sets of removed filters are no longer referenced.
+     * @param slots line sets of the filter slots; nullptr for an unused slot.
+     */
+    void retain(const std::vector<set_ptr>& slots);
+
+    /// @return number of cached intersections.
+    size_t cache_size() const;
+
+    /// @return number of intersect() calls that used a cached intersection.
+    uint64_t hits() const;
+
+    /// @return number of intersect() calls that had to intersect all slots.
+    uint64_t misses() const;
+};
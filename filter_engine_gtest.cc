@@ -0,0 +1,153 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "gtest/gtest.h"
+#include "filter_engine.h"
+#include <random>
+
+namespace {
+    /// create a set with random line numbers. Every line number in [1..max] is included with probability p.
+    line_set random_lines(unsigned seed, line_number_t max, double p)
+    {
+	std::mt19937 gen(seed);
+	std::bernoulli_distribution d(p);
+	line_set s;
+	for(line_number_t i = 1; i <= max; ++i) {
+	    if (d(gen)) {
+		s.push_back(i);
+	    }
+	}
+	s.optimize();
+	return s;
+    }
+}
+
+TEST(filter_engine, parallel_intersect_matches_serial_intersect)
+{
+    line_set a = random_lines(1, 3000000, 0.5);
+    line_set b = random_lines(2, 3000000, 0.01);
+    line_set c = line_set::range(70000, 2900000);
+    std::vector<const line_set*> v = { &a, &b, &c };
+    ASSERT_EQ(line_set::intersect(v), parallel_intersect(v));
+}
+
+TEST(filter_engine, parallel_intersect_small_and_empty_sets)
+{
+    line_set a = line_set::range(1, 10);
+    line_set b;
+    b.push_back(5);
+    line_set empty;
+    std::vector<const line_set*> v = { &a, &b };
+    line_set r = parallel_intersect(v);
+    ASSERT_EQ(1u, r.size());
+    ASSERT_EQ(5u, r.first());
+    v.push_back(&empty);
+    ASSERT_TRUE(parallel_intersect(v).empty());
+}
+
+TEST(filter_engine, parallel_intersect_can_be_cancelled)
+{
+    line_set a = random_lines(3, 1000000, 0.5);
+    line_set b = random_lines(4, 1000000, 0.5);
+    std::vector<const line_set*> v = { &a, &b };
+    std::atomic<bool> cancel(true);
+    ASSERT_TRUE(parallel_intersect(v, &cancel).empty());
+}
+
+namespace {
+    typedef filter_engine::set_ptr set_ptr;
+
+    set_ptr make(unsigned seed, double p)
+    {
+	return std::make_shared<line_set>(random_lines(seed, 300000, p));
+    }
+
+    line_set expected(const std::vector<set_ptr>& slots)
+    {
+	std::vector<const line_set*> v;
+	for(const auto& s : slots) {
+	    if (s) {
+		v.push_back(s.get());
+	    }
+	}
+	return line_set::intersect(v);
+    }
+}
+
+TEST(filter_engine, no_used_slots)
+{
+    filter_engine e;
+    ASSERT_FALSE(e.intersect(std::vector<set_ptr>()));
+    ASSERT_FALSE(e.intersect(std::vector<set_ptr>(3)));
+}
+
+TEST(filter_engine, single_slot_is_not_copied)
+{
+    filter_engine e;
+    std::vector<set_ptr> slots = { nullptr, make(1, 0.5) };
+    ASSERT_EQ(slots[1], e.intersect(slots));
+}
+
+TEST(filter_engine, editing_one_slot_uses_cached_intersection_of_other_slots)
+{
+    filter_engine e;
+    std::vector<set_ptr> slots = { make(1, 0.9), make(2, 0.8), make(3, 0.7), make(4, 0.6) };
+    ASSERT_EQ(expected(slots), *e.intersect(slots));
+    ASSERT_EQ(1u, e.misses());
+
+    // edit the last slot several times
+    for(unsigned u = 0; u < 5; ++u) {
+	slots[3] = make(10 + u, 0.5);
+	ASSERT_EQ(expected(slots), *e.intersect(slots));
+    }
+    ASSERT_EQ(1u, e.misses());
+    ASSERT_EQ(5u, e.hits());
+
+    // clearing the edited slot returns the cached intersection of the other slots
+    slots[3].reset();
+    ASSERT_EQ(expected(slots), *e.intersect(slots));
+    ASSERT_EQ(1u, e.misses());
+}
+
+TEST(filter_engine, reordering_slots_keeps_cache)
+{
+    filter_engine e;
+    std::vector<set_ptr> slots = { make(1, 0.9), make(2, 0.8), make(3, 0.7) };
+    auto r = e.intersect(slots);
+    std::swap(slots[0], slots[2]);
+    ASSERT_EQ(r, e.intersect(slots));
+    ASSERT_EQ(1u, e.hits());
+}
+
+TEST(filter_engine, changing_other_slot_invalidates_cache)
+{
+    filter_engine e;
+    std::vector<set_ptr> slots = { make(1, 0.9), make(2, 0.8), make(3, 0.7) };
+    e.intersect(slots);
+    slots[2] = make(4, 0.5);
+    e.intersect(slots);
+    // the cached intersection of slots 0 and 1 does not help when slot 0 changes
+    slots[0] = make(5, 0.6);
+    ASSERT_EQ(expected(slots), *e.intersect(slots));
+    ASSERT_EQ(2u, e.misses());
+    // entries with line sets that are no longer used are removed
+    slots = { make(6, 0.5), make(7, 0.5) };
+    ASSERT_EQ(expected(slots), *e.intersect(slots));
+    ASSERT_EQ(1u, e.cache_size());
+}
+
+TEST(filter_engine, retain_releases_removed_line_sets)
+{
+    filter_engine e;
+    std::vector<set_ptr> slots = { make(1, 0.9), make(2, 0.8), make(3, 0.7) };
+    e.intersect(slots);
+    ASSERT_LT(0u, e.cache_size());
+    std::weak_ptr<const line_set> removed = slots[2];
+    slots[2].reset();
+    e.retain(slots);
+    ASSERT_TRUE(removed.expired());
+    // the intersection of the remaining slots is still cached
+    ASSERT_EQ(expected(slots), *e.intersect(slots));
+    ASSERT_EQ(1u, e.misses());
+}
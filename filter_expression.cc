@@ -0,0 +1,214 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "filter_expression.h"
+#include <cctype>
+#include <stdexcept>
+
+namespace {
+    typedef filter_expression::node node_t;
+    typedef filter_expression::set_ptr set_ptr;
+
+    /// recursive descent parser for the filter expression grammar.
+    class parser
+    {
+	const std::string& s_;
+	size_t pos_;
+	std::vector<node_t>& node_;
+
+	void skip_space()
+	{
+	    while (pos_ < s_.size() && isspace(static_cast<unsigned char>(s_[pos_]))) {
+		++pos_;
+	    }
+	}
+
+	/// @return true if the next character is c, which is consumed.
+	bool accept(char c)
+	{
+	    skip_space();
+	    if (pos_ < s_.size() && s_[pos_] == c) {
+		++pos_;
+		return true;
+	    }
+	    return false;
+	}
+
+	[[noreturn]] void fail(const std::string& msg)
+	{
+	    throw std::runtime_error(msg + " at position " + std::to_string(pos_ + 1));
+	}
+
+	unsigned add(filter_expression::op_t op, unsigned slot, unsigned left, unsigned right)
+	{
+	    node_t n;
+	    n.op_ = op;
+	    n.slot_ = slot;
+	    n.left_ = left;
+	    n.right_ = right;
+	    node_.push_back(n);
+	    return static_cast<unsigned>(node_.size() - 1);
+	}
+
+	unsigned factor()
+	{
+	    if (accept('!')) {
+		const unsigned f = factor();
+		return add(filter_expression::op_not, 0, f, 0);
+	    }
+	    if (accept('(')) {
+		const unsigned e = expr();
+		if (! accept(')')) {
+		    fail("missing ')'");
+		}
+		return e;
+	    }
+	    skip_space();
+	    unsigned num = 0;
+	    const size_t start = pos_;
+	    while (pos_ < s_.size() && isdigit(static_cast<unsigned char>(s_[pos_])) && num < 1000) {
+		num = num * 10 + (s_[pos_++] - '0');
+	    }
+	    if (pos_ == start) {
+		fail("expected slot number");
+	    }
+	    if (num == 0) {
+		fail("slot numbers start at 1");
+	    }
+	    return add(filter_expression::op_slot, num - 1, 0, 0);
+	}
+
+	unsigned term()
+	{
+	    unsigned l = factor();
+	    while (accept('&')) {
+		l = add(filter_expression::op_and, 0, l, factor());
+	    }
+	    return l;
+	}
+
+    public:
+	parser(const std::string& s, std::vector<node_t>& n) : s_(s), pos_(0), node_(n) {}
+
+	unsigned expr()
+	{
+	    unsigned l = term();
+	    while (accept('|')) {
+		l = add(filter_expression::op_or, 0, l, term());
+	    }
+	    return l;
+	}
+
+	/// parse the complete string. @return index of the root node.
+	unsigned parse()
+	{
+	    const unsigned r = expr();
+	    skip_space();
+	    if (pos_ != s_.size()) {
+		fail(std::string("unexpected '") + s_[pos_] + "'");
+	    }
+	    return r;
+	}
+    };
+
+    /**
+     * an intermediate result. If negated_ is true, the result is the
+     * complement of set_, which is never computed.
+     */
+    struct value
+    {
+	set_ptr set_;
+	bool negated_;
+    };
+
+    value make(line_set&& s, bool negated)
+    {
+	value v;
+	v.set_ = std::make_shared<line_set>(std::move(s));
+	v.negated_ = negated;
+	return v;
+    }
+
+    value evaluate(const std::vector<node_t>& node, unsigned i, const std::vector<set_ptr>& slots)
+    {
+	const node_t& n = node[i];
+	switch(n.op_) {
+	case filter_expression::op_slot: {
+	    if (n.slot_ >= slots.size() || ! slots[n.slot_]) {
+		throw std::runtime_error("slot " + std::to_string(n.slot_ + 1) + " is not a lines filter");
+	    }
+	    value v;
+	    v.set_ = slots[n.slot_];
+	    v.negated_ = false;
+	    return v;
+	}
+	case filter_expression::op_not: {
+	    value v = evaluate(node, n.left_, slots);
+	    v.negated_ = ! v.negated_;
+	    return v;
+	}
+	case filter_expression::op_and: {
+	    const value l = evaluate(node, n.left_, slots);
+	    const value r = evaluate(node, n.right_, slots);
+	    if (! l.negated_ && ! r.negated_) {
+		return make(line_set::intersect(*l.set_, *r.set_), false);
+	    }
+	    if (! l.negated_) {
+		return make(line_set::subtract(*l.set_, *r.set_), false);
+	    }
+	    if (! r.negated_) {
+		return make(line_set::subtract(*r.set_, *l.set_), false);
+	    }
+	    // !a & !b == !(a | b)
+	    return make(line_set::unite(*l.set_, *r.set_), true);
+	}
+	case filter_expression::op_or: {
+	    const value l = evaluate(node, n.left_, slots);
+	    const value r = evaluate(node, n.right_, slots);
+	    if (! l.negated_ && ! r.negated_) {
+		return make(line_set::unite(*l.set_, *r.set_), false);
+	    }
+	    // a | !b == !(b & !a)
+	    if (! l.negated_) {
+		return make(line_set::subtract(*r.set_, *l.set_), true);
+	    }
+	    if (! r.negated_) {
+		return make(line_set::subtract(*l.set_, *r.set_), true);
+	    }
+	    // !a | !b == !(a & b)
+	    return make(line_set::intersect(*l.set_, *r.set_), true);
+	}
+	}
+	throw std::runtime_error("invalid filter expression node");
+    }
+}
+
+filter_expression::filter_expression(const std::string& expr) :
+    str_(expr)
+{
+    parser p(str_, node_);
+    root_ = p.parse();
+}
+
+std::set<unsigned>
+filter_expression::slots() const
+{
+    std::set<unsigned> s;
+    for(const auto& n : node_) {
+	if (n.op_ == op_slot) {
+	    s.insert(n.slot_);
+	}
+    }
+    return s;
+}
+
+line_set
+filter_expression::evaluate(const std::vector<set_ptr>& slots, line_number_t size) const
+{
+    const value v = ::evaluate(node_, root_, slots);
+    if (v.negated_) {
+	return line_set::subtract(line_set::range(1, size), *v.set_);
+    }
+    return *v.set_;
+}
@@ -0,0 +1,71 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#pragma once
+#include "filter_engine.h"
+#include <set>
+#include <string>
+#include <vector>
+
+/**
+ * a boolean expression that combines the line sets of filter slots.
+ *
+ * Grammar, whitespace is ignored:
+ *   expr   := term ( '|' term )*
+ *   term   := factor ( '&' factor )*
+ *   factor := '!' factor | '(' expr ')' | NUM
+ * NUM is a slot number as shown in the regex window, starting at 1.
+ * '&' binds stronger than '|'.
+ *
+ * The expression is evaluated with set operations on the line sets of
+ * the slots. A negated operand is never materialized as a complement,
+ * it is combined with subtract() instead of intersect() (and with De
+ * Morgan's laws for '|'). Only a negated final result is subtracted
+ * from the lines of the file.
+ */
+class filter_expression
+{
+public:
+    typedef filter_engine::set_ptr set_ptr;
+
+    enum op_t { op_slot, op_not, op_and, op_or };
+
+    /// a node of the expression tree. This is an implementation detail of filter_expression.
+    struct node
+    {
+	op_t op_;
+	/// op_slot: slot index, starting at 0.
+	unsigned slot_;
+	/// index of the operands in node_.
+	unsigned left_, right_;
+    };
+
+private:
+    std::string str_;
+    std::vector<node> node_;
+    /// index of the root node.
+    unsigned root_;
+
+public:
+    /**
+     * parse expr.
+     * @throws std::runtime_error if expr is not a valid expression.
+     */
+    explicit filter_expression(const std::string& expr);
+
+    /// @return the expression string.
+    const std::string& str() const { return str_; }
+
+    /// @return the slot indexes, starting at 0, used by the expression.
+    std::set<unsigned> slots() const;
+
+    /**
+     * evaluate the expression.
+     * @param slots line sets of the filter slots, nullptr for slots without a lines filter.
+     * @param size number of lines in the file.
+     * @return the line numbers selected by the expression.
+     * @throws std::runtime_error if a slot used by the expression has no line set.
+     */
+    line_set evaluate(const std::vector<set_ptr>& slots, line_number_t size) const;
+};
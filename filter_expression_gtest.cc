@@ -0,0 +1,97 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "gtest/gtest.h"
+#include "filter_expression.h"
+
+namespace {
+    typedef filter_expression::set_ptr set_ptr;
+
+    /// @return a set with all multiples of m in [1..max].
+    set_ptr multiples(line_number_t m, line_number_t max)
+    {
+	auto s = std::make_shared<line_set>();
+	for(line_number_t i = m; i <= max; i += m) {
+	    s->push_back(i);
+	}
+	return s;
+    }
+
+    const line_number_t size = 200000;
+
+    /// slot 1: multiples of 2, slot 2: multiples of 3, slot 3: multiples of 5, slot 4 unused.
+    std::vector<set_ptr> slots()
+    {
+	return { multiples(2, size), multiples(3, size), multiples(5, size), nullptr };
+    }
+
+    /// @return the line numbers in [1..size] for which f returns true.
+    template <typename F>
+    line_set expected(F f)
+    {
+	line_set s;
+	for(line_number_t i = 1; i <= size; ++i) {
+	    if (f(i)) {
+		s.push_back(i);
+	    }
+	}
+	return s;
+    }
+
+    /// check that expr selects the line numbers for which f returns true.
+    template <typename F>
+    void check(const char *expr, F f)
+    {
+	const line_set e = expected(f);
+	ASSERT_EQ(e, filter_expression(expr).evaluate(slots(), size)) << expr;
+    }
+}
+
+TEST(filter_expression, single_slot)
+{
+    filter_expression e("2");
+    ASSERT_EQ(*slots()[1], e.evaluate(slots(), size));
+    ASSERT_EQ(std::set<unsigned>({ 1 }), e.slots());
+}
+
+TEST(filter_expression, and_or_not)
+{
+    check("1&2", [](line_number_t i) { return i % 2 == 0 && i % 3 == 0; });
+    check("1|2", [](line_number_t i) { return i % 2 == 0 || i % 3 == 0; });
+    check("!1", [](line_number_t i) { return i % 2 != 0; });
+    check("!!1", [](line_number_t i) { return i % 2 == 0; });
+}
+
+TEST(filter_expression, precedence_and_grouping)
+{
+    check(" ( 1 | 2 ) & !3 ", [](line_number_t i) { return (i % 2 == 0 || i % 3 == 0) && i % 5 != 0; });
+    check("1|2&3", [](line_number_t i) { return i % 2 == 0 || (i % 3 == 0 && i % 5 == 0); });
+    std::set<unsigned> s = { 0, 1, 2 };
+    ASSERT_EQ(s, filter_expression("(1|2)&!3").slots());
+}
+
+TEST(filter_expression, negated_operands)
+{
+    check("!1&!2", [](line_number_t i) { return i % 2 != 0 && i % 3 != 0; });
+    check("!1|!2", [](line_number_t i) { return i % 2 != 0 || i % 3 != 0; });
+    check("1|!2", [](line_number_t i) { return i % 2 == 0 || i % 3 != 0; });
+    check("!1|2", [](line_number_t i) { return i % 2 != 0 || i % 3 == 0; });
+    check("!1&2", [](line_number_t i) { return i % 2 != 0 && i % 3 == 0; });
+}
+
+TEST(filter_expression, syntax_errors)
+{
+    ASSERT_THROW(filter_expression(""), std::runtime_error);
+    ASSERT_THROW(filter_expression("1&"), std::runtime_error);
+    ASSERT_THROW(filter_expression("(1|2"), std::runtime_error);
+    ASSERT_THROW(filter_expression("1 2"), std::runtime_error);
+    ASSERT_THROW(filter_expression("0"), std::runtime_error);
+    ASSERT_THROW(filter_expression("a"), std::runtime_error);
+}
+
+TEST(filter_expression, unused_slot)
+{
+    ASSERT_THROW(filter_expression("1&4").evaluate(slots(), size), std::runtime_error);
+    ASSERT_THROW(filter_expression("9").evaluate(slots(), size), std::runtime_error);
+}
@@ -9,8 +9,15 @@
  */
 void help()
 {
-    std::cout << "usage: few [--regex '/REGEX/flags']* [--search '/REGEX/flags'] [--tabwidth 'NUM'] [--goto 'NUM'] [-v] [--color] [-h|-?|--help] ['FILE']\n"
+    std::cout << "usage: few [--regex '/REGEX/flags']* [--filter 'EXPR'] [-A 'NUM'] [-B 'NUM'] [-C 'NUM'] [--cache-mem 'SIZE'] [-S] [--links 'MODE'] [--search '/REGEX/flags'] [--tabwidth 'NUM'] [--goto 'NUM'] [-v] [--color] [-h|-?|--help] ['FILE']\n"
 	      << "--regex     preset Display Regular Expression or Filter Regular Expression or Attribute Display Filter Regular Expression\n"
+	      << "--filter    preset filter expression combining the filter regular expressions, e.g. '(1|2)&!3'\n"
+	      << " -A         number of context lines after each filtered line\n"
+	      << " -B         number of context lines before each filtered line\n"
+	      << " -C         number of context lines before and after each filtered line\n"
+	      << "--cache-mem limit the memory of cached filter results, e.g. 2G\n"
+	      << " -S         chop long lines instead of wrapping them\n"
+	      << "--links     detect links and emails: off, click (default) or select\n"
 	      << "--search    preset search regular expression\n"
 	      << "--tabwidth  set the width of a tab character in spaces\n"
 	      << "--goto      go to a line number\n"
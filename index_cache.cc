@@ -0,0 +1,480 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+
+#include "index_cache.h"
+#include "getenv_str.h"
+#include "memorymap.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <direct.h>
+#include <process.h>
+#else
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+
+namespace {
+    /// the identity of a file.
+    struct file_id
+    {
+	uint64_t dev_;
+	uint64_t ino_;
+	uint64_t mtime_;
+    };
+
+    /// @return true if the identity of filename was found; false if filename can not be cached.
+    bool get_file_id(const std::string& filename, file_id& id)
+    {
+	struct stat buf;
+	if (stat(filename.c_str(), &buf) != 0) {
+	    return false;
+	}
+	id.dev_ = static_cast<uint64_t>(buf.st_dev);
+	id.ino_ = static_cast<uint64_t>(buf.st_ino);
+	id.mtime_ = static_cast<uint64_t>(buf.st_mtime);
+	// Windows does not have inode numbers
+	return id.ino_ != 0;
+    }
+
+    /// the first bytes of a cache file.
+    struct cache_header
+    {
+	char magic_[8];
+	uint64_t dev_;
+	uint64_t ino_;
+	/// size of the file in bytes.
+	uint64_t size_;
+	uint64_t mtime_;
+	/// checksum() of the file.
+	uint64_t checksum_;
+	/// number of cached lines.
+	uint64_t lines_;
+	/// number of bytes of the regular expression in a regex cache file.
+	uint64_t extra_;
+    };
+    static_assert(sizeof(cache_header) == 64, "cache_header must not have padding");
+
+    const char lines_magic[8] = { 'f', 'e', 'w', 'l', 'i', 'n', '1', '\n' };
+    const char regex_magic[8] = { 'f', 'e', 'w', 'r', 'g', 'x', '1', '\n' };
+
+    /// FNV-1a hash of [beg..end) continued from h.
+    uint64_t fnv1a(const char *beg, const char *end, uint64_t h = 14695981039346656037ull)
+    {
+	for(; beg != end; ++beg) {
+	    h ^= static_cast<unsigned char>(*beg);
+	    h *= 1099511628211ull;
+	}
+	return h;
+    }
+
+    /// number of blocks that checksum() samples.
+    const uint64_t sample_blocks = 16;
+    /// size of a sampled block.
+    const uint64_t sample_size = 4096;
+
+    /// @return a checksum of sampled blocks of the first size bytes at data, which includes the first and the last block.
+    uint64_t checksum(const char *data, uint64_t size)
+    {
+	if (size <= sample_blocks * sample_size) {
+	    return fnv1a(data, data + size);
+	}
+	uint64_t h = fnv1a(reinterpret_cast<const char*>(&size), reinterpret_cast<const char*>(&size + 1));
+	for(uint64_t i = 0; i < sample_blocks; ++i) {
+	    const uint64_t pos = (size - sample_size) / (sample_blocks - 1) * i;
+	    h = fnv1a(data + pos, data + pos + sample_size, h);
+	}
+	return h;
+    }
+
+    /// @return a header for fi.
+    cache_header make_header(const char *magic, const file_id& id, const file_index& fi, uint64_t lines, uint64_t extra)
+    {
+	cache_header h;
+	memcpy(h.magic_, magic, sizeof(h.magic_));
+	h.dev_ = id.dev_;
+	h.ino_ = id.ino_;
+	h.size_ = fi.bytes();
+	h.mtime_ = id.mtime_;
+	h.checksum_ = checksum(fi.data(), fi.bytes());
+	h.lines_ = lines;
+	h.extra_ = extra;
+	return h;
+    }
+
+    /**
+     * check if a cache file header describes fi or the start of fi.
+     * If the file has the same size it must also have the same modification time.
+     */
+    bool valid(const cache_header& h, const char *magic, const file_id& id, const file_index& fi)
+    {
+	if (memcmp(h.magic_, magic, sizeof(h.magic_)) != 0) {
+	    return false;
+	}
+	if (h.dev_ != id.dev_ || h.ino_ != id.ino_ || h.size_ > fi.bytes()) {
+	    return false;
+	}
+	if (h.size_ == fi.bytes() && h.mtime_ != id.mtime_) {
+	    return false;
+	}
+	return h.checksum_ == checksum(fi.data(), h.size_);
+    }
+
+    /// create dir and its parent directories. @return true if dir exists.
+    bool make_dirs(const std::string& dir)
+    {
+	for(size_t pos = 1; pos <= dir.size(); ++pos) {
+	    if (pos == dir.size() || dir[pos] == '/' || dir[pos] == '\\') {
+		const std::string d = dir.substr(0, pos);
+#if defined(_WIN32)
+		_mkdir(d.c_str());
+#else
+		mkdir(d.c_str(), 0700);
+#endif
+	    }
+	}
+	struct stat buf;
+	return stat(dir.c_str(), &buf) == 0;
+    }
+
+    /**
+     * write a cache file with write() into a temporary file, which is renamed to path when it is complete.
+     * @return true upon success.
+     */
+    bool write_cache_file(const std::string& dir, const std::string& path, const std::function<bool(FILE*)>& write)
+    {
+	if (path.empty() || ! make_dirs(dir)) {
+	    return false;
+	}
+	// each thread and each process use a different temporary file
+#if defined(_WIN32)
+	const int pid = _getpid();
+#else
+	const int pid = getpid();
+#endif
+	const std::string tmp = path + "." + std::to_string(pid) + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+	FILE *f = fopen(tmp.c_str(), "wb");
+	if (! f) {
+	    return false;
+	}
+	bool ok = write(f);
+	ok = (fclose(f) == 0) && ok;
+#if defined(_WIN32)
+	if (ok) {
+	    remove(path.c_str());
+	}
+#endif
+	if (! ok || rename(tmp.c_str(), path.c_str()) != 0) {
+	    remove(tmp.c_str());
+	    return false;
+	}
+	return true;
+    }
+
+    /// mark the cache file path as recently used.
+    void touch(const std::string& path)
+    {
+#if ! defined(_WIN32)
+	utime(path.c_str(), nullptr);
+#endif
+    }
+
+    /// @return true if s ends with suffix.
+    bool ends_with(const std::string& s, const char *suffix)
+    {
+	const size_t n = strlen(suffix);
+	return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+    }
+
+    /// @return a lower case hexadecimal string of h.
+    std::string hex(uint64_t h)
+    {
+	char buf[17];
+	snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(h));
+	return buf;
+    }
+}
+
+index_cache::index_cache(const std::string& dir, uint64_t max_bytes) :
+    dir_(dir),
+    max_bytes_(max_bytes)
+{
+}
+
+void
+index_cache::trim(const std::string& keep) const
+{
+#if defined(_WIN32)
+    // the cache is not used without inode numbers
+    (void) keep;
+#else
+    struct cache_file
+    {
+	std::string path_;
+	uint64_t size_;
+	time_t mtime_;
+    };
+    std::vector<cache_file> files;
+    uint64_t total = 0;
+    DIR *d = opendir(dir_.c_str());
+    if (! d) {
+	return;
+    }
+    const time_t now = time(nullptr);
+    while(struct dirent *e = readdir(d)) {
+	const std::string name = e->d_name;
+	const bool tmp = ends_with(name, ".tmp");
+	if (! tmp && ! ends_with(name, ".lines") && ! ends_with(name, ".regex")) {
+	    continue;
+	}
+	const std::string path = dir_ + "/" + name;
+	struct stat buf;
+	if (stat(path.c_str(), &buf) != 0 || ! S_ISREG(buf.st_mode)) {
+	    continue;
+	}
+	if (tmp) {
+	    // left behind by a process that was killed while writing
+	    if (now - buf.st_mtime > 24 * 60 * 60) {
+		remove(path.c_str());
+	    }
+	    continue;
+	}
+	total += buf.st_size;
+	if (path != keep) {
+	    files.push_back(cache_file { path, static_cast<uint64_t>(buf.st_size), buf.st_mtime });
+	}
+    }
+    closedir(d);
+
+    std::sort(files.begin(), files.end(), [](const cache_file& a, const cache_file& b) { return a.mtime_ < b.mtime_; });
+    for(const auto& f : files) {
+	if (total <= max_bytes_) {
+	    break;
+	}
+	if (remove(f.path_.c_str()) == 0) {
+	    total -= f.size_;
+	}
+    }
+#endif
+}
+
+std::string
+index_cache::default_dir()
+{
+    std::string dir;
+    if (getenv_str("FEWCACHE", dir)) {
+	return dir;
+    }
+#if defined(_WIN32)
+    if (getenv_str("LOCALAPPDATA", dir) && ! dir.empty()) {
+	return dir + "\\few";
+    }
+#else
+    if (getenv_str("XDG_CACHE_HOME", dir) && ! dir.empty()) {
+	return dir + "/few";
+    }
+    if (getenv_str("HOME", dir) && ! dir.empty()) {
+	return dir + "/.cache/few";
+    }
+#endif
+    return std::string();
+}
+
+line_number_t
+index_cache::complete_lines(const file_index& fi)
+{
+    line_number_t n = fi.size();
+    if (n > 0 && fi.parsed_line(n).next_ == nullptr) {
+	--n;
+    }
+    return n;
+}
+
+std::string
+index_cache::lines_path(const std::string& filename) const
+{
+    file_id id;
+    if (dir_.empty() || ! get_file_id(filename, id)) {
+	return std::string();
+    }
+    return dir_ + "/" + std::to_string(id.dev_) + "-" + std::to_string(id.ino_) + ".lines";
+}
+
+std::string
+index_cache::regex_path(const std::string& filename, const std::string& rgx) const
+{
+    file_id id;
+    if (dir_.empty() || ! get_file_id(filename, id)) {
+	return std::string();
+    }
+    return dir_ + "/" + std::to_string(id.dev_) + "-" + std::to_string(id.ino_) + "-" + hex(fnv1a(rgx.data(), rgx.data() + rgx.size())) + ".regex";
+}
+
+line_number_t
+index_cache::load_lines(const std::string& filename, file_index& fi) const
+{
+    file_id id;
+    const std::string path = lines_path(filename);
+    if (path.empty() || ! get_file_id(filename, id)) {
+	return 0;
+    }
+    struct stat buf;
+    if (stat(path.c_str(), &buf) != 0) {
+	return 0;
+    }
+    doj::memorymap_ptr<char> m(path);
+    if (m.size() < sizeof(cache_header)) {
+	return 0;
+    }
+    const cache_header& h = *reinterpret_cast<const cache_header*>(m.get());
+    if (! valid(h, lines_magic, id, fi)) {
+	return 0;
+    }
+    // the file contains the offsets of lines_ + 1 lines and the trailing characters of lines_ lines
+    if (h.lines_ == 0 || h.lines_ >= (1ull << 32) || m.size() != sizeof(cache_header) + (h.lines_ + 1) * sizeof(uint64_t) + h.lines_) {
+	return 0;
+    }
+    const uint64_t *beg = reinterpret_cast<const uint64_t*>(m.get() + sizeof(cache_header));
+    const uint8_t *trail = reinterpret_cast<const uint8_t*>(beg + h.lines_ + 1);
+    const line_number_t num = static_cast<line_number_t>(h.lines_);
+    if (! fi.restore_lines(beg, trail, num)) {
+	return 0;
+    }
+    touch(path);
+    return num;
+}
+
+bool
+index_cache::save_lines(const std::string& filename, const file_index& fi, const std::atomic<bool> *cancel) const
+{
+    file_id id;
+    const line_number_t num = complete_lines(fi);
+    if (num == 0 || ! get_file_id(filename, id)) {
+	return false;
+    }
+    // leave room for the line indexes of other files
+    const uint64_t bytes = sizeof(cache_header) + (num + uint64_t(1)) * sizeof(uint64_t) + num;
+    if (bytes > max_bytes_ / 2) {
+	return false;
+    }
+    const std::string path = lines_path(filename);
+    const bool ok = write_cache_file(dir_, path, [&](FILE *f) {
+	    if (cancel && *cancel) {
+		return false;
+	    }
+	    const cache_header h = make_header(lines_magic, id, fi, num, 0);
+	    if (fwrite(&h, sizeof(h), 1, f) != 1) {
+		return false;
+	    }
+	    std::vector<uint64_t> beg;
+	    beg.reserve(65536);
+	    for(line_number_t n = 1; n <= num; ++n) {
+		beg.push_back(fi.parsed_line(n).beg_ - fi.data());
+		if (n == num) {
+		    beg.push_back(fi.parsed_line(n).next_ - fi.data());
+		}
+		if (beg.size() >= 65536 || n == num) {
+		    if (fwrite(beg.data(), sizeof(uint64_t), beg.size(), f) != beg.size() || (cancel && *cancel)) {
+			return false;
+		    }
+		    beg.clear();
+		}
+	    }
+	    std::vector<uint8_t> trail;
+	    trail.reserve(65536);
+	    for(line_number_t n = 1; n <= num; ++n) {
+		const line_t& l = fi.parsed_line(n);
+		const ptrdiff_t t = l.next_ - l.end_;
+		trail.push_back((t < 256) ? static_cast<uint8_t>(t) : 0);
+		if (trail.size() >= 65536 || n == num) {
+		    if (fwrite(trail.data(), 1, trail.size(), f) != trail.size()) {
+			return false;
+		    }
+		    trail.clear();
+		}
+	    }
+	    return true;
+	});
+    if (ok) {
+	trim(path);
+    }
+    return ok;
+}
+
+std::shared_ptr<regex_index>
+index_cache::load_regex(const std::string& filename, const file_index& fi, const std::string& rgx) const
+{
+    file_id id;
+    const std::string path = regex_path(filename, rgx);
+    if (path.empty() || ! get_file_id(filename, id)) {
+	return nullptr;
+    }
+    struct stat buf;
+    if (stat(path.c_str(), &buf) != 0) {
+	return nullptr;
+    }
+    doj::memorymap_ptr<char> m(path);
+    if (m.size() < sizeof(cache_header)) {
+	return nullptr;
+    }
+    const cache_header& h = *reinterpret_cast<const cache_header*>(m.get());
+    if (! valid(h, regex_magic, id, fi)) {
+	return nullptr;
+    }
+    if (h.lines_ >= (1ull << 32) || h.extra_ != rgx.size() || m.size() < sizeof(cache_header) + h.extra_) {
+	return nullptr;
+    }
+    const char *data = m.get() + sizeof(cache_header);
+    if (rgx.compare(0, rgx.size(), data, h.extra_) != 0) {
+	return nullptr;
+    }
+    data += h.extra_;
+    line_set s;
+    if (! line_set::deserialize(data, m.get() + m.size() - data, s)) {
+	return nullptr;
+    }
+    touch(path);
+    return std::make_shared<regex_index>(rgx, std::move(s), static_cast<line_number_t>(h.lines_));
+}
+
+bool
+index_cache::save_regex(const std::string& filename, const file_index& fi, const std::string& rgx, const regex_index& ri, const std::atomic<bool> *cancel) const
+{
+    file_id id;
+    const line_number_t num = complete_lines(fi);
+    if (num == 0 || ! get_file_id(filename, id)) {
+	return false;
+    }
+    std::string data;
+    if (ri.lines().last() > num) {
+	// the last line can still grow, do not cache its match
+	std::vector<const line_set*> v = { &ri.lines() };
+	line_set::intersect(v, 1, num).serialize(data);
+    } else {
+	ri.lines().serialize(data);
+    }
+    const std::string path = regex_path(filename, rgx);
+    const bool ok = write_cache_file(dir_, path, [&](FILE *f) {
+	    if (cancel && *cancel) {
+		return false;
+	    }
+	    const cache_header h = make_header(regex_magic, id, fi, num, rgx.size());
+	    return fwrite(&h, sizeof(h), 1, f) == 1
+		&& fwrite(rgx.data(), 1, rgx.size(), f) == rgx.size()
+		&& fwrite(data.data(), 1, data.size(), f) == data.size();
+	});
+    if (ok) {
+	trim(path);
+    }
+    return ok;
+}
@@ -0,0 +1,126 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#pragma once
+#include "file_index.h"
+#include "regex_index.h"
+#include <atomic>
+#include <memory>
+#include <string>
+
+/**
+ * a persistent cache of the line index of files and of the matches of
+ * lines filters, so a file that is opened again does not need to be
+ * parsed and matched again.
+ *
+ * The cache directory contains one file with the line index of each
+ * cached file and one file with the matches of each lines filter.
+ * The cache files are named after the device and inode numbers of the
+ * file and contain the size, modification time and a checksum of
+ * sampled blocks of the file. A cache file is only used if the file
+ * is unchanged, or if the file has only grown: then the cached lines
+ * are restored and only the new lines are parsed and matched. The line
+ * index is stored as an array of 64 bit offsets, which is memory
+ * mapped when it is restored.
+ *
+ * Only complete lines, which end with a newline, are cached. A
+ * trailing line without newline may still grow.
+ *
+ * The cache directory is limited to max_bytes. When a cache file was
+ * written, the least recently used cache files are removed. A line
+ * index that alone is larger than half of max_bytes is not cached.
+ *
+ * The const functions can be called from background threads. A cache
+ * file is written to a temporary file first, which is renamed when it
+ * is complete, or removed if the writing is canceled.
+ */
+class index_cache
+{
+    /// the cache directory.
+    std::string dir_;
+    /// the maximum size of all cache files.
+    uint64_t max_bytes_;
+
+    /// remove the least recently used cache files until the cache files use at most max_bytes_. keep is never removed.
+    void trim(const std::string& keep) const;
+
+public:
+    /// the default maximum size of the cache directory.
+    static const uint64_t default_max_bytes = 4ull * 1024 * 1024 * 1024;
+
+    /**
+     * @param dir the cache directory, which is created when the first cache file is written.
+     * @param max_bytes the maximum size of all cache files.
+     */
+    explicit index_cache(const std::string& dir, uint64_t max_bytes = default_max_bytes);
+
+    /**
+     * @return the cache directory from the FEWCACHE environment variable,
+     *         or a "few" sub directory of the user's cache directory;
+     *         an empty string if the cache is disabled.
+     */
+    static std::string default_dir();
+
+    /// @return the number of lines of fi that end with a newline.
+    static line_number_t complete_lines(const file_index& fi);
+
+    /// @return the cache directory.
+    const std::string& dir() const { return dir_; }
+
+    /// @return the maximum size of all cache files.
+    uint64_t max_bytes() const { return max_bytes_; }
+
+    /**
+     * @param filename a file name.
+     * @return the name of the cache file with the line index of filename;
+     *         an empty string if filename can not be cached.
+     */
+    std::string lines_path(const std::string& filename) const;
+
+    /**
+     * @param filename a file name.
+     * @param rgx a (normalized) lines filter regular expression.
+     * @return the name of the cache file with the matches of rgx in filename;
+     *         an empty string if filename can not be cached.
+     */
+    std::string regex_path(const std::string& filename, const std::string& rgx) const;
+
+    /**
+     * restore the line index of fi from the cache.
+     * @param filename the file name of fi.
+     * @param fi a file_index that has not parsed any lines yet.
+     * @return the number of restored lines; 0 if the file is not cached or was changed.
+     */
+    line_number_t load_lines(const std::string& filename, file_index& fi) const;
+
+    /**
+     * write the line index of fi to the cache.
+     * @param filename the file name of fi.
+     * @param fi the file index, parse_all() must have been called before.
+     * @param cancel if not nullptr and set to true, the cache file is not written.
+     * @return true upon success.
+     */
+    bool save_lines(const std::string& filename, const file_index& fi, const std::atomic<bool> *cancel = nullptr) const;
+
+    /**
+     * restore the matches of a lines filter from the cache.
+     * @param filename the file name of fi.
+     * @param fi the file index.
+     * @param rgx a (normalized) lines filter regular expression.
+     * @return a regex_index whose restored() lines are matched; nullptr if rgx is not cached or the file was changed.
+     * @throws std::runtime_error if regular expression could not be parsed.
+     */
+    std::shared_ptr<regex_index> load_regex(const std::string& filename, const file_index& fi, const std::string& rgx) const;
+
+    /**
+     * write the matches of a lines filter to the cache.
+     * @param filename the file name of fi.
+     * @param fi the file index, parse_all() must have been called before.
+     * @param rgx a (normalized) lines filter regular expression.
+     * @param ri the regex_index of rgx, which has matched all lines of fi.
+     * @param cancel if not nullptr and set to true, the cache file is not written.
+     * @return true upon success.
+     */
+    bool save_regex(const std::string& filename, const file_index& fi, const std::string& rgx, const regex_index& ri, const std::atomic<bool> *cancel = nullptr) const;
+};
@@ -0,0 +1,187 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "gtest/gtest.h"
+#include "index_cache.h"
+#include "numbered_file_gtest.h"
+#include <cstdio>
+
+namespace {
+    /// a file with 100000 lines and a trailing line without newline, and a cache directory.
+    class index_cache_fix : public numbered_file_fix {
+    protected:
+	std::string dir_;
+	std::shared_ptr<index_cache> cache_;
+
+	virtual void SetUp()
+	{
+	    create(100000, [](unsigned u) { return std::string((u % 7) ? "" : " seven") + ((u % 3) ? "\n" : "\r\n"); });
+	    append("partial seven");
+	    dir_ = filename_ + ".cache";
+	    cache_ = std::make_shared<index_cache>(dir_);
+	}
+
+	virtual void TearDown()
+	{
+	    remove(cache_->lines_path(filename_).c_str());
+	    remove(cache_->regex_path(filename_, "/seven/").c_str());
+	    remove(dir_.c_str());
+	}
+
+	/// compare the lines of two file indexes of the same file.
+	void compare(const file_index& a, const file_index& b)
+	{
+	    ASSERT_EQ(a.size(), b.size());
+	    for(line_number_t n = 1; n <= a.size(); ++n) {
+		const line_t& l = a.parsed_line(n);
+		const line_t& m = b.parsed_line(n);
+		ASSERT_EQ(l.to_string(), m.to_string()) << n;
+		ASSERT_EQ(l.beg_ - a.data(), m.beg_ - b.data()) << n;
+		ASSERT_EQ(l.next_ == nullptr, m.next_ == nullptr) << n;
+		ASSERT_EQ(n, m.num_);
+	    }
+	}
+    };
+}
+
+TEST_F(index_cache_fix, lines_are_restored)
+{
+    file_index fi(filename_);
+    ASSERT_EQ(0u, cache_->load_lines(filename_, fi));
+    fi.parse_all();
+    ASSERT_EQ(100001u, fi.size());
+    ASSERT_EQ(100000u, index_cache::complete_lines(fi));
+    ASSERT_TRUE(cache_->save_lines(filename_, fi));
+
+    file_index fi2(filename_);
+    ASSERT_EQ(100000u, cache_->load_lines(filename_, fi2));
+    ASSERT_EQ(100000u, fi2.size());
+    // only the trailing line is parsed
+    fi2.parse_all();
+    compare(fi, fi2);
+}
+
+TEST_F(index_cache_fix, grown_file_is_extended)
+{
+    {
+	file_index fi(filename_);
+	fi.parse_all();
+	ASSERT_TRUE(cache_->save_lines(filename_, fi));
+    }
+    append(" line\nnew line\n");
+
+    file_index fi(filename_);
+    ASSERT_EQ(100000u, cache_->load_lines(filename_, fi));
+    fi.parse_all();
+    ASSERT_EQ(100002u, fi.size());
+    ASSERT_EQ("partial seven line", fi.parsed_line(100001).to_string());
+
+    file_index fresh(filename_);
+    fresh.parse_all();
+    compare(fresh, fi);
+}
+
+TEST_F(index_cache_fix, changed_file_is_parsed_again)
+{
+    {
+	file_index fi(filename_);
+	fi.parse_all();
+	ASSERT_TRUE(cache_->save_lines(filename_, fi));
+    }
+    // overwrite the first line with the same size
+    FILE *f = fopen(filename_.c_str(), "r+b");
+    ASSERT_TRUE(f != nullptr);
+    fputs("LINE", f);
+    fclose(f);
+
+    file_index fi(filename_);
+    ASSERT_EQ(0u, cache_->load_lines(filename_, fi));
+    fi.parse_all();
+    ASSERT_EQ("LINE 1", fi.parsed_line(1).to_string());
+}
+
+TEST_F(index_cache_fix, regex_matches_are_restored)
+{
+    file_index fi(filename_);
+    auto ri = std::make_shared<regex_index>("/seven/");
+    fi.parse_all(ri);
+    ASSERT_EQ(100001u, ri->lines().last());
+    ASSERT_TRUE(cache_->save_regex(filename_, fi, "/seven/", *ri));
+    ASSERT_TRUE(cache_->load_regex(filename_, fi, "/other/") == nullptr);
+
+    append(" line\nseven\nnew line\n");
+
+    file_index fi2(filename_);
+    auto ri2 = cache_->load_regex(filename_, fi2, "/seven/");
+    ASSERT_TRUE(ri2 != nullptr);
+    ASSERT_EQ(100000u, ri2->restored());
+    // the match of the trailing line is not cached, because it could change
+    ASSERT_EQ(100000u / 7, ri2->size());
+    fi2.parse_all(ri2);
+
+    file_index fresh(filename_);
+    auto expected = std::make_shared<regex_index>("/seven/");
+    fresh.parse_all(expected);
+    ASSERT_EQ(expected->lines(), ri2->lines());
+    ASSERT_EQ(100002u, ri2->lines().last());
+}
+
+TEST_F(index_cache_fix, background_match_starts_after_restored_lines)
+{
+    file_index fi(filename_);
+    auto ri = std::make_shared<regex_index>("/seven/");
+    fi.parse_all(ri);
+    ASSERT_TRUE(cache_->save_regex(filename_, fi, "/seven/", *ri));
+
+    auto ri2 = cache_->load_regex(filename_, fi, "/seven/");
+    ASSERT_TRUE(ri2 != nullptr);
+    ASSERT_TRUE(fi.parse_all_in_background(ri2, 0));
+    ASSERT_EQ(ri->lines(), ri2->lines());
+}
+
+TEST_F(index_cache_fix, least_recently_used_files_are_removed)
+{
+    file_index fi(filename_);
+    auto ri = std::make_shared<regex_index>("/seven/");
+    fi.parse_all(ri);
+    ASSERT_TRUE(cache_->save_lines(filename_, fi));
+
+    // the line index alone exceeds half of the size limit
+    index_cache small(dir_, 1000);
+    ASSERT_FALSE(small.save_lines(filename_, fi));
+    {
+	file_index fi2(filename_);
+	ASSERT_EQ(100000u, small.load_lines(filename_, fi2));
+    }
+
+    // the new file is kept and the older one is removed
+    ASSERT_TRUE(small.save_regex(filename_, fi, "/seven/", *ri));
+    ASSERT_TRUE(small.load_regex(filename_, fi, "/seven/") != nullptr);
+    file_index fi2(filename_);
+    ASSERT_EQ(0u, small.load_lines(filename_, fi2));
+}
+
+TEST_F(index_cache_fix, canceled_save_leaves_no_file)
+{
+    file_index fi(filename_);
+    auto ri = std::make_shared<regex_index>("/seven/");
+    fi.parse_all(ri);
+    std::atomic<bool> cancel(true);
+    ASSERT_FALSE(cache_->save_lines(filename_, fi, &cancel));
+    ASSERT_FALSE(cache_->save_regex(filename_, fi, "/seven/", *ri, &cancel));
+    file_index fi2(filename_);
+    ASSERT_EQ(0u, cache_->load_lines(filename_, fi2));
+    ASSERT_TRUE(cache_->load_regex(filename_, fi, "/seven/") == nullptr);
+}
+
+TEST(index_cache, disabled)
+{
+    index_cache c("");
+    file_index fi("README.md");
+    ASSERT_TRUE(c.lines_path("README.md").empty());
+    ASSERT_EQ(0u, c.load_lines("README.md", fi));
+    fi.parse_all();
+    ASSERT_FALSE(c.save_lines("README.md", fi));
+    ASSERT_TRUE(c.load_regex("README.md", fi, "/a/") == nullptr);
+}
@@ -26,10 +26,21 @@
 
 #pragma once
 #include <algorithm>
+#include <iterator>
+#include <type_traits>
 #include <vector>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define INTERSECT_SSE2 1
+#endif
 
+/**
+ * intersect sets by advancing each set linearly.
+ * This works with all forward iterators.
+ * @see multiple_set_intersect()
+ */
 template <typename PairIter, typename OutputIter>
-unsigned long long multiple_set_intersect(PairIter pair_begin, PairIter pair_end, OutputIter out)
+unsigned long long multiple_set_intersect_linear(PairIter pair_begin, PairIter pair_end, OutputIter out)
 {
     unsigned long long cnt = 0u;
     // if nothing was provided, there's nothing to do
@@ -88,3 +99,227 @@ unsigned long long multiple_set_intersect(PairIter pair_begin, PairIter pair_end
 
     return cnt;
 }
+
+namespace intersect_detail {
+    /**
+     * if the larger of two sets has more than gallop_ratio times the
+     * elements of the smaller set, galloping is faster than a merge.
+     */
+    const long gallop_ratio = 32;
+
+    /**
+     * exponential (galloping) search.
+     * @return the first iterator in [first,last) which is not less than value.
+     */
+    template <typename RandomIter, typename T>
+    RandomIter gallop_lower_bound(RandomIter first, RandomIter last, const T& value)
+    {
+	if (first == last || !(*first < value)) {
+	    return first;
+	}
+	// *first < value. double the step until we pass value.
+	typename std::iterator_traits<RandomIter>::difference_type step = 1;
+	RandomIter lo = first;
+	while (last - lo > step && *(lo + step) < value) {
+	    lo += step;
+	    step *= 2;
+	}
+	RandomIter hi = (last - lo > step) ? lo + step + 1 : last;
+	return std::lower_bound(lo + 1, hi, value);
+    }
+
+    /// true if Iter points into contiguous memory of 32 bit integers.
+    template <typename Iter>
+    struct is_simd_iterator
+    {
+	typedef typename std::iterator_traits<Iter>::value_type value_type;
+	typedef typename std::remove_cv<value_type>::type T;
+	static const bool value =
+	    std::is_integral<T>::value && sizeof(T) == 4 &&
+	    (std::is_pointer<Iter>::value ||
+	     std::is_same<Iter, typename std::vector<T>::iterator>::value ||
+	     std::is_same<Iter, typename std::vector<T>::const_iterator>::value);
+    };
+
+    /**
+     * intersect two sorted sets [a,a_end) and [b,b_end) by merging.
+     * If the elements are 32 bit integers in contiguous memory, blocks
+     * of 4 elements are compared with SIMD instructions.
+     */
+    template <typename Iter, typename OutputIter>
+    unsigned long long merge_intersect(Iter a, Iter a_end, Iter b, Iter b_end, OutputIter& out, std::false_type)
+    {
+	unsigned long long cnt = 0u;
+	while (a != a_end && b != b_end) {
+	    if (*a < *b) {
+		++a;
+	    } else if (*b < *a) {
+		++b;
+	    } else {
+		*out = *a;
+		++out;
+		++cnt;
+		++a;
+		++b;
+	    }
+	}
+	return cnt;
+    }
+
+    template <typename Iter, typename OutputIter>
+    unsigned long long merge_intersect(Iter a, Iter a_end, Iter b, Iter b_end, OutputIter& out, std::true_type)
+    {
+	unsigned long long cnt = 0u;
+#if INTERSECT_SSE2
+	while (a_end - a >= 4 && b_end - b >= 4) {
+	    const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&*a));
+	    const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&*b));
+	    // compare every element of va with every element of vb by rotating vb
+	    __m128i m = _mm_cmpeq_epi32(va, vb);
+	    m = _mm_or_si128(m, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0,3,2,1))));
+	    m = _mm_or_si128(m, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1,0,3,2))));
+	    m = _mm_or_si128(m, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2,1,0,3))));
+	    const int mask = _mm_movemask_ps(_mm_castsi128_ps(m));
+	    for(int i = 0; i < 4; ++i) {
+		if (mask & (1 << i)) {
+		    *out = a[i];
+		    ++out;
+		    ++cnt;
+		}
+	    }
+	    // advance the block with the smaller maximum, or both
+	    const auto a_max = a[3];
+	    const auto b_max = b[3];
+	    if (!(b_max < a_max)) {
+		a += 4;
+	    }
+	    if (!(a_max < b_max)) {
+		b += 4;
+	    }
+	}
+#endif
+	return cnt + merge_intersect(a, a_end, b, b_end, out, std::false_type());
+    }
+
+    /**
+     * iterate the set [first,last) and search its elements in all sets
+     * of [others_begin,others_end) with galloping search. If an
+     * element is missing in another set, the iteration gallops forward
+     * to the next element of that set.
+     */
+    template <typename Iter, typename PairIter, typename OutputIter>
+    unsigned long long gallop_intersect(Iter first, Iter last, PairIter others_begin, PairIter others_end, OutputIter& out)
+    {
+	unsigned long long cnt = 0u;
+	while (first != last) {
+	    const auto candidate = *first;
+	    bool all_equal = true;
+	    for(PairIter p = others_begin; p != others_end; ++p) {
+		p->first = gallop_lower_bound(p->first, p->second, candidate);
+		// if we've found the end of this set, we are done
+		if (p->first == p->second) {
+		    return cnt;
+		}
+		if (candidate < *(p->first)) {
+		    first = gallop_lower_bound(first, last, *(p->first));
+		    all_equal = false;
+		    break;
+		}
+	    }
+	    if (all_equal) {
+		*out = candidate;
+		++out;
+		++cnt;
+		++first;
+	    }
+	}
+	return cnt;
+    }
+
+    /**
+     * intersect sets with random access iterators.
+     * The sets are ordered by size, the smallest set is iterated and
+     * the other sets are searched with galloping search. Two sets of
+     * similar size are merged.
+     */
+    template <typename PairIter, typename OutputIter>
+    unsigned long long adaptive_intersect(PairIter pair_begin, PairIter pair_end, OutputIter out)
+    {
+	typedef typename std::iterator_traits<PairIter>::value_type pair_t;
+	typedef typename pair_t::first_type iter_t;
+	typedef typename std::remove_cv<typename std::iterator_traits<iter_t>::value_type>::type value_t;
+
+	std::vector<pair_t> s(pair_begin, pair_end);
+	if (s.empty()) {
+	    return 0u;
+	}
+	std::sort(s.begin(), s.end(), [](const pair_t& l, const pair_t& r) { return (l.second - l.first) < (r.second - r.first); });
+
+	unsigned long long cnt = 0u;
+	if (s.size() == 1) {
+	    for(iter_t i = s[0].first; i != s[0].second; ++i) {
+		*out = *i;
+		++out;
+		++cnt;
+	    }
+	    return cnt;
+	}
+	if (s[0].first == s[0].second) {
+	    return 0u;
+	}
+
+	// merge the two smallest sets if they have a similar size
+	const auto n0 = s[0].second - s[0].first;
+	const auto n1 = s[1].second - s[1].first;
+	if (n1 / n0 < gallop_ratio) {
+	    typedef std::integral_constant<bool, is_simd_iterator<iter_t>::value> simd_t;
+	    if (s.size() == 2) {
+		return merge_intersect(s[0].first, s[0].second, s[1].first, s[1].second, out, simd_t());
+	    }
+	    // the result of the merge is the new smallest set
+	    std::vector<value_t> tmp;
+	    auto o = std::back_inserter(tmp);
+	    merge_intersect(s[0].first, s[0].second, s[1].first, s[1].second, o, simd_t());
+	    return gallop_intersect(tmp.cbegin(), tmp.cend(), s.begin() + 2, s.end(), out);
+	}
+
+	return gallop_intersect(s[0].first, s[0].second, s.begin() + 1, s.end(), out);
+    }
+
+    template <typename PairIter, typename OutputIter>
+    unsigned long long dispatch(PairIter pair_begin, PairIter pair_end, OutputIter out, std::random_access_iterator_tag)
+    {
+	return adaptive_intersect(pair_begin, pair_end, out);
+    }
+
+    template <typename PairIter, typename OutputIter>
+    unsigned long long dispatch(PairIter pair_begin, PairIter pair_end, OutputIter out, std::input_iterator_tag)
+    {
+	return multiple_set_intersect_linear(pair_begin, pair_end, out);
+    }
+}
+
+/**
+ * intersect sorted sets.
+ * Each set is described by a pair of iterators [first,second). The
+ * iterators of the pairs may be advanced by this function.
+ *
+ * Sets with random access iterators are intersected adaptively:
+ * the smallest set is iterated and the larger sets are searched with
+ * galloping search, sets of similar size are merged (with SIMD
+ * instructions for 32 bit integers). Sets with other iterators are
+ * intersected linearly.
+ *
+ * @param pair_begin first pair of iterators.
+ * @param pair_end one past the last pair of iterators.
+ * @param out output iterator which receives the intersection in ascending order.
+ * @return number of elements written to out.
+ */
+template <typename PairIter, typename OutputIter>
+unsigned long long multiple_set_intersect(PairIter pair_begin, PairIter pair_end, OutputIter out)
+{
+    typedef typename std::iterator_traits<PairIter>::value_type pair_t;
+    typedef typename pair_t::first_type iter_t;
+    typedef typename std::iterator_traits<iter_t>::iterator_category category_t;
+    return intersect_detail::dispatch(pair_begin, pair_end, out, category_t());
+}
@@ -0,0 +1,83 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+
+#include "gtest/gtest.h"
+#include "intersect.h"
+#include "timeGetTime.h"
+#include <random>
+#include <iostream>
+#include <cstdint>
+
+namespace {
+    typedef std::vector<uint32_t> container_t;
+    typedef std::pair<container_t::const_iterator, container_t::const_iterator> pair_t;
+
+    /// create n sorted unique random numbers in [1..max].
+    container_t random_set(unsigned seed, size_t n, uint32_t max)
+    {
+	std::mt19937 gen(seed);
+	std::uniform_int_distribution<uint32_t> d(1, max);
+	container_t c;
+	c.reserve(n);
+	for(size_t i = 0; i < n; ++i) {
+	    c.push_back(d(gen));
+	}
+	std::sort(c.begin(), c.end());
+	c.erase(std::unique(c.begin(), c.end()), c.end());
+	return c;
+    }
+
+    std::vector<pair_t> pairs(const std::vector<container_t>& sets)
+    {
+	std::vector<pair_t> v;
+	for(const auto& s : sets) {
+	    v.push_back(std::make_pair(s.begin(), s.end()));
+	}
+	return v;
+    }
+
+    /// run the linear and the adaptive intersection on sets and print the time.
+    void bench(const std::string& name, const std::vector<container_t>& sets)
+    {
+	container_t out_linear, out_adaptive;
+
+	auto v = pairs(sets);
+	uint32_t t = timeGetTime();
+	multiple_set_intersect_linear(v.begin(), v.end(), std::back_inserter(out_linear));
+	const uint32_t linear_ms = timeGetTime() - t;
+
+	v = pairs(sets);
+	t = timeGetTime();
+	multiple_set_intersect(v.begin(), v.end(), std::back_inserter(out_adaptive));
+	const uint32_t adaptive_ms = timeGetTime() - t;
+
+	ASSERT_EQ(out_linear, out_adaptive);
+	std::clog << name << ": linear " << linear_ms << " ms, adaptive " << adaptive_ms << " ms, " << out_adaptive.size() << " results" << std::endl;
+    }
+}
+
+TEST(intersect_bench, skewed_10_vs_50M)
+{
+    std::vector<container_t> sets = { random_set(1, 10, 100000000), random_set(2, 50000000, 100000000) };
+    bench("10 vs 50M", sets);
+}
+
+TEST(intersect_bench, skewed_1000_vs_10M_vs_50M)
+{
+    std::vector<container_t> sets = { random_set(3, 1000, 100000000), random_set(4, 10000000, 100000000), random_set(5, 50000000, 100000000) };
+    bench("1000 vs 10M vs 50M", sets);
+}
+
+TEST(intersect_bench, balanced_20M_vs_20M)
+{
+    std::vector<container_t> sets = { random_set(6, 20000000, 40000000), random_set(7, 20000000, 40000000) };
+    bench("20M vs 20M", sets);
+}
+
+TEST(intersect_bench, balanced_3_sets_of_10M)
+{
+    std::vector<container_t> sets = { random_set(8, 10000000, 20000000), random_set(9, 10000000, 20000000), random_set(10, 10000000, 20000000) };
+    bench("3x 10M", sets);
+}
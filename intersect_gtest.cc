@@ -150,3 +150,88 @@ namespace multiple_set_intersect_test2 {
 	ASSERT_EQ(std::string("3"), *(out.begin()));
     }
 }
+
+#include <random>
+#include <cstdint>
+namespace multiple_set_intersect_test3 {
+    typedef std::vector<uint32_t> container_t;
+    typedef std::pair<container_t::const_iterator, container_t::const_iterator> pair_t;
+
+    /// create n sorted random numbers in [1..max].
+    container_t random_set(unsigned seed, size_t n, uint32_t max)
+    {
+	std::mt19937 gen(seed);
+	std::uniform_int_distribution<uint32_t> d(1, max);
+	container_t c;
+	for(size_t i = 0; i < n; ++i) {
+	    c.push_back(d(gen));
+	}
+	std::sort(c.begin(), c.end());
+	c.erase(std::unique(c.begin(), c.end()), c.end());
+	return c;
+    }
+
+    container_t expected_intersection(const std::vector<container_t>& sets)
+    {
+	container_t r = sets[0];
+	for(size_t i = 1; i < sets.size(); ++i) {
+	    container_t t;
+	    std::set_intersection(r.begin(), r.end(), sets[i].begin(), sets[i].end(), std::back_inserter(t));
+	    r.swap(t);
+	}
+	return r;
+    }
+
+    container_t intersect(const std::vector<container_t>& sets)
+    {
+	std::vector<pair_t> v;
+	for(const auto& s : sets) {
+	    v.push_back(std::make_pair(s.begin(), s.end()));
+	}
+	container_t out;
+	const unsigned long long cnt = multiple_set_intersect(v.begin(), v.end(), std::back_inserter(out));
+	EXPECT_EQ(out.size(), cnt);
+	return out;
+    }
+
+    TEST(multiple_set_intersect, skewed_sets_use_galloping)
+    {
+	std::vector<container_t> sets = { random_set(1, 10, 1000000), random_set(2, 900000, 1000000) };
+	// make sure some elements of the small set are found
+	sets[1].insert(sets[1].end(), sets[0].begin(), sets[0].end());
+	std::sort(sets[1].begin(), sets[1].end());
+	sets[1].erase(std::unique(sets[1].begin(), sets[1].end()), sets[1].end());
+	const container_t out = intersect(sets);
+	ASSERT_EQ(sets[0], out);
+    }
+
+    TEST(multiple_set_intersect, balanced_sets_use_merge)
+    {
+	for(unsigned seed = 0; seed < 10; ++seed) {
+	    std::vector<container_t> sets = { random_set(seed, 1000 + seed, 3000), random_set(seed + 100, 1500, 3000) };
+	    ASSERT_EQ(expected_intersection(sets), intersect(sets));
+	}
+    }
+
+    TEST(multiple_set_intersect, random_sets_of_mixed_sizes)
+    {
+	for(unsigned seed = 0; seed < 20; ++seed) {
+	    std::vector<container_t> sets;
+	    for(unsigned k = 0; k < 2 + seed % 3; ++k) {
+		sets.push_back(random_set(seed * 7 + k, 1u << ((seed + k * 5) % 16), 100000));
+	    }
+	    ASSERT_EQ(expected_intersection(sets), intersect(sets));
+	}
+    }
+
+    TEST(multiple_set_intersect, with_pointers)
+    {
+	const int a[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+	const int b[] = { 2, 4, 6, 8, 10, 12 };
+	std::vector<std::pair<const int*, const int*>> v = { std::make_pair(a, a + 9), std::make_pair(b, b + 6) };
+	std::vector<int> out;
+	ASSERT_EQ(4u, multiple_set_intersect(v.begin(), v.end(), std::back_inserter(out)));
+	std::vector<int> expected = { 2, 4, 6, 8 };
+	ASSERT_EQ(expected, out);
+    }
+}
@@ -0,0 +1,147 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+
+#include "line_layout.h"
+#include <cassert>
+
+int
+digits(uint64_t i)
+{
+    if (i < 10llu) return 1;
+    if (i < 100llu) return 2;
+    if (i < 1000llu) return 3;
+    if (i < 10000llu) return 4;
+    if (i < 100000llu) return 5;
+    if (i < 1000000llu) return 6;
+    if (i < 10000000llu) return 7;
+    if (i < 100000000llu) return 8;
+    if (i < 1000000000llu) return 9;
+    if (i < 10000000000llu) return 10;
+    if (i < 100000000000llu) return 11;
+    if (i < 1000000000000llu) return 12;
+    if (i < 10000000000000llu) return 13;
+    if (i < 100000000000000llu) return 14;
+    if (i < 1000000000000000llu) return 15;
+    if (i < 10000000000000000llu) return 16;
+    if (i < 100000000000000000llu) return 17;
+    if (i < 1000000000000000000llu) return 18;
+    if (i < 10000000000000000000llu) return 19;
+    return 20;
+}
+
+line_layout::line_layout(size_t max_entries) :
+    screen_width_(0),
+    tab_width_(0),
+    generation_(0),
+    wrap_(true),
+    max_entries_(max_entries)
+{ }
+
+unsigned
+line_layout::prefix_width(line_number_t n, unsigned tab_width)
+{
+    unsigned w = digits(n);
+    if (w < tab_width) {
+	w = tab_width;
+    }
+    if (w < 8) {
+	w = 8;
+    }
+    return w;
+}
+
+unsigned
+line_layout::rows(const std::wstring& s, unsigned prefix_width, unsigned screen_width, unsigned tab_width)
+{
+    assert(tab_width > 0);
+    // the line number column fills the screen, no text is displayed
+    if (prefix_width >= screen_width) {
+	return 1;
+    }
+    unsigned r = 0;
+    size_t i = 0;
+    do {
+	unsigned x = prefix_width;
+	for(; i < s.size() && x < screen_width; ++i) {
+	    if (s[i] == '\t') {
+		do {
+		    ++x;
+		} while (x % tab_width);
+	    } else {
+		++x;
+	    }
+	}
+	++r;
+    } while (i < s.size());
+    return r;
+}
+
+void
+line_layout::configure(unsigned screen_width, unsigned tab_width, unsigned generation, bool wrap)
+{
+    if (screen_width != screen_width_ || tab_width != tab_width_ || generation != generation_ || wrap != wrap_) {
+	rows_.clear();
+	screen_width_ = screen_width;
+	tab_width_ = tab_width;
+	generation_ = generation;
+	wrap_ = wrap;
+    }
+}
+
+unsigned
+line_layout::rows(line_number_t n, const text_func_t& text)
+{
+    if (! wrap_) {
+	return 1;
+    }
+    auto i = rows_.find(n);
+    if (i != rows_.end()) {
+	return i->second;
+    }
+    if (rows_.size() >= max_entries_) {
+	rows_.clear();
+    }
+    const unsigned r = rows(text(n), prefix_width(n, tab_width_), screen_width_, tab_width_);
+    rows_.emplace(n, r);
+    return r;
+}
+
+unsigned
+line_layout::rows_between(line_number_t p, line_number_t n, bool separators, const text_func_t& text)
+{
+    unsigned r = rows(p, text);
+    if (separators && p + 1 != n) {
+	++r;
+    }
+    return r;
+}
+
+line_number_t
+line_layout::top_above(const display_set& s, line_number_t n, unsigned max_rows, bool separators, const text_func_t& text)
+{
+    line_number_t top = n, p;
+    unsigned used = 0;
+    while (s.prev(top, p)) {
+	const unsigned r = rows_between(p, top, separators, text);
+	if (used + r > max_rows) {
+	    break;
+	}
+	used += r;
+	top = p;
+    }
+    return top;
+}
+
+line_number_t
+line_layout::top_covering(const display_set& s, line_number_t n, unsigned min_rows, bool separators, const text_func_t& text)
+{
+    line_number_t top = n, p;
+    unsigned used = 0;
+    while (used < min_rows && s.prev(top, p)) {
+	used += rows_between(p, top, separators, text);
+	top = p;
+    }
+    return top;
+}
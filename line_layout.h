@@ -0,0 +1,87 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#pragma once
+#include "display_set.h"
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+/// @return number of decimal digits in i.
+int digits(uint64_t i);
+
+/**
+ * compute how many screen rows the displayed lines occupy.
+ *
+ * A line is wrapped at the screen width. Every row starts after the
+ * line number column and tab characters advance to the next multiple
+ * of the tab width, like the lines window renders them. The number of
+ * rows is cached per line number, so paging can compute a new top line
+ * without rendering the lines window repeatedly.
+ */
+class line_layout
+{
+public:
+    /// function that returns the displayed text of a line number.
+    typedef std::function<std::wstring(line_number_t)> text_func_t;
+
+private:
+    unsigned screen_width_;
+    unsigned tab_width_;
+    unsigned generation_;
+    bool wrap_;
+    size_t max_entries_;
+    std::unordered_map<line_number_t, unsigned> rows_;
+
+    /// @return the number of rows between line p and the following line n, including a separator row.
+    unsigned rows_between(line_number_t p, line_number_t n, bool separators, const text_func_t& text);
+
+public:
+    /// @param max_entries maximum number of cached lines.
+    explicit line_layout(size_t max_entries = 65536);
+
+    /// @return the width of the line number column for line number n.
+    static unsigned prefix_width(line_number_t n, unsigned tab_width);
+
+    /**
+     * @param s displayed text of a line.
+     * @param prefix_width width of the line number column.
+     * @return the number of screen rows to display s, at least 1.
+     */
+    static unsigned rows(const std::wstring& s, unsigned prefix_width, unsigned screen_width, unsigned tab_width);
+
+    /**
+     * set the parameters of the layout.
+     * The cache is cleared if a parameter changed.
+     * @param generation changes if the displayed text of lines changed, e.g. by a replace display filter.
+     * @param wrap true if long lines are wrapped; false if every line takes a single row.
+     */
+    void configure(unsigned screen_width, unsigned tab_width, unsigned generation, bool wrap = true);
+
+    /// @return the number of screen rows of line number n.
+    unsigned rows(line_number_t n, const text_func_t& text);
+
+    /**
+     * find the top line of a display that shows the lines above n.
+     * @param s displayed lines.
+     * @param n a line number of s.
+     * @param max_rows number of screen rows above n.
+     * @param separators true if a separator row is displayed between lines that are not consecutive.
+     * @param text function to get the displayed text of a line.
+     * @return the smallest line number of s, such that the lines from it
+     *         up to, but excluding n fit into max_rows; n if there is no room.
+     */
+    line_number_t top_above(const display_set& s, line_number_t n, unsigned max_rows, bool separators, const text_func_t& text);
+
+    /**
+     * find the top line of a display where the lines above n fill at least min_rows.
+     * @return the largest line number of s, such that the lines from it up to,
+     *         but excluding n take at least min_rows; the first line of s if
+     *         all lines above n take fewer rows.
+     */
+    line_number_t top_covering(const display_set& s, line_number_t n, unsigned min_rows, bool separators, const text_func_t& text);
+
+    /// @return the number of cached lines.
+    size_t size() const { return rows_.size(); }
+};
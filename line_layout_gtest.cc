@@ -0,0 +1,117 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+
+#include "gtest/gtest.h"
+#include "line_layout.h"
+
+TEST(line_layout, digits)
+{
+    ASSERT_EQ(1, digits(0));
+    ASSERT_EQ(1, digits(9));
+    ASSERT_EQ(2, digits(10));
+    ASSERT_EQ(10, digits(4294967295u));
+    ASSERT_EQ(20, digits(18446744073709551615llu));
+}
+
+TEST(line_layout, prefix_width)
+{
+    ASSERT_EQ(8u, line_layout::prefix_width(1, 4));
+    ASSERT_EQ(10u, line_layout::prefix_width(1, 10));
+    ASSERT_EQ(9u, line_layout::prefix_width(123456789, 8));
+}
+
+TEST(line_layout, rows)
+{
+    // 12 columns for text on each row
+    ASSERT_EQ(1u, line_layout::rows(L"", 8, 20, 8));
+    ASSERT_EQ(1u, line_layout::rows(L"a", 8, 20, 8));
+    ASSERT_EQ(1u, line_layout::rows(std::wstring(12, 'a'), 8, 20, 8));
+    ASSERT_EQ(2u, line_layout::rows(std::wstring(13, 'a'), 8, 20, 8));
+    ASSERT_EQ(3u, line_layout::rows(std::wstring(36, 'a'), 8, 20, 8));
+    ASSERT_EQ(4u, line_layout::rows(std::wstring(37, 'a'), 8, 20, 8));
+    // a tab advances to column 16, the next tab beyond the screen width
+    ASSERT_EQ(1u, line_layout::rows(L"\t\t", 8, 20, 8));
+    ASSERT_EQ(2u, line_layout::rows(L"\t\ta", 8, 20, 8));
+    // no room for text
+    ASSERT_EQ(1u, line_layout::rows(L"abc", 20, 20, 8));
+}
+
+namespace {
+    /// line n has n*10 characters.
+    std::wstring text(line_number_t n)
+    {
+	return std::wstring(n * 10, 'x');
+    }
+}
+
+TEST(line_layout, top_above)
+{
+    // 12 text columns per row
+    line_layout l;
+    l.configure(20, 8, 0);
+    ASSERT_EQ(1u, l.rows(1, text));
+    ASSERT_EQ(2u, l.rows(2, text));
+    ASSERT_EQ(4u, l.rows(4, text));
+    ASSERT_EQ(3u, l.size());
+
+    identity_display s([]() { return 10u; });
+    // line 4 and 3 take 7 rows above 5
+    ASSERT_EQ(4u, l.top_above(s, 5, 6, false, text));
+    ASSERT_EQ(3u, l.top_above(s, 5, 7, false, text));
+    ASSERT_EQ(3u, l.top_above(s, 5, 8, false, text));
+    ASSERT_EQ(2u, l.top_above(s, 5, 9, false, text));
+    ASSERT_EQ(1u, l.top_above(s, 5, 100, false, text));
+    ASSERT_EQ(5u, l.top_above(s, 5, 3, false, text));
+
+    // separators take a row between groups of lines
+    line_set g;
+    g.push_back(1);
+    g.push_back(3);
+    g.push_back(4);
+    line_set_display d(std::move(g));
+    ASSERT_EQ(3u, l.top_above(d, 4, 3, true, text));
+    ASSERT_EQ(3u, l.top_above(d, 4, 4, true, text));
+    ASSERT_EQ(1u, l.top_above(d, 4, 5, true, text));
+    ASSERT_EQ(1u, l.top_above(d, 4, 4, false, text));
+}
+
+TEST(line_layout, configure_clears_the_cache)
+{
+    line_layout l;
+    l.configure(20, 8, 0);
+    ASSERT_EQ(2u, l.rows(2, text));
+    l.configure(20, 8, 0);
+    ASSERT_EQ(1u, l.size());
+    l.configure(40, 8, 0);
+    ASSERT_EQ(0u, l.size());
+    ASSERT_EQ(1u, l.rows(2, text));
+    l.configure(40, 8, 1);
+    ASSERT_EQ(0u, l.size());
+}
+
+TEST(line_layout, no_wrap)
+{
+    line_layout l;
+    l.configure(20, 8, 0, false);
+    ASSERT_EQ(1u, l.rows(4, text));
+    identity_display s([]() { return 10u; });
+    ASSERT_EQ(2u, l.top_above(s, 5, 3, false, text));
+    ASSERT_EQ(4u, l.top_covering(s, 5, 1, false, text));
+    l.configure(20, 8, 0, true);
+    ASSERT_EQ(4u, l.rows(4, text));
+}
+
+TEST(line_layout, top_covering)
+{
+    line_layout l;
+    l.configure(20, 8, 0);
+    identity_display s([]() { return 10u; });
+    // line 4 takes 4 rows, line 3 takes 3 rows
+    ASSERT_EQ(5u, l.top_covering(s, 5, 0, false, text));
+    ASSERT_EQ(4u, l.top_covering(s, 5, 1, false, text));
+    ASSERT_EQ(4u, l.top_covering(s, 5, 4, false, text));
+    ASSERT_EQ(3u, l.top_covering(s, 5, 5, false, text));
+    ASSERT_EQ(1u, l.top_covering(s, 5, 100, false, text));
+}
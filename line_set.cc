@@ -0,0 +1,1314 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "line_set.h"
+#include "intersect.h"
+#include <algorithm>
+#include <cassert>
+
+namespace {
+    typedef line_set::chunk chunk_t;
+
+    /// maximum number of values in an array chunk.
+    const uint32_t max_array_card = 4096;
+    /// number of 64 bit words in a bitmap chunk.
+    const uint32_t bitmap_words = 65536 / 64;
+
+    /// a run of values [b..e] inside a chunk.
+    typedef std::pair<uint32_t, uint32_t> run_t;
+    typedef std::vector<run_t> runs_t;
+
+    uint32_t low(line_number_t n) { return n & 0xFFFF; }
+    uint16_t high(line_number_t n) { return static_cast<uint16_t>(n >> 16); }
+
+    void set_bit(std::vector<uint64_t>& b, uint32_t v)
+    {
+	b[v >> 6] |= uint64_t(1) << (v & 63);
+    }
+
+    bool test_bit(const std::vector<uint64_t>& b, uint32_t v)
+    {
+	return (b[v >> 6] >> (v & 63)) & 1;
+    }
+
+    /// @return number of runs of set bits in the bitmap.
+    uint32_t count_runs(const std::vector<uint64_t>& b)
+    {
+	uint32_t runs = 0;
+	uint64_t carry = 0;
+	for(auto w : b) {
+	    // a run starts at every set bit whose lower neighbor is not set
+	    runs += popcount64(w & ~((w << 1) | carry));
+	    carry = w >> 63;
+	}
+	return runs;
+    }
+
+    /// fill a bitmap with all values of c.
+    void to_bitmap(const chunk_t& c, std::vector<uint64_t>& b)
+    {
+	if (c.type_ == line_set::bitmap_chunk) {
+	    b = c.b_;
+	    return;
+	}
+	b.assign(bitmap_words, 0);
+	if (c.type_ == line_set::array_chunk) {
+	    for(auto v : c.a_) {
+		set_bit(b, v);
+	    }
+	    return;
+	}
+	assert(c.type_ == line_set::run_chunk);
+	for(size_t i = 0; i < c.a_.size(); i += 2) {
+	    uint32_t v = c.a_[i];
+	    const uint32_t e = v + c.a_[i+1];
+	    // set single bits until word aligned, then full words
+	    for(; v <= e && (v & 63); ++v) {
+		set_bit(b, v);
+	    }
+	    for(; v + 63 <= e; v += 64) {
+		b[v >> 6] = ~uint64_t(0);
+	    }
+	    for(; v <= e; ++v) {
+		set_bit(b, v);
+	    }
+	}
+    }
+
+    /// fill a vector with the runs of c.
+    void to_runs(const chunk_t& c, runs_t& r)
+    {
+	r.clear();
+	auto add = [&r](uint32_t b, uint32_t e) {
+	    if (!r.empty() && r.back().second + 1 == b) {
+		r.back().second = e;
+	    } else {
+		r.push_back(run_t(b, e));
+	    }
+	};
+	if (c.type_ == line_set::run_chunk) {
+	    for(size_t i = 0; i < c.a_.size(); i += 2) {
+		add(c.a_[i], c.a_[i] + c.a_[i+1]);
+	    }
+	} else if (c.type_ == line_set::array_chunk) {
+	    for(auto v : c.a_) {
+		add(v, v);
+	    }
+	} else {
+	    for(uint32_t w = 0; w < bitmap_words; ++w) {
+		uint64_t word = c.b_[w];
+		while (word) {
+		    const uint32_t bit = ctz64(word);
+		    add(w * 64 + bit, w * 64 + bit);
+		    word &= word - 1;
+		}
+	    }
+	}
+    }
+
+    /// fill a vector with all values of c, which must not be a bitmap chunk.
+    void to_array(const chunk_t& c, std::vector<uint16_t>& a)
+    {
+	if (c.type_ == line_set::array_chunk) {
+	    a = c.a_;
+	    return;
+	}
+	a.clear();
+	a.reserve(c.card_);
+	if (c.type_ == line_set::run_chunk) {
+	    for(size_t i = 0; i < c.a_.size(); i += 2) {
+		const uint32_t e = c.a_[i] + c.a_[i+1];
+		for(uint32_t v = c.a_[i]; v <= e; ++v) {
+		    a.push_back(static_cast<uint16_t>(v));
+		}
+	    }
+	} else {
+	    for(uint32_t w = 0; w < bitmap_words; ++w) {
+		uint64_t word = c.b_[w];
+		while (word) {
+		    a.push_back(static_cast<uint16_t>(w * 64 + ctz64(word)));
+		    word &= word - 1;
+		}
+	    }
+	}
+    }
+
+    /// @return the number of bytes used by the values of c if converted to type t.
+    uint32_t bytes(uint32_t card, uint32_t runs, line_set::chunk_type t)
+    {
+	switch(t) {
+	case line_set::array_chunk: return card * 2;
+	case line_set::bitmap_chunk: return bitmap_words * 8;
+	case line_set::run_chunk: return runs * 4;
+	}
+	return 0;
+    }
+
+    /// @return the smallest representation for a chunk.
+    line_set::chunk_type best_type(uint32_t card, uint32_t runs)
+    {
+	line_set::chunk_type t = (card <= max_array_card) ? line_set::array_chunk : line_set::bitmap_chunk;
+	if (bytes(card, runs, line_set::run_chunk) < bytes(card, runs, t)) {
+	    t = line_set::run_chunk;
+	}
+	return t;
+    }
+
+    void assign_runs(chunk_t& c, const runs_t& r)
+    {
+	c.type_ = line_set::run_chunk;
+	c.b_.clear(); c.b_.shrink_to_fit();
+	c.a_.clear();
+	c.a_.reserve(r.size() * 2);
+	for(const auto& i : r) {
+	    c.a_.push_back(static_cast<uint16_t>(i.first));
+	    c.a_.push_back(static_cast<uint16_t>(i.second - i.first));
+	}
+    }
+
+    /// convert c into its smallest representation.
+    void optimize_chunk(chunk_t& c)
+    {
+	uint32_t runs = 0;
+	if (c.type_ == line_set::bitmap_chunk) {
+	    runs = count_runs(c.b_);
+	} else if (c.type_ == line_set::run_chunk) {
+	    runs = c.a_.size() / 2;
+	} else {
+	    for(size_t i = 0; i < c.a_.size(); ++i) {
+		if (i == 0 || c.a_[i-1] + 1 != c.a_[i]) {
+		    ++runs;
+		}
+	    }
+	}
+	const line_set::chunk_type t = best_type(c.card_, runs);
+	if (t == c.type_) {
+	    c.a_.shrink_to_fit();
+	    return;
+	}
+	if (t == line_set::run_chunk) {
+	    runs_t r;
+	    to_runs(c, r);
+	    assign_runs(c, r);
+	} else if (t == line_set::bitmap_chunk) {
+	    to_bitmap(c, c.b_);
+	    c.a_.clear();
+	} else {
+	    std::vector<uint16_t> a;
+	    to_array(c, a);
+	    c.a_.swap(a);
+	    c.b_.clear();
+	}
+	c.type_ = t;
+	c.a_.shrink_to_fit();
+	c.b_.shrink_to_fit();
+    }
+
+    /// create a chunk from a bitmap. @return false if the bitmap is empty.
+    bool from_bitmap(uint16_t key, std::vector<uint64_t>& b, chunk_t& c)
+    {
+	uint32_t card = 0;
+	for(auto w : b) {
+	    card += popcount64(w);
+	}
+	if (card == 0) {
+	    return false;
+	}
+	c.key_ = key;
+	c.card_ = card;
+	c.type_ = line_set::bitmap_chunk;
+	c.a_.clear();
+	c.b_.swap(b);
+	optimize_chunk(c);
+	return true;
+    }
+
+    /// create a chunk from a sorted array. @return false if the array is empty.
+    bool from_array(uint16_t key, std::vector<uint16_t>& a, chunk_t& c)
+    {
+	if (a.empty()) {
+	    return false;
+	}
+	c.key_ = key;
+	c.card_ = a.size();
+	c.type_ = line_set::array_chunk;
+	c.b_.clear();
+	c.a_.swap(a);
+	if (c.card_ > max_array_card) {
+	    to_bitmap(c, c.b_);
+	    c.type_ = line_set::bitmap_chunk;
+	    c.a_.clear();
+	}
+	optimize_chunk(c);
+	return true;
+    }
+
+    /// create a chunk from runs. @return false if there are no runs.
+    bool from_runs(uint16_t key, const runs_t& r, chunk_t& c)
+    {
+	if (r.empty()) {
+	    return false;
+	}
+	uint32_t card = 0;
+	for(const auto& i : r) {
+	    card += i.second - i.first + 1;
+	}
+	c.key_ = key;
+	c.card_ = card;
+	assign_runs(c, r);
+	optimize_chunk(c);
+	return true;
+    }
+
+    /// @return index of the run in c that contains or precedes v; -1 if v is before the first run.
+    int find_run(const chunk_t& c, uint32_t v)
+    {
+	int lo = 0, hi = static_cast<int>(c.a_.size() / 2) - 1, res = -1;
+	while (lo <= hi) {
+	    const int mid = (lo + hi) / 2;
+	    if (c.a_[mid * 2] <= v) {
+		res = mid;
+		lo = mid + 1;
+	    } else {
+		hi = mid - 1;
+	    }
+	}
+	return res;
+    }
+
+    bool chunk_contains(const chunk_t& c, uint32_t v)
+    {
+	switch(c.type_) {
+	case line_set::array_chunk:
+	    return std::binary_search(c.a_.begin(), c.a_.end(), static_cast<uint16_t>(v));
+	case line_set::bitmap_chunk:
+	    return test_bit(c.b_, v);
+	case line_set::run_chunk: {
+	    const int r = find_run(c, v);
+	    return r >= 0 && v <= static_cast<uint32_t>(c.a_[r*2]) + c.a_[r*2+1];
+	}
+	}
+	return false;
+    }
+
+    /// find the smallest value >= v in c.
+    bool chunk_ceiling(const chunk_t& c, uint32_t v, uint32_t& out)
+    {
+	switch(c.type_) {
+	case line_set::array_chunk: {
+	    auto it = std::lower_bound(c.a_.begin(), c.a_.end(), static_cast<uint16_t>(v));
+	    if (it == c.a_.end()) {
+		return false;
+	    }
+	    out = *it;
+	    return true;
+	}
+	case line_set::bitmap_chunk: {
+	    uint32_t w = v >> 6;
+	    uint64_t word = c.b_[w] & (~uint64_t(0) << (v & 63));
+	    while (true) {
+		if (word) {
+		    out = w * 64 + ctz64(word);
+		    return true;
+		}
+		if (++w == bitmap_words) {
+		    return false;
+		}
+		word = c.b_[w];
+	    }
+	}
+	case line_set::run_chunk: {
+	    const int r = find_run(c, v);
+	    if (r >= 0 && v <= static_cast<uint32_t>(c.a_[r*2]) + c.a_[r*2+1]) {
+		out = v;
+		return true;
+	    }
+	    const size_t n = r + 1;
+	    if (n * 2 >= c.a_.size()) {
+		return false;
+	    }
+	    out = c.a_[n*2];
+	    return true;
+	}
+	}
+	return false;
+    }
+
+    /// find the largest value <= v in c.
+    bool chunk_floor(const chunk_t& c, uint32_t v, uint32_t& out)
+    {
+	switch(c.type_) {
+	case line_set::array_chunk: {
+	    auto it = std::upper_bound(c.a_.begin(), c.a_.end(), static_cast<uint16_t>(v));
+	    if (it == c.a_.begin()) {
+		return false;
+	    }
+	    out = *(--it);
+	    return true;
+	}
+	case line_set::bitmap_chunk: {
+	    int w = v >> 6;
+	    const unsigned shift = 63 - (v & 63);
+	    uint64_t word = (c.b_[w] << shift) >> shift;
+	    while (true) {
+		if (word) {
+		    out = w * 64 + 63 - clz64(word);
+		    return true;
+		}
+		if (--w < 0) {
+		    return false;
+		}
+		word = c.b_[w];
+	    }
+	}
+	case line_set::run_chunk: {
+	    const int r = find_run(c, v);
+	    if (r < 0) {
+		return false;
+	    }
+	    out = std::min(v, static_cast<uint32_t>(c.a_[r*2]) + c.a_[r*2+1]);
+	    return true;
+	}
+	}
+	return false;
+    }
+
+    /// @return the number of values <= v in c.
+    uint32_t chunk_rank(const chunk_t& c, uint32_t v)
+    {
+	switch(c.type_) {
+	case line_set::array_chunk:
+	    return std::upper_bound(c.a_.begin(), c.a_.end(), static_cast<uint16_t>(v)) - c.a_.begin();
+	case line_set::bitmap_chunk: {
+	    uint32_t r = 0;
+	    const uint32_t w = v >> 6;
+	    for(uint32_t i = 0; i < w; ++i) {
+		r += popcount64(c.b_[i]);
+	    }
+	    const unsigned shift = 63 - (v & 63);
+	    return r + popcount64(c.b_[w] << shift);
+	}
+	case line_set::run_chunk: {
+	    uint32_t r = 0;
+	    for(size_t i = 0; i < c.a_.size() && c.a_[i] <= v; i += 2) {
+		r += std::min(v - c.a_[i], static_cast<uint32_t>(c.a_[i+1])) + 1;
+	    }
+	    return r;
+	}
+	}
+	return 0;
+    }
+
+    /// @return the k-th (starting at 0) value of c.
+    uint32_t chunk_select(const chunk_t& c, uint32_t k)
+    {
+	assert(k < c.card_);
+	switch(c.type_) {
+	case line_set::array_chunk:
+	    return c.a_[k];
+	case line_set::bitmap_chunk:
+	    for(uint32_t w = 0; w < bitmap_words; ++w) {
+		const uint32_t p = popcount64(c.b_[w]);
+		if (k < p) {
+		    uint64_t word = c.b_[w];
+		    for(; k > 0; --k) {
+			word &= word - 1;
+		    }
+		    return w * 64 + ctz64(word);
+		}
+		k -= p;
+	    }
+	    break;
+	case line_set::run_chunk:
+	    for(size_t i = 0; i < c.a_.size(); i += 2) {
+		const uint32_t len = c.a_[i+1] + 1u;
+		if (k < len) {
+		    return c.a_[i] + k;
+		}
+		k -= len;
+	    }
+	    break;
+	}
+	assert(false);
+	return 0;
+    }
+
+    /// intersect two run lists.
+    void runs_and(const runs_t& a, const runs_t& b, runs_t& out)
+    {
+	size_t i = 0, j = 0;
+	while (i < a.size() && j < b.size()) {
+	    const uint32_t lo = std::max(a[i].first, b[j].first);
+	    const uint32_t hi = std::min(a[i].second, b[j].second);
+	    if (lo <= hi) {
+		out.push_back(run_t(lo, hi));
+	    }
+	    if (a[i].second < b[j].second) {
+		++i;
+	    } else {
+		++j;
+	    }
+	}
+    }
+
+    /// unite two run lists.
+    void runs_or(const runs_t& a, const runs_t& b, runs_t& out)
+    {
+	size_t i = 0, j = 0;
+	while (i < a.size() || j < b.size()) {
+	    run_t r;
+	    if (j == b.size() || (i < a.size() && a[i].first < b[j].first)) {
+		r = a[i++];
+	    } else {
+		r = b[j++];
+	    }
+	    if (!out.empty() && r.first <= out.back().second + 1) {
+		out.back().second = std::max(out.back().second, r.second);
+	    } else {
+		out.push_back(r);
+	    }
+	}
+    }
+
+    /// subtract run list b from a.
+    void runs_andnot(const runs_t& a, const runs_t& b, runs_t& out)
+    {
+	size_t j = 0;
+	for(auto r : a) {
+	    while (j < b.size() && b[j].second < r.first) {
+		++j;
+	    }
+	    uint32_t start = r.first;
+	    size_t k = j;
+	    for(; k < b.size() && b[k].first <= r.second; ++k) {
+		if (b[k].first > start) {
+		    out.push_back(run_t(start, b[k].first - 1));
+		}
+		start = b[k].second + 1;
+		if (start > r.second) {
+		    break;
+		}
+	    }
+	    if (start <= r.second) {
+		out.push_back(run_t(start, r.second));
+	    }
+	}
+    }
+
+    /// keep the values of array a for which chunk_contains(b) == keep.
+    bool filter_array(const chunk_t& a, const chunk_t& b, bool keep, chunk_t& out)
+    {
+	std::vector<uint16_t> v;
+	to_array(a, v);
+	std::vector<uint16_t> r;
+	r.reserve(v.size());
+	for(auto i : v) {
+	    if (chunk_contains(b, i) == keep) {
+		r.push_back(i);
+	    }
+	}
+	return from_array(a.key_, r, out);
+    }
+
+    enum op_t { op_and, op_or, op_andnot };
+
+    /// combine two chunks with the same key. @return false if the result is empty.
+    bool chunk_op(const chunk_t& a, const chunk_t& b, op_t op, chunk_t& out)
+    {
+	assert(a.key_ == b.key_);
+	const bool a_small = a.type_ == line_set::array_chunk;
+	const bool b_small = b.type_ == line_set::array_chunk;
+
+	if (a.type_ == line_set::run_chunk && b.type_ == line_set::run_chunk) {
+	    runs_t ra, rb, r;
+	    to_runs(a, ra);
+	    to_runs(b, rb);
+	    switch(op) {
+	    case op_and: runs_and(ra, rb, r); break;
+	    case op_or: runs_or(ra, rb, r); break;
+	    case op_andnot: runs_andnot(ra, rb, r); break;
+	    }
+	    return from_runs(a.key_, r, out);
+	}
+
+	switch(op) {
+	case op_and:
+	    if (a_small && b_small) {
+		std::vector<uint16_t> r;
+		typedef std::vector<uint16_t>::const_iterator it_t;
+		std::pair<it_t, it_t> v[2] = { std::make_pair(a.a_.begin(), a.a_.end()), std::make_pair(b.a_.begin(), b.a_.end()) };
+		multiple_set_intersect(v, v + 2, std::back_inserter(r));
+		return from_array(a.key_, r, out);
+	    }
+	    if (a_small) {
+		return filter_array(a, b, true, out);
+	    }
+	    if (b_small) {
+		return filter_array(b, a, true, out);
+	    }
+	    break;
+	case op_or:
+	    if (a_small && b_small && a.card_ + b.card_ <= max_array_card) {
+		std::vector<uint16_t> r;
+		std::set_union(a.a_.begin(), a.a_.end(), b.a_.begin(), b.a_.end(), std::back_inserter(r));
+		return from_array(a.key_, r, out);
+	    }
+	    break;
+	case op_andnot:
+	    if (a_small) {
+		return filter_array(a, b, false, out);
+	    }
+	    break;
+	}
+
+	// fall back to bitmap operations
+	std::vector<uint64_t> ba, bb;
+	to_bitmap(a, ba);
+	to_bitmap(b, bb);
+	for(uint32_t w = 0; w < bitmap_words; ++w) {
+	    switch(op) {
+	    case op_and: ba[w] &= bb[w]; break;
+	    case op_or: ba[w] |= bb[w]; break;
+	    case op_andnot: ba[w] &= ~bb[w]; break;
+	    }
+	}
+	return from_bitmap(a.key_, ba, out);
+    }
+}
+
+line_set::const_iterator::const_iterator(const line_set *s, size_t c) :
+    s_(s),
+    c_(c),
+    i_(0),
+    j_(0),
+    value_(0)
+{
+    if (c_ < s_->chunk_.size()) {
+	const chunk& ch = s_->chunk_[c_];
+	if (ch.type_ == bitmap_chunk) {
+	    uint32_t v = 0;
+	    const bool b = chunk_ceiling(ch, 0, v);
+	    assert(b); (void)b;
+	    i_ = v;
+	}
+	load();
+    }
+}
+
+void
+line_set::const_iterator::load()
+{
+    const chunk& c = s_->chunk_[c_];
+    const value_type base = static_cast<value_type>(c.key_) << 16;
+    switch(c.type_) {
+    case array_chunk: value_ = base + c.a_[i_]; break;
+    case bitmap_chunk: value_ = base + i_; break;
+    case run_chunk: value_ = base + c.a_[i_*2] + j_; break;
+    }
+}
+
+void
+line_set::const_iterator::next_chunk()
+{
+    i_ = j_ = 0;
+    if (++c_ < s_->chunk_.size()) {
+	const chunk& c = s_->chunk_[c_];
+	if (c.type_ == bitmap_chunk) {
+	    uint32_t v = 0;
+	    chunk_ceiling(c, 0, v);
+	    i_ = v;
+	}
+	load();
+    }
+}
+
+line_set::const_iterator&
+line_set::const_iterator::operator++()
+{
+    assert(c_ < s_->chunk_.size());
+    const chunk& c = s_->chunk_[c_];
+    switch(c.type_) {
+    case array_chunk:
+	if (++i_ == c.a_.size()) {
+	    next_chunk();
+	    return *this;
+	}
+	break;
+    case bitmap_chunk: {
+	uint32_t v = 0;
+	if (i_ == 0xFFFF || !chunk_ceiling(c, i_ + 1, v)) {
+	    next_chunk();
+	    return *this;
+	}
+	i_ = v;
+	break;
+    }
+    case run_chunk:
+	if (++j_ > c.a_[i_*2+1]) {
+	    j_ = 0;
+	    if (++i_ * 2 == c.a_.size()) {
+		next_chunk();
+		return *this;
+	    }
+	}
+	break;
+    }
+    load();
+    return *this;
+}
+
+line_set::line_set(const lineNum_vector_t& v)
+{
+    for(auto n : v) {
+	push_back(n);
+    }
+    optimize();
+}
+
+line_set
+line_set::range(value_type first, value_type last)
+{
+    line_set s;
+    if (first <= last) {
+	s.add_range(first, last);
+    }
+    return s;
+}
+
+size_t
+line_set::find_chunk(uint16_t key) const
+{
+    auto it = std::lower_bound(chunk_.begin(), chunk_.end(), key, [](const chunk& c, uint16_t k) { return c.key_ < k; });
+    if (it == chunk_.end() || it->key_ != key) {
+	return chunk_.size();
+    }
+    return it - chunk_.begin();
+}
+
+line_set::chunk&
+line_set::new_chunk(uint16_t key, chunk_type t)
+{
+    assert(chunk_.empty() || chunk_.back().key_ < key);
+    const uint64_t before = size();
+    if (! chunk_.empty()) {
+	optimize_chunk(chunk_.back());
+    }
+    chunk_.push_back(chunk());
+    chunk& c = chunk_.back();
+    c.key_ = key;
+    c.type_ = t;
+    c.card_ = 0;
+    c.before_ = before;
+    return c;
+}
+
+void
+line_set::push_chunk(chunk&& c)
+{
+    assert(chunk_.empty() || chunk_.back().key_ < c.key_);
+    c.before_ = size();
+    chunk_.push_back(std::move(c));
+}
+
+void
+line_set::push_back(value_type n)
+{
+    const uint16_t key = high(n);
+    const uint32_t v = low(n);
+    if (chunk_.empty() || chunk_.back().key_ != key) {
+	new_chunk(key, array_chunk);
+    }
+    chunk& c = chunk_.back();
+    switch(c.type_) {
+    case array_chunk:
+	assert(c.a_.empty() || c.a_.back() < v);
+	if (c.card_ < max_array_card) {
+	    c.a_.push_back(static_cast<uint16_t>(v));
+	    break;
+	}
+	to_bitmap(c, c.b_);
+	c.a_.clear(); c.a_.shrink_to_fit();
+	c.type_ = bitmap_chunk;
+	// fall through
+    case bitmap_chunk:
+	set_bit(c.b_, v);
+	break;
+    case run_chunk: {
+	const size_t s = c.a_.size();
+	if (s > 0 && static_cast<uint32_t>(c.a_[s-2]) + c.a_[s-1] + 1 == v) {
+	    ++c.a_[s-1];
+	} else {
+	    assert(s == 0 || static_cast<uint32_t>(c.a_[s-2]) + c.a_[s-1] < v);
+	    c.a_.push_back(static_cast<uint16_t>(v));
+	    c.a_.push_back(0);
+	}
+	break;
+    }
+    }
+    ++c.card_;
+}
+
+void
+line_set::add_range(value_type first, value_type last)
+{
+    assert(first <= last);
+    assert(empty() || this->last() < first);
+    uint64_t b = first;
+    while (b <= last) {
+	const uint16_t key = high(static_cast<value_type>(b));
+	const uint64_t e = std::min(static_cast<uint64_t>(last), (static_cast<uint64_t>(key) << 16) | 0xFFFF);
+	if (chunk_.empty() || chunk_.back().key_ != key) {
+	    new_chunk(key, run_chunk);
+	}
+	chunk& c = chunk_.back();
+	if (c.type_ != run_chunk) {
+	    runs_t r;
+	    to_runs(c, r);
+	    assign_runs(c, r);
+	}
+	const uint32_t lo = low(static_cast<value_type>(b)), hi = low(static_cast<value_type>(e));
+	const size_t s = c.a_.size();
+	if (s > 0 && static_cast<uint32_t>(c.a_[s-2]) + c.a_[s-1] + 1 == lo) {
+	    c.a_[s-1] = static_cast<uint16_t>(hi - c.a_[s-2]);
+	} else {
+	    c.a_.push_back(static_cast<uint16_t>(lo));
+	    c.a_.push_back(static_cast<uint16_t>(hi - lo));
+	}
+	c.card_ += hi - lo + 1;
+	b = e + 1;
+    }
+}
+
+void
+line_set::optimize()
+{
+    for(auto& c : chunk_) {
+	optimize_chunk(c);
+    }
+    chunk_.shrink_to_fit();
+}
+
+line_set::value_type
+line_set::first() const
+{
+    if (chunk_.empty()) {
+	return 0;
+    }
+    return select(0);
+}
+
+line_set::value_type
+line_set::last() const
+{
+    if (chunk_.empty()) {
+	return 0;
+    }
+    const chunk& c = chunk_.back();
+    return (static_cast<value_type>(c.key_) << 16) + chunk_select(c, c.card_ - 1);
+}
+
+bool
+line_set::contains(value_type n) const
+{
+    const size_t i = find_chunk(high(n));
+    if (i == chunk_.size()) {
+	return false;
+    }
+    return chunk_contains(chunk_[i], low(n));
+}
+
+bool
+line_set::ceiling(value_type n, value_type& out) const
+{
+    auto it = std::lower_bound(chunk_.begin(), chunk_.end(), high(n), [](const chunk& c, uint16_t k) { return c.key_ < k; });
+    if (it == chunk_.end()) {
+	return false;
+    }
+    uint32_t v = 0;
+    if (it->key_ == high(n)) {
+	if (chunk_ceiling(*it, low(n), v)) {
+	    out = (static_cast<value_type>(it->key_) << 16) + v;
+	    return true;
+	}
+	if (++it == chunk_.end()) {
+	    return false;
+	}
+    }
+    chunk_ceiling(*it, 0, v);
+    out = (static_cast<value_type>(it->key_) << 16) + v;
+    return true;
+}
+
+bool
+line_set::floor(value_type n, value_type& out) const
+{
+    auto it = std::upper_bound(chunk_.begin(), chunk_.end(), high(n), [](uint16_t k, const chunk& c) { return k < c.key_; });
+    if (it == chunk_.begin()) {
+	return false;
+    }
+    --it;
+    uint32_t v = 0;
+    if (it->key_ == high(n)) {
+	if (chunk_floor(*it, low(n), v)) {
+	    out = (static_cast<value_type>(it->key_) << 16) + v;
+	    return true;
+	}
+	if (it == chunk_.begin()) {
+	    return false;
+	}
+	--it;
+    }
+    out = (static_cast<value_type>(it->key_) << 16) + chunk_select(*it, it->card_ - 1);
+    return true;
+}
+
+bool
+line_set::next(value_type n, value_type& out) const
+{
+    if (n == 0xFFFFFFFFu) {
+	return false;
+    }
+    return ceiling(n + 1, out);
+}
+
+bool
+line_set::prev(value_type n, value_type& out) const
+{
+    if (n == 0) {
+	return false;
+    }
+    return floor(n - 1, out);
+}
+
+uint64_t
+line_set::rank(value_type n) const
+{
+    auto it = std::upper_bound(chunk_.begin(), chunk_.end(), high(n), [](uint16_t k, const chunk& c) { return k < c.key_; });
+    if (it == chunk_.begin()) {
+	return 0;
+    }
+    --it;
+    if (it->key_ < high(n)) {
+	return it->before_ + it->card_;
+    }
+    return it->before_ + chunk_rank(*it, low(n));
+}
+
+line_set::value_type
+line_set::select(uint64_t k) const
+{
+    assert(k < size());
+    auto it = std::upper_bound(chunk_.begin(), chunk_.end(), k, [](uint64_t k, const chunk& c) { return k < c.before_; });
+    assert(it != chunk_.begin());
+    --it;
+    return (static_cast<value_type>(it->key_) << 16) + chunk_select(*it, static_cast<uint32_t>(k - it->before_));
+}
+
+uint64_t
+line_set::memory_usage() const
+{
+    uint64_t s = sizeof(*this) + chunk_.capacity() * sizeof(chunk);
+    for(const auto& c : chunk_) {
+	s += c.a_.capacity() * sizeof(uint16_t) + c.b_.capacity() * sizeof(uint64_t);
+    }
+    return s;
+}
+
+lineNum_vector_t
+line_set::to_vector() const
+{
+    lineNum_vector_t v;
+    v.reserve(size());
+    v.insert(v.end(), begin(), end());
+    return v;
+}
+
+namespace {
+    template <typename Combine>
+    line_set combine(const chunk_t *a, size_t a_size, const chunk_t *b, size_t b_size, op_t op, Combine push)
+    {
+	line_set s;
+	size_t i = 0, j = 0;
+	while (i < a_size || j < b_size) {
+	    if (j == b_size || (i < a_size && a[i].key_ < b[j].key_)) {
+		// chunk only in a
+		if (op != op_and) {
+		    chunk_t c = a[i];
+		    push(s, std::move(c));
+		}
+		++i;
+	    } else if (i == a_size || b[j].key_ < a[i].key_) {
+		// chunk only in b
+		if (op == op_or) {
+		    chunk_t c = b[j];
+		    push(s, std::move(c));
+		}
+		++j;
+	    } else {
+		chunk_t c;
+		if (chunk_op(a[i], b[j], op, c)) {
+		    push(s, std::move(c));
+		}
+		++i;
+		++j;
+	    }
+	}
+	return s;
+    }
+}
+
+// the combine() helper needs access to push_chunk(), so it is called through these member functions.
+line_set
+line_set::intersect(const line_set& a, const line_set& b)
+{
+    return combine(a.chunk_.data(), a.chunk_.size(), b.chunk_.data(), b.chunk_.size(), op_and, [](line_set& s, chunk&& c) { s.push_chunk(std::move(c)); });
+}
+
+line_set
+line_set::unite(const line_set& a, const line_set& b)
+{
+    return combine(a.chunk_.data(), a.chunk_.size(), b.chunk_.data(), b.chunk_.size(), op_or, [](line_set& s, chunk&& c) { s.push_chunk(std::move(c)); });
+}
+
+line_set
+line_set::subtract(const line_set& a, const line_set& b)
+{
+    return combine(a.chunk_.data(), a.chunk_.size(), b.chunk_.data(), b.chunk_.size(), op_andnot, [](line_set& s, chunk&& c) { s.push_chunk(std::move(c)); });
+}
+
+line_set
+line_set::intersect(std::vector<const line_set*> v)
+{
+    if (v.empty()) {
+	return line_set();
+    }
+    // start with the smallest set, so intermediate results stay small
+    std::sort(v.begin(), v.end(), [](const line_set *l, const line_set *r) { return l->size() < r->size(); });
+    line_set s = *v[0];
+    for(size_t i = 1; i < v.size() && !s.empty(); ++i) {
+	s = intersect(s, *v[i]);
+    }
+    return s;
+}
+
+std::pair<size_t, size_t>
+line_set::chunk_range(value_type first, value_type last) const
+{
+    auto b = std::lower_bound(chunk_.begin(), chunk_.end(), high(first), [](const chunk& c, uint16_t k) { return c.key_ < k; });
+    auto e = std::upper_bound(b, chunk_.end(), high(last), [](uint16_t k, const chunk& c) { return k < c.key_; });
+    return std::make_pair(b - chunk_.begin(), e - chunk_.begin());
+}
+
+void
+line_set::trim(value_type first, value_type last)
+{
+    // only the first and the last chunk can contain line numbers outside of [first..last]
+    auto restrict = [](chunk& c, uint32_t lo, uint32_t hi) {
+	chunk r, out;
+	from_runs(c.key_, runs_t(1, run_t(lo, hi)), r);
+	const bool b = chunk_op(c, r, op_and, out);
+	c = std::move(out);
+	return b;
+    };
+    if (! chunk_.empty() && chunk_.front().key_ == high(first) && low(first) > 0) {
+	if (! restrict(chunk_.front(), low(first), 0xFFFF)) {
+	    chunk_.erase(chunk_.begin());
+	}
+    }
+    if (! chunk_.empty() && chunk_.back().key_ == high(last) && low(last) < 0xFFFF) {
+	if (! restrict(chunk_.back(), 0, low(last))) {
+	    chunk_.pop_back();
+	}
+    }
+    uint64_t before = 0;
+    for(auto& c : chunk_) {
+	c.before_ = before;
+	before += c.card_;
+    }
+}
+
+line_set
+line_set::intersect(std::vector<const line_set*> v, value_type first, value_type last)
+{
+    if (v.empty() || first > last) {
+	return line_set();
+    }
+    std::sort(v.begin(), v.end(), [](const line_set *l, const line_set *r) { return l->size() < r->size(); });
+    line_set s;
+    auto r = v[0]->chunk_range(first, last);
+    s.chunk_.assign(v[0]->chunk_.begin() + r.first, v[0]->chunk_.begin() + r.second);
+    s.trim(first, last);
+    for(size_t i = 1; i < v.size() && !s.empty(); ++i) {
+	r = v[i]->chunk_range(first, last);
+	s = combine(s.chunk_.data(), s.chunk_.size(), v[i]->chunk_.data() + r.first, r.second - r.first, op_and, [](line_set& s, chunk&& c) { s.push_chunk(std::move(c)); });
+    }
+    return s;
+}
+
+void
+line_set::append(line_set&& s)
+{
+    assert(empty() || s.empty() || last() < s.first());
+    auto it = s.chunk_.begin();
+    if (it != s.chunk_.end() && ! chunk_.empty() && chunk_.back().key_ == it->key_) {
+	// both sets share a chunk
+	chunk c;
+	chunk_op(chunk_.back(), *it, op_or, c);
+	c.before_ = chunk_.back().before_;
+	chunk_.back() = std::move(c);
+	++it;
+    }
+    for(; it != s.chunk_.end(); ++it) {
+	push_chunk(std::move(*it));
+    }
+    s.clear();
+}
+
+line_set
+line_set::dilate(value_type before, value_type after, value_type max) const
+{
+    line_set s;
+    bool have = false;
+    value_type b = 0, e = 0;
+    // the widened ranges are in ascending order, overlapping or adjacent ranges are merged
+    for_each_range([&](value_type first, value_type last) {
+	    if (first > max) {
+		return;
+	    }
+	    const value_type nb = (first > before) ? first - before : 1;
+	    const value_type ne = static_cast<value_type>(std::min<uint64_t>(static_cast<uint64_t>(last) + after, max));
+	    if (have && static_cast<uint64_t>(nb) <= static_cast<uint64_t>(e) + 1) {
+		e = std::max(e, ne);
+	    } else {
+		if (have) {
+		    s.add_range(b, e);
+		}
+		b = nb;
+		e = ne;
+		have = true;
+	    }
+	});
+    if (have) {
+	s.add_range(b, e);
+    }
+    s.optimize();
+    return s;
+}
+
+namespace {
+    void put_varint(std::string& out, uint32_t v)
+    {
+	while (v >= 0x80) {
+	    out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+	    v >>= 7;
+	}
+	out.push_back(static_cast<char>(v));
+    }
+
+    bool get_varint(const unsigned char*& p, const unsigned char *end, uint32_t& v)
+    {
+	v = 0;
+	for(unsigned shift = 0; shift < 35; shift += 7) {
+	    if (p == end) {
+		return false;
+	    }
+	    const uint32_t b = *p++;
+	    v |= (b & 0x7F) << shift;
+	    if (b < 0x80) {
+		return true;
+	    }
+	}
+	return false;
+    }
+
+    /// @return number of bytes used by put_varint(v).
+    unsigned varint_size(uint32_t v)
+    {
+	unsigned s = 1;
+	while (v >= 0x80) {
+	    v >>= 7;
+	    ++s;
+	}
+	return s;
+    }
+
+    /// encoding of a chunk in serialize().
+    enum serialized_type { serialized_deltas, serialized_runs, serialized_bitmap };
+}
+
+void
+line_set::serialize(std::string& out) const
+{
+    put_varint(out, static_cast<uint32_t>(chunk_.size()));
+    std::vector<uint16_t> values;
+    for(const auto& c : chunk_) {
+	put_varint(out, c.key_);
+	put_varint(out, c.card_ - 1);
+	if (c.type_ == run_chunk) {
+	    out.push_back(serialized_runs);
+	    put_varint(out, static_cast<uint32_t>(c.a_.size() / 2));
+	    uint32_t prev = 0;
+	    for(size_t i = 0; i < c.a_.size(); i += 2) {
+		put_varint(out, c.a_[i] - prev);
+		put_varint(out, c.a_[i+1]);
+		prev = c.a_[i] + c.a_[i+1];
+	    }
+	    continue;
+	}
+
+	// store the deltas between values, unless the bitmap is smaller
+	const std::vector<uint16_t> *v = &c.a_;
+	if (c.type_ == bitmap_chunk) {
+	    values.clear();
+	    for(uint32_t w = 0; w < bitmap_words; ++w) {
+		uint64_t word = c.b_[w];
+		while (word) {
+		    values.push_back(static_cast<uint16_t>(w * 64 + ctz64(word)));
+		    word &= word - 1;
+		}
+	    }
+	    v = &values;
+	}
+	size_t delta_size = 0;
+	uint32_t prev = 0;
+	for(auto i : *v) {
+	    delta_size += varint_size(i - prev);
+	    prev = i;
+	}
+	if (delta_size >= bitmap_words * sizeof(uint64_t)) {
+	    out.push_back(serialized_bitmap);
+	    for(auto w : c.b_) {
+		for(unsigned b = 0; b < 64; b += 8) {
+		    out.push_back(static_cast<char>(w >> b));
+		}
+	    }
+	} else {
+	    out.push_back(serialized_deltas);
+	    prev = 0;
+	    for(auto i : *v) {
+		put_varint(out, i - prev);
+		prev = i;
+	    }
+	}
+    }
+}
+
+bool
+line_set::deserialize(const char *data, size_t size, line_set& out)
+{
+    out.clear();
+    const unsigned char *p = reinterpret_cast<const unsigned char*>(data);
+    const unsigned char *end = p + size;
+    uint32_t chunks = 0;
+    if (! get_varint(p, end, chunks)) {
+	return false;
+    }
+    out.chunk_.reserve(chunks);
+    for(uint32_t n = 0; n < chunks; ++n) {
+	uint32_t key = 0, card = 0;
+	if (! get_varint(p, end, key) || key > 0xFFFF || (! out.chunk_.empty() && key <= out.chunk_.back().key_)) {
+	    return false;
+	}
+	if (! get_varint(p, end, card) || card >= 65536 || p == end) {
+	    return false;
+	}
+	++card;
+	chunk c;
+	c.key_ = static_cast<uint16_t>(key);
+	c.card_ = card;
+	const unsigned type = *p++;
+	uint32_t sum = 0;
+	if (type == serialized_runs) {
+	    uint32_t runs = 0, prev = 0;
+	    if (! get_varint(p, end, runs) || runs > 32768) {
+		return false;
+	    }
+	    for(uint32_t r = 0; r < runs; ++r) {
+		uint32_t start = 0, len = 0;
+		if (! get_varint(p, end, start) || ! get_varint(p, end, len)) {
+		    return false;
+		}
+		start += prev;
+		if ((r > 0 && start <= prev) || start + len > 0xFFFF) {
+		    return false;
+		}
+		c.a_.push_back(static_cast<uint16_t>(start));
+		c.a_.push_back(static_cast<uint16_t>(len));
+		prev = start + len;
+		sum += len + 1;
+	    }
+	    c.type_ = run_chunk;
+	} else if (type == serialized_bitmap) {
+	    if (static_cast<size_t>(end - p) < bitmap_words * sizeof(uint64_t)) {
+		return false;
+	    }
+	    c.b_.resize(bitmap_words);
+	    for(auto& w : c.b_) {
+		w = 0;
+		for(unsigned b = 0; b < 64; b += 8) {
+		    w |= static_cast<uint64_t>(*p++) << b;
+		}
+		sum += popcount64(w);
+	    }
+	    c.type_ = bitmap_chunk;
+	} else if (type == serialized_deltas) {
+	    std::vector<uint16_t> v;
+	    v.reserve(card);
+	    uint32_t prev = 0;
+	    for(uint32_t i = 0; i < card; ++i) {
+		uint32_t d = 0;
+		if (! get_varint(p, end, d) || (i > 0 && d == 0) || prev + d > 0xFFFF) {
+		    return false;
+		}
+		prev += d;
+		v.push_back(static_cast<uint16_t>(prev));
+	    }
+	    sum = card;
+	    if (card <= max_array_card) {
+		c.type_ = array_chunk;
+		c.a_ = std::move(v);
+	    } else {
+		c.type_ = bitmap_chunk;
+		c.b_.assign(bitmap_words, 0);
+		for(auto i : v) {
+		    set_bit(c.b_, i);
+		}
+	    }
+	} else {
+	    return false;
+	}
+	if (sum != card) {
+	    return false;
+	}
+	out.push_chunk(std::move(c));
+    }
+    if (p != end) {
+	return false;
+    }
+    return true;
+}
+
+bool
+line_set::operator== (const line_set& r) const
+{
+    if (size() != r.size()) {
+	return false;
+    }
+    return std::equal(begin(), end(), r.begin());
+}
+
+std::string
+memory_size_str(uint64_t bytes)
+{
+    if (bytes < 10 * 1024) {
+	return std::to_string(bytes) + " B";
+    }
+    if (bytes < 10 * 1024 * 1024) {
+	return std::to_string(bytes / 1024) + " KB";
+    }
+    if (bytes < 10ull * 1024 * 1024 * 1024) {
+	return std::to_string(bytes / 1024 / 1024) + " MB";
+    }
+    return std::to_string(bytes / 1024 / 1024 / 1024) + " GB";
+}
@@ -0,0 +1,317 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#pragma once
+#include "types.h"
+#include <iterator>
+#include <vector>
+#include <string>
+#include <utility>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/// @return number of trailing zero bits in w, which must not be 0.
+inline unsigned ctz64(uint64_t w)
+{
+#if defined(_MSC_VER)
+    unsigned long i;
+    _BitScanForward64(&i, w);
+    return i;
+#else
+    return __builtin_ctzll(w);
+#endif
+}
+
+/// @return number of leading zero bits in w, which must not be 0.
+inline unsigned clz64(uint64_t w)
+{
+#if defined(_MSC_VER)
+    unsigned long i;
+    _BitScanReverse64(&i, w);
+    return 63 - i;
+#else
+    return __builtin_clzll(w);
+#endif
+}
+
+/// @return number of set bits in w.
+inline unsigned popcount64(uint64_t w)
+{
+#if defined(_MSC_VER)
+    return static_cast<unsigned>(__popcnt64(w));
+#else
+    return __builtin_popcountll(w);
+#endif
+}
+
+/**
+ * a compressed set of line numbers.
+ *
+ * The line numbers are grouped into chunks of 65536 consecutive
+ * numbers (the upper 16 bit of a line number are the chunk key). Each
+ * chunk uses the smallest of three representations:
+ * - a sorted array of the lower 16 bit, for sparse chunks.
+ * - a bitmap of 65536 bits, for dense chunks.
+ * - a list of runs of consecutive numbers, for chunks with long runs.
+ *
+ * This follows the idea of the roaring bitmap. A filter that matches
+ * most lines of a file uses a few KB instead of 4 bytes per line.
+ *
+ * Line numbers have to be added in increasing order with push_back()
+ * or add_range(). Line number 0 is never a valid line and is used as
+ * "no line" by first() and last().
+ */
+class line_set
+{
+public:
+    typedef line_number_t value_type;
+
+    /// representation of a chunk.
+    enum chunk_type { array_chunk, bitmap_chunk, run_chunk };
+
+    /// one block of 65536 line numbers. This is an implementation detail of line_set.
+    struct chunk
+    {
+	/// upper 16 bit of all line numbers in this chunk.
+	uint16_t key_;
+	chunk_type type_;
+	/// number of line numbers in this chunk, [1..65536].
+	uint32_t card_;
+	/// number of line numbers in all previous chunks.
+	uint64_t before_;
+	/// array_chunk: sorted lower 16 bit. run_chunk: pairs of (start, length-1).
+	std::vector<uint16_t> a_;
+	/// bitmap_chunk: 1024 words of 64 bit.
+	std::vector<uint64_t> b_;
+    };
+
+    /// forward iterator over all line numbers in ascending order.
+    class const_iterator
+    {
+	const line_set *s_;
+	/// chunk index.
+	size_t c_;
+	/// array index, run index or lower 16 bit for bitmaps.
+	uint32_t i_;
+	/// offset into the current run.
+	uint32_t j_;
+	line_number_t value_;
+
+	void load();
+	void next_chunk();
+
+    public:
+	typedef std::forward_iterator_tag iterator_category;
+	typedef line_set::value_type value_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef const value_type* pointer;
+	typedef const value_type& reference;
+
+	const_iterator() : s_(nullptr), c_(0), i_(0), j_(0), value_(0) {}
+	const_iterator(const line_set *s, size_t c);
+
+	reference operator*() const { return value_; }
+	pointer operator->() const { return &value_; }
+	const_iterator& operator++();
+	const_iterator operator++(int) { const_iterator i = *this; ++(*this); return i; }
+	bool operator== (const const_iterator& r) const { return c_ == r.c_ && i_ == r.i_ && j_ == r.j_; }
+	bool operator!= (const const_iterator& r) const { return !(*this == r); }
+    };
+    typedef const_iterator iterator;
+
+private:
+    std::vector<chunk> chunk_;
+
+    /// @return index of the chunk with key; chunk_.size() if not found.
+    size_t find_chunk(uint16_t key) const;
+
+    /// append a new chunk and convert the previous last chunk into its smallest representation.
+    chunk& new_chunk(uint16_t key, chunk_type t);
+
+    /// append c, which must have a larger key than the last chunk.
+    void push_chunk(chunk&& c);
+
+    /// @return [begin, end) indexes of the chunks that can contain line numbers in [first..last].
+    std::pair<size_t, size_t> chunk_range(value_type first, value_type last) const;
+
+    /// remove all line numbers outside of [first..last] from the first and last chunk.
+    void trim(value_type first, value_type last);
+
+public:
+    line_set() {}
+
+    /// construct from a sorted vector of line numbers.
+    explicit line_set(const lineNum_vector_t& v);
+
+    /// @return a set with all line numbers [first..last].
+    static line_set range(value_type first, value_type last);
+
+    /**
+     * add a line number.
+     * @param n line number, which must be larger than all line numbers already in the set.
+     */
+    void push_back(value_type n);
+
+    /**
+     * add all line numbers [first..last].
+     * first must be larger than all line numbers already in the set.
+     */
+    void add_range(value_type first, value_type last);
+
+    /// convert all chunks into their smallest representation.
+    void optimize();
+
+    /// @return the number of line numbers in the set.
+    uint64_t size() const { return chunk_.empty() ? 0 : chunk_.back().before_ + chunk_.back().card_; }
+
+    bool empty() const { return chunk_.empty(); }
+
+    void clear() { chunk_.clear(); }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, chunk_.size()); }
+
+    /// @return the smallest line number; 0 if the set is empty.
+    value_type first() const;
+
+    /// @return the largest line number; 0 if the set is empty.
+    value_type last() const;
+
+    /// @return true if n is included in the set.
+    bool contains(value_type n) const;
+
+    /**
+     * find the smallest line number >= n.
+     * @return true if such a line number exists and was stored in out.
+     */
+    bool ceiling(value_type n, value_type& out) const;
+
+    /**
+     * find the largest line number <= n.
+     * @return true if such a line number exists and was stored in out.
+     */
+    bool floor(value_type n, value_type& out) const;
+
+    /// find the smallest line number > n.
+    bool next(value_type n, value_type& out) const;
+
+    /// find the largest line number < n.
+    bool prev(value_type n, value_type& out) const;
+
+    /// @return the number of line numbers <= n.
+    uint64_t rank(value_type n) const;
+
+    /**
+     * @param k index into the set, must be < size().
+     * @return the k-th (starting at 0) smallest line number.
+     */
+    value_type select(uint64_t k) const;
+
+    /// @return number of bytes used by this object.
+    uint64_t memory_usage() const;
+
+    /// @return the line numbers as a vector.
+    lineNum_vector_t to_vector() const;
+
+    /**
+     * call f(first, last) for each maximal range of consecutive line numbers, in ascending order.
+     */
+    template <typename F>
+    void for_each_range(F f) const
+    {
+	bool have = false;
+	value_type first = 0, last = 0;
+	for(const auto& c : chunk_) {
+	    const value_type base = static_cast<value_type>(c.key_) << 16;
+	    auto add = [&](value_type b, value_type e) {
+		if (have && b == last + 1) {
+		    last = e;
+		} else {
+		    if (have) {
+			f(first, last);
+		    }
+		    first = b;
+		    last = e;
+		    have = true;
+		}
+	    };
+	    if (c.type_ == run_chunk) {
+		for(size_t i = 0; i < c.a_.size(); i += 2) {
+		    add(base + c.a_[i], base + c.a_[i] + c.a_[i+1]);
+		}
+	    } else if (c.type_ == array_chunk) {
+		for(auto v : c.a_) {
+		    add(base + v, base + v);
+		}
+	    } else {
+		for(uint32_t w = 0; w < c.b_.size(); ++w) {
+		    uint64_t word = c.b_[w];
+		    while (word) {
+			const uint32_t bit = ctz64(word);
+			add(base + w * 64 + bit, base + w * 64 + bit);
+			word &= word - 1;
+		    }
+		}
+	    }
+	}
+	if (have) {
+	    f(first, last);
+	}
+    }
+
+    /// @return the line numbers included in both a and b.
+    static line_set intersect(const line_set& a, const line_set& b);
+
+    /// @return the line numbers included in all sets of v.
+    static line_set intersect(std::vector<const line_set*> v);
+
+    /**
+     * @return the line numbers in [first..last] included in all sets of v.
+     * Disjoint ranges can be intersected independently and joined with append().
+     */
+    static line_set intersect(std::vector<const line_set*> v, value_type first, value_type last);
+
+    /**
+     * move all line numbers of s to the end of this set.
+     * All line numbers of s must be larger than last().
+     */
+    void append(line_set&& s);
+
+    /**
+     * widen every line number n of the set to the range [n-before..n+after].
+     * This adds context lines around matches, like grep -B and -A.
+     * @param max the largest line number of the result.
+     * @return the widened set, clipped to [1..max].
+     */
+    line_set dilate(value_type before, value_type after, value_type max) const;
+
+    /// @return the line numbers included in a or b.
+    static line_set unite(const line_set& a, const line_set& b);
+
+    /// @return the line numbers included in a but not in b.
+    static line_set subtract(const line_set& a, const line_set& b);
+
+    /**
+     * append a compact binary representation of the set to out.
+     * Sorted values are stored as variable length deltas, which is
+     * smaller than the in-memory representation for most sets.
+     */
+    void serialize(std::string& out) const;
+
+    /**
+     * restore a set written by serialize().
+     * @param data pointer to the binary representation.
+     * @param size number of bytes at data.
+     * @param[out] out the restored set.
+     * @return true upon success; false if the data is corrupt.
+     */
+    static bool deserialize(const char *data, size_t size, line_set& out);
+
+    bool operator== (const line_set& r) const;
+    bool operator!= (const line_set& r) const { return !(*this == r); }
+};
+
+/// @return a human readable string of a memory size in bytes.
+std::string memory_size_str(uint64_t bytes);
@@ -0,0 +1,278 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+
+#include "gtest/gtest.h"
+#include "line_set.h"
+#include <algorithm>
+#include <iterator>
+#include <random>
+
+namespace {
+    /// create a sorted vector with random line numbers. Every line number in [1..max] is included with probability p.
+    lineNum_vector_t random_lines(unsigned seed, line_number_t max, double p)
+    {
+	std::mt19937 gen(seed);
+	std::bernoulli_distribution d(p);
+	lineNum_vector_t v;
+	for(line_number_t i = 1; i <= max; ++i) {
+	    if (d(gen)) {
+		v.push_back(i);
+	    }
+	}
+	return v;
+    }
+
+    /// create a sorted vector with random runs of line numbers.
+    lineNum_vector_t random_runs(unsigned seed, line_number_t max)
+    {
+	std::mt19937 gen(seed);
+	std::uniform_int_distribution<unsigned> len(1, 3000);
+	lineNum_vector_t v;
+	line_number_t i = 1;
+	while (i < max) {
+	    const unsigned l = len(gen);
+	    for(unsigned u = 0; u < l && i < max; ++u) {
+		v.push_back(i++);
+	    }
+	    i += len(gen);
+	}
+	return v;
+    }
+}
+
+TEST(line_set, empty_set)
+{
+    line_set s;
+    ASSERT_TRUE(s.empty());
+    ASSERT_EQ(0u, s.size());
+    ASSERT_EQ(0u, s.first());
+    ASSERT_EQ(0u, s.last());
+    ASSERT_FALSE(s.contains(1));
+    ASSERT_TRUE(s.begin() == s.end());
+    line_number_t n = 0;
+    ASSERT_FALSE(s.ceiling(1, n));
+    ASSERT_FALSE(s.floor(1, n));
+    ASSERT_EQ(0u, s.rank(100));
+}
+
+TEST(line_set, push_back_and_iterate)
+{
+    line_set s;
+    s.push_back(1);
+    s.push_back(5);
+    s.push_back(70000);
+    s.push_back(70001);
+    ASSERT_EQ(4u, s.size());
+    ASSERT_EQ(1u, s.first());
+    ASSERT_EQ(70001u, s.last());
+    lineNum_vector_t expected = { 1, 5, 70000, 70001 };
+    ASSERT_EQ(expected, s.to_vector());
+    ASSERT_TRUE(s.contains(5));
+    ASSERT_FALSE(s.contains(6));
+    ASSERT_TRUE(s.contains(70000));
+}
+
+TEST(line_set, range)
+{
+    line_set s = line_set::range(10, 200000);
+    ASSERT_EQ(200000u - 10u + 1u, s.size());
+    ASSERT_EQ(10u, s.first());
+    ASSERT_EQ(200000u, s.last());
+    ASSERT_FALSE(s.contains(9));
+    ASSERT_TRUE(s.contains(65536));
+    ASSERT_FALSE(s.contains(200001));
+    // a range needs only a few bytes per chunk
+    ASSERT_LT(s.memory_usage(), 1024u);
+}
+
+TEST(line_set, all_chunk_types_round_trip)
+{
+    for(double p : { 0.001, 0.05, 0.5, 0.97 }) {
+	const lineNum_vector_t v = random_lines(1, 300000, p);
+	line_set s(v);
+	ASSERT_EQ(v.size(), s.size());
+	ASSERT_EQ(v, s.to_vector());
+	for(size_t i = 0; i < v.size(); i += 97) {
+	    ASSERT_TRUE(s.contains(v[i]));
+	    ASSERT_EQ(i + 1, s.rank(v[i]));
+	    ASSERT_EQ(v[i], s.select(i));
+	}
+    }
+    const lineNum_vector_t v = random_runs(2, 300000);
+    line_set s(v);
+    ASSERT_EQ(v, s.to_vector());
+    ASSERT_LT(s.memory_usage(), v.size() * sizeof(line_number_t) / 10);
+}
+
+TEST(line_set, ceiling_and_floor)
+{
+    for(double p : { 0.01, 0.6 }) {
+	const lineNum_vector_t v = random_lines(3, 200000, p);
+	line_set s(v);
+	for(line_number_t n = 1; n < 200005; n += 13) {
+	    line_number_t out = 0;
+	    auto lb = std::lower_bound(v.begin(), v.end(), n);
+	    ASSERT_EQ(lb != v.end(), s.ceiling(n, out));
+	    if (lb != v.end()) {
+		ASSERT_EQ(*lb, out);
+	    }
+	    auto ub = std::upper_bound(v.begin(), v.end(), n);
+	    ASSERT_EQ(ub != v.begin(), s.floor(n, out));
+	    if (ub != v.begin()) {
+		ASSERT_EQ(*(ub - 1), out);
+	    }
+	    ASSERT_EQ(static_cast<uint64_t>(ub - v.begin()), s.rank(n));
+	}
+    }
+}
+
+TEST(line_set, set_operations_match_std_algorithms)
+{
+    std::vector<lineNum_vector_t> in = {
+	random_lines(4, 250000, 0.002),
+	random_lines(5, 250000, 0.3),
+	random_lines(6, 250000, 0.95),
+	random_runs(7, 250000),
+	lineNum_vector_t(),
+    };
+    for(const auto& a : in) {
+	for(const auto& b : in) {
+	    line_set sa(a), sb(b);
+	    lineNum_vector_t r;
+	    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(r));
+	    ASSERT_EQ(r, line_set::intersect(sa, sb).to_vector());
+	    r.clear();
+	    std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(r));
+	    ASSERT_EQ(r, line_set::unite(sa, sb).to_vector());
+	    r.clear();
+	    std::set_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(r));
+	    ASSERT_EQ(r, line_set::subtract(sa, sb).to_vector());
+	}
+    }
+}
+
+TEST(line_set, intersect_multiple_sets)
+{
+    line_set a = line_set::range(1, 100);
+    line_set b(random_lines(8, 100, 0.5));
+    line_set c = line_set::range(50, 1000);
+    std::vector<const line_set*> v = { &a, &b, &c };
+    line_set r = line_set::intersect(v);
+    line_set expected = line_set::intersect(b, line_set::range(50, 100));
+    ASSERT_EQ(expected, r);
+}
+
+TEST(line_set, for_each_range)
+{
+    line_set s;
+    s.push_back(3);
+    s.push_back(4);
+    s.push_back(5);
+    s.push_back(9);
+    s.add_range(65535, 65540);
+    std::vector<std::pair<line_number_t, line_number_t>> r;
+    s.for_each_range([&r](line_number_t b, line_number_t e) { r.push_back(std::make_pair(b, e)); });
+    ASSERT_EQ(3u, r.size());
+    ASSERT_EQ(std::make_pair(3u, 5u), r[0]);
+    ASSERT_EQ(std::make_pair(9u, 9u), r[1]);
+    ASSERT_EQ(std::make_pair(65535u, 65540u), r[2]);
+}
+
+TEST(line_set, dense_filter_is_smaller_than_vector)
+{
+    const lineNum_vector_t v = random_lines(9, 1000000, 0.95);
+    line_set s(v);
+    ASSERT_LT(s.memory_usage() * 20, v.size() * sizeof(line_number_t));
+}
+
+TEST(line_set, intersect_range_and_append)
+{
+    line_set a(random_lines(10, 400000, 0.3));
+    line_set b(random_runs(11, 400000));
+    std::vector<const line_set*> v = { &a, &b };
+    const line_set expected = line_set::intersect(a, b);
+
+    // partitions which are not aligned to chunks
+    line_set s;
+    const line_number_t bounds[] = { 1, 1000, 65536, 65537, 200000, 262144, 400001 };
+    for(size_t i = 0; i + 1 < sizeof(bounds) / sizeof(bounds[0]); ++i) {
+	line_set r = line_set::intersect(v, bounds[i], bounds[i+1] - 1);
+	ASSERT_TRUE(r.empty() || r.first() >= bounds[i]);
+	ASSERT_TRUE(r.empty() || r.last() < bounds[i+1]);
+	s.append(std::move(r));
+    }
+    ASSERT_EQ(expected, s);
+    ASSERT_EQ(expected.size(), s.size());
+    ASSERT_EQ(expected.rank(300000), s.rank(300000));
+}
+
+TEST(line_set, dilate)
+{
+    for(double p : { 0.0001, 0.01, 0.3 }) {
+	const lineNum_vector_t v = random_lines(12, 300000, p);
+	line_set s(v);
+	for(auto ba : { std::make_pair(0u, 0u), std::make_pair(3u, 0u), std::make_pair(0u, 5u), std::make_pair(20u, 20u) }) {
+	    // naive dilation
+	    std::vector<bool> in(300001);
+	    for(auto n : v) {
+		for(line_number_t i = (n > ba.first) ? n - ba.first : 1; i <= std::min(300000u, n + ba.second); ++i) {
+		    in[i] = true;
+		}
+	    }
+	    lineNum_vector_t expected;
+	    for(line_number_t i = 1; i <= 300000; ++i) {
+		if (in[i]) {
+		    expected.push_back(i);
+		}
+	    }
+	    ASSERT_EQ(expected, s.dilate(ba.first, ba.second, 300000).to_vector());
+	}
+    }
+}
+
+TEST(line_set, dilate_clips_to_file)
+{
+    line_set s;
+    s.push_back(1);
+    s.push_back(10);
+    line_set d = s.dilate(5, 5, 12);
+    ASSERT_EQ(line_set::range(1, 12), d);
+    ASSERT_TRUE(line_set().dilate(5, 5, 12).empty());
+}
+
+TEST(line_set, serialize_round_trip)
+{
+    std::vector<lineNum_vector_t> in = {
+	lineNum_vector_t(),
+	random_lines(13, 300000, 0.001),
+	random_lines(14, 300000, 0.1),
+	random_lines(15, 300000, 0.9),
+	random_runs(16, 300000),
+	{ 1, 0xFFFFFFFFu },
+    };
+    for(const auto& v : in) {
+	line_set s(v);
+	std::string data;
+	s.serialize(data);
+	line_set r;
+	ASSERT_TRUE(line_set::deserialize(data.data(), data.size(), r));
+	ASSERT_EQ(s, r);
+	ASSERT_EQ(s.size(), r.size());
+	ASSERT_EQ(s.last(), r.last());
+	// the serialized data is smaller than the set in memory
+	ASSERT_LE(data.size(), s.memory_usage());
+    }
+}
+
+TEST(line_set, deserialize_corrupt_data)
+{
+    line_set s(random_lines(17, 100000, 0.01));
+    std::string data;
+    s.serialize(data);
+    line_set r;
+    ASSERT_FALSE(line_set::deserialize(data.data(), data.size() - 1, r));
+    ASSERT_FALSE(line_set::deserialize((data + "x").data(), data.size() + 1, r));
+    ASSERT_FALSE(line_set::deserialize("\xff", 1, r));
+}
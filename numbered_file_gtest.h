@@ -0,0 +1,52 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#pragma once
+#include "gtest/gtest.h"
+#include "file_index.h"
+#include "temporary_file.h"
+#include "to_wide.h"
+#include <cstdio>
+#include <functional>
+#include <string>
+
+/// base class of test fixtures that use a temporary file of numbered lines.
+class numbered_file_fix : public ::testing::Test {
+protected:
+    TemporaryFile tmp_;
+    /// the name of the temporary file, set by create().
+    std::string filename_;
+
+    /**
+     * write the lines "line 1" to "line num" into the temporary file.
+     * @param tail returns the text after "line N" of line N, including the line end.
+     */
+    void create(const unsigned num, const std::function<std::string(unsigned)>& tail)
+    {
+	FILE *f = tmp_.file();
+	ASSERT_TRUE(f != nullptr);
+	for(unsigned u = 1; u <= num; ++u) {
+	    fprintf(f, "line %u%s", u, tail(u).c_str());
+	}
+	tmp_.close();
+	filename_ = to_utf8(tmp_.filename());
+    }
+
+    /// append s to the file.
+    void append(const char *s)
+    {
+	FILE *f = fopen(filename_.c_str(), "ab");
+	ASSERT_TRUE(f != nullptr);
+	fputs(s, f);
+	fclose(f);
+    }
+
+    /// @return a file_index of the file, which has parsed all lines.
+    file_index::ptr_t parse_all() const
+    {
+	auto fi = std::make_shared<file_index>(filename_);
+	fi->parse_all();
+	return fi;
+    }
+};
@@ -3,6 +3,7 @@
  * :indentSize=4:tabSize=8:
  */
 #pragma once
+#include <atomic>
 #include <iostream>
 #include <string>
 
@@ -42,3 +43,29 @@ public:
     ~CursesProgressFunctor();
     virtual void progress(unsigned num, unsigned perc);
 };
+
+/**
+ * stores the progress of a background job in atomic variables.
+ * progress() takes no lock and does not allocate memory, the UI thread
+ * samples the latest values when it draws the screen, so a fast job
+ * never queues up progress messages.
+ */
+class AtomicProgressFunctor : public ProgressFunctor
+{
+    std::atomic<unsigned> num_;
+    std::atomic<unsigned> perc_;
+    std::atomic<bool> finished_;
+public:
+    AtomicProgressFunctor() : num_(0), perc_(0), finished_(false) {}
+    virtual void progress(unsigned num, unsigned perc)
+    {
+	num_.store(num, std::memory_order_relaxed);
+	perc_.store(perc, std::memory_order_relaxed);
+    }
+    unsigned num() const { return num_.load(std::memory_order_relaxed); }
+    unsigned perc() const { return perc_.load(std::memory_order_relaxed); }
+
+    /// called by the background job when it has finished or was aborted.
+    void finish() { finished_ = true; }
+    bool finished() const { return finished_; }
+};
@@ -15,7 +15,10 @@
 #include <map>
 #include <fstream>
 #include <thread>
+#include <atomic>
+#include <chrono>
 #include <iterator>
+#include <unordered_map>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -25,11 +28,18 @@
 #include <unistd.h>
 #include <cstring>
 #endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <poll.h>
+#define WAIT_FOR_EVENTS 1
+#endif
 
 #include "file_index.h"
 #include "regex_index.h"
 #include "error.h"
 #include "display_info.h"
+#include "line_layout.h"
+#include "column_index.h"
+#include "render_cache.h"
 #include "normalize_regex.h"
 #include "curses_attr.h"
 #include "history.h"
@@ -37,8 +47,8 @@
 #include "getRSS.h"
 #include "to_wide.h"
 #include "event.h"
-#include "intersect.h"
 #include "search.h"
+#include "search_index.h"
 #include "temporary_file.h"
 #include "console.h"
 #include "errno_str.h"
@@ -52,6 +62,10 @@
 #include "timeGetTime.h"
 #include "complete_filename.h"
 #include "word_set.h"
+#include "filter_engine.h"
+#include "filter_expression.h"
+#include "filter_cache.h"
+#include "index_cache.h"
 
 #undef max
 
@@ -98,24 +112,51 @@ namespace {
     /// width of a tab character in characters
     unsigned tab_width = 8;
 
+    /// number of context lines displayed before each filtered line
+    unsigned context_before = 0;
+    /// number of context lines displayed after each filtered line
+    unsigned context_after = 0;
+
     /// current search regular expression string
     std::string search_str;
     /// compiled search regular expression
     std::wregex search_rgx;
     /// error string if search regular expression could not be compiled
     std::string search_err;
+    /// incremented when the search regular expression changes
+    unsigned search_generation = 0;
     /// the y position of the search window
     unsigned search_y;
 
     /// regular expression to match links
     std::wregex link_rgx(L"(ht|f)tps?://[a-zA-Z0-9/~&=%_.-]+", std::regex::ECMAScript | std::regex::optimize | std::regex::icase);
-    typedef std::pair<unsigned, unsigned> coordinate_t;
-    std::map<coordinate_t, std::wstring> link;
 
     /// regular expression to match emails
     /// see http://www.regular-expressions.info/email.html
     std::wregex email_rgx(L"\\b[a-z0-9._%+-]+\\@[a-z0-9.-]+\\.[a-z]{2,4}\\b", std::regex::ECMAScript | std::regex::optimize | std::regex::icase);
-    std::map<coordinate_t, std::wstring> email;
+
+    /// when links and emails are detected.
+    enum link_mode_t {
+	/// never
+	links_off,
+	/// in a line that was clicked
+	links_click,
+	/// in all displayed lines, which are underlined
+	links_select,
+    };
+    link_mode_t link_mode = links_click;
+
+    /// the arguments of rendered_line::print() for a row of the lines window.
+    struct screen_row_t
+    {
+	/// line number, 0 if the row does not show text.
+	line_number_t n_;
+	size_t i_;
+	unsigned x_;
+	unsigned tab_offset_;
+    };
+    /// the rows of the lines window, used to find the character that was clicked.
+    std::vector<screen_row_t> screen_rows;
 
     /// the file that is displayed
     file_index::ptr_t f_idx;
@@ -132,6 +173,15 @@ namespace {
     /// the y position of the lines filter regex window
     unsigned filter_y;
 
+    /// current filter expression string
+    std::string filter_expr_str;
+    /// parsed filter expression; nullptr if all lines filters are combined with AND
+    std::shared_ptr<const filter_expression> filter_expr;
+    /// error string if the filter expression could not be parsed or evaluated
+    std::string filter_expr_err;
+    /// the y position of the filter expression window
+    unsigned filter_expr_y;
+
     struct regex_container_t
     {
 	/// the regular expression string
@@ -141,6 +191,8 @@ namespace {
 
 	/// object used for lines filter
 	std::shared_ptr<regex_index> ri_;
+	/// progress of the background match of ri_
+	std::shared_ptr<AtomicProgressFunctor> progress_;
 
 	///@{
 
@@ -163,13 +215,6 @@ namespace {
 
     typedef std::vector<std::shared_ptr<regex_container_t>> regex_vec_t;
 
-    /**
-     * type of a regex_container_t cache.
-     * key is the regular expression string and has to be equal to value->rgx_.
-     * value is a shared pointer to the regex container object.
-     */
-    typedef std::map<std::string, std::shared_ptr<regex_container_t>> regex_cache_t;
-
     /// the regular expressions for the display and filter regex
     regex_vec_t regex_vec;
 
@@ -180,32 +225,58 @@ namespace {
 	}
     }
 
-    /// the filter regex cache
-    regex_cache_t filter_cache;
+    /// the filter regex cache, key is the normalized regular expression string
+    filter_cache regex_cache;
 
-    /// @return number of digits in i.
-    int digits(uint64_t i)
+    /**
+     * wait until the background threads counted by running have finished.
+     * These threads keep the file_index alive, which must be released
+     * before the static objects of memorymap.cc are destroyed.
+     */
+    void wait_for_threads(const std::atomic<unsigned>& running)
     {
-	if (i < 10llu) return 1;
-	if (i < 100llu) return 2;
-	if (i < 1000llu) return 3;
-	if (i < 10000llu) return 4;
-	if (i < 100000llu) return 5;
-	if (i < 1000000llu) return 6;
-	if (i < 10000000llu) return 7;
-	if (i < 100000000llu) return 8;
-	if (i < 1000000000llu) return 9;
-	if (i < 10000000000llu) return 10;
-	if (i < 100000000000llu) return 11;
-	if (i < 1000000000000llu) return 12;
-	if (i < 10000000000000llu) return 13;
-	if (i < 100000000000000llu) return 14;
-	if (i < 1000000000000000llu) return 15;
-	if (i < 10000000000000000llu) return 16;
-	if (i < 100000000000000000llu) return 17;
-	if (i < 1000000000000000000llu) return 18;
-	if (i < 10000000000000000000llu) return 19;
-	return 20;
+	while(running > 0) {
+	    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+    }
+
+    /// the persistent cache of the line index and the lines filters of the file; nullptr if disabled.
+    std::shared_ptr<index_cache> idx_cache;
+
+    /// number of background threads that write index cache files.
+    std::atomic<unsigned> idx_cache_writers(0);
+
+    /// set at exit to discard the index cache files which are not completely written.
+    std::atomic<bool> idx_cache_cancel(false);
+
+    typedef std::vector<std::pair<std::string, std::shared_ptr<regex_index>>> cached_regex_vec_t;
+
+    /**
+     * write index cache files in a background thread.
+     * @param lines if true write the line index of the file.
+     * @param regexes lines filters whose matches are written.
+     */
+    void save_index_cache(const bool lines, const cached_regex_vec_t& regexes)
+    {
+	if (! idx_cache || (! lines && regexes.empty())) {
+	    return;
+	}
+	auto cache = idx_cache;
+	auto fi = f_idx;
+	const std::string filename = real_filename;
+	++idx_cache_writers;
+	std::thread t([cache, fi, filename, lines, regexes]() mutable {
+	    if (lines) {
+		cache->save_lines(filename, *fi, &idx_cache_cancel);
+	    }
+	    for(const auto& r : regexes) {
+		cache->save_regex(filename, *fi, r.first, *r.second, &idx_cache_cancel);
+	    }
+	    // realmain() waits for the writers before it releases the memory map
+	    fi.reset();
+	    --idx_cache_writers;
+	});
+	t.detach();
     }
 
     /// fill the row y between x and screen_width with space characters.
@@ -243,12 +314,6 @@ namespace {
 	return x;
     }
 
-    void mvaddwch(unsigned y, unsigned x, wchar_t c)
-    {
-	wchar_t wc[2] = { c, 0 };
-	mvaddwstr(y, x, wc);
-    }
-
     void refresh_info()
     {
 	if (info.empty()) {
@@ -261,50 +326,336 @@ namespace {
 	mvprintw(w_lines_height - 1, screen_width - info.size(), "%s", info.c_str());
     }
 
+    /// print a separator between two groups of lines that are not contiguous.
+    void print_group_separator(const unsigned y, const unsigned line_num_width)
+    {
+	unsigned x = 0;
+	{
+	    curses_attr a(A_REVERSE | color(COLOR_WHITE, COLOR_BLACK));
+	    for (; x < line_num_width; ++x) {
+		mvaddch(y, x, ' ');
+	    }
+	}
+	curses_attr a(gray_on_black);
+	mvprintw(y, x, "--");
+	fill(y, x + 2);
+    }
+
+    /// changes whenever the displayed text of lines changes, e.g. by a replace display filter.
+    unsigned display_generation = 0;
+
+    /// the number of screen rows of the displayed lines.
+    line_layout layout;
+
+    /// @return the text of line after applying the Replace Display Filters.
+    std::string replaced_text(const line_t& line)
+    {
+	std::string l = line.to_string();
+	if (! l.empty()) {
+	    for (auto df : regex_vec) {
+		if (df->replace_df_rgx_) {
+		    l = std::regex_replace(l, *(df->replace_df_rgx_), df->replace_df_text_);
+		}
+	    }
+	}
+	return l;
+    }
+
+    /// lines prepared for the lines window.
+    render_cache rendered;
+
+    /// true if long lines are wrapped; false if only a window of each line is displayed in a single row.
+    bool wrap_lines = true;
+
+    /// the first displayed column of the lines if wrap_lines is false.
+    uint64_t window_column = 0;
+
+    /// number of columns rendered left and right of the window, so regular expressions can match at its edges.
+    const uint64_t window_margin = 256;
+
+    /// column indexes of lines displayed in a window.
+    std::unordered_map<line_number_t, std::shared_ptr<const column_index>> column_indexes;
+    /// the display generation and tab width of column_indexes.
+    unsigned column_indexes_generation = 0;
+    unsigned column_indexes_tab_width = 0;
+
+    /// @return the column index of line number n, which has the displayed bytes [s..s+len).
+    std::shared_ptr<const column_index> line_columns(line_number_t n, const char *s, size_t len)
+    {
+	if (column_indexes_generation != display_generation || column_indexes_tab_width != tab_width || column_indexes.size() >= 1024) {
+	    column_indexes.clear();
+	    column_indexes_generation = display_generation;
+	    column_indexes_tab_width = tab_width;
+	}
+	auto& idx = column_indexes[n];
+	if (! idx) {
+	    idx = std::make_shared<column_index>(s, len, tab_width);
+	}
+	return idx;
+    }
+
+    /**
+     * look for links and emails in l and underline them.
+     * Lines without "://" or "@" are skipped without running the regular expressions.
+     */
+    void detect_targets(rendered_line& l)
+    {
+	l.targets_detected_ = true;
+	const std::wstring& wline = l.text_;
+	if (l.line_.find("://") != std::string::npos) {
+	    for (auto it = std::wsregex_iterator(wline.begin(), wline.end(), link_rgx); it != std::wsregex_iterator(); ++it) {
+		const size_t b = it->position();
+		const size_t e = b + it->length();
+		l.link_.push_back(rendered_line::target { b, e, it->str() });
+		l.add_attr(b, e, 0, A_UNDERLINE);
+	    }
+	}
+	if (l.line_.find('@') != std::string::npos) {
+	    for (auto it = std::wsregex_iterator(wline.begin(), wline.end(), email_rgx); it != std::wsregex_iterator(); ++it) {
+		const size_t b = it->position();
+		const size_t e = b + it->length();
+		l.email_.push_back(rendered_line::target { b, e, it->str() });
+		l.add_attr(b, e, 0, A_UNDERLINE);
+	    }
+	}
+    }
+
+    /// apply the Attribute Display Filters and the search regex to l; look for links and emails if they are selectable.
+    void highlight(rendered_line& l)
+    {
+	const std::wstring& wline = l.text_;
+
+	// apply Attribute Display Filters
+	for(auto df : regex_vec) {
+	    if (df->attribute_df_rgx_) {
+		for(auto it = std::wsregex_iterator(wline.begin(), wline.end(), *(df->attribute_df_rgx_)), it_end = std::wsregex_iterator(); it != it_end; ++it) {
+		    // clear any previous color and set new attribute and color
+		    l.add_attr(it->position(), it->position() + it->length(), A_COLOR, df->attribute_df_attr_);
+		}
+	    }
+	}
+
+	// apply search?
+	if (search_err.empty()) {
+	    // apply search regex to line
+	    for (auto it = std::wsregex_iterator(wline.begin(), wline.end(), search_rgx); it != std::wsregex_iterator(); ++it) {
+		l.add_attr(it->position(), it->position() + it->length(), A_COLOR, use_color() ? (color(COLOR_GREEN, COLOR_BLACK) | A_BOLD) : A_REVERSE);
+	    }
+	}
+
+	if (link_mode == links_select) {
+	    detect_targets(l);
+	}
+    }
+
+    /// @return true if a Replace Display Filter is set.
+    bool has_replace_display_filter()
+    {
+	for (auto df : regex_vec) {
+	    if (df->replace_df_rgx_) {
+		return true;
+	    }
+	}
+	return false;
+    }
+
+    /**
+     * prepare the window of line number n that is displayed from window_column.
+     * Only the bytes of the window and window_margin columns around it are decoded and highlighted.
+     */
+    void render_window(line_number_t n, rendered_line& l)
+    {
+	const line_t line = f_idx->line(n);
+	std::string replaced;
+	const char *s = line.beg_;
+	size_t len = line.end_ - line.beg_;
+	if (has_replace_display_filter()) {
+	    replaced = replaced_text(line);
+	    s = replaced.data();
+	    len = replaced.size();
+	}
+	auto idx = line_columns(n, s, len);
+	const uint64_t begin_col = (window_column > window_margin) ? window_column - window_margin : 0;
+	uint64_t end_col;
+	const size_t b = idx->find(s, len, begin_col, l.column_);
+	const size_t e = idx->find(s, len, window_column + screen_width + window_margin, end_col);
+	l.length_ = idx->characters();
+	l.columns_ = idx->columns();
+	l.line_.assign(s + b, s + e);
+	to_wide(l.line_.data(), l.line_.size(), l.text_);
+    }
+
+    /**
+     * prepare line number n for the lines window.
+     * Apply the Replace and Attribute Display Filters, the search regex and look for links and emails.
+     */
+    render_cache::ptr_t render_line(line_number_t n)
+    {
+	rendered.generation(display_generation);
+	auto r = rendered.find(n);
+	if (r) {
+	    return r;
+	}
+
+	auto l = std::make_shared<rendered_line>();
+	if (wrap_lines) {
+	    l->line_ = replaced_text(f_idx->line(n));
+	    to_wide(l->line_.data(), l->line_.size(), l->text_);
+	    l->length_ = l->text_.size();
+	} else {
+	    render_window(n, *l);
+	}
+	highlight(*l);
+
+	rendered.add(n, l);
+	return l;
+    }
+
+    /// @return the text of line number n as it is displayed.
+    std::wstring displayed_text(line_number_t n)
+    {
+	return render_line(n)->text_;
+    }
+
+    /// @return true if groups of lines that are not contiguous are separated by a row.
+    bool has_group_separators()
+    {
+	return context_before > 0 || context_after > 0;
+    }
+
+    /**
+     * find the top line that displays the lines above n.
+     * @param max_rows number of screen rows above n.
+     */
+    line_number_t layout_top_above(line_number_t n, unsigned max_rows)
+    {
+	layout.configure(screen_width, tab_width, display_generation, wrap_lines);
+	return layout.top_above(*display_info->lines(), n, max_rows, has_group_separators(), displayed_text);
+    }
+
+    /**
+     * print the left info column of a row.
+     * @param first true if this is the first row of line number n.
+     * @return the column after the info column.
+     */
+    unsigned print_row_prefix(const unsigned y, const line_number_t n, const bool first, const size_t line_len, const unsigned line_num_width)
+    {
+	unsigned x = 0;
+	// are we at the start of the line?
+	if (first) {
+	    // print line number
+	    x += print_line_prefix(y, n, line_len, line_num_width);
+	}
+	else {
+	    // print empty space
+	    curses_attr a(A_REVERSE | color(COLOR_WHITE, COLOR_BLACK));
+	    for (; x < line_num_width; ++x) {
+		mvaddch(y, x, ' ');
+	    }
+	}
+	// on the upper line, print percentage of position into the displayed lines
+	if (y == 0 && display_info->has_counts()) {
+	    curses_attr a(A_REVERSE | A_BOLD | color(COLOR_WHITE, COLOR_BLACK));
+	    mvprintw(y, 0, "%u%%", display_info->perc(n));
+	}
+	return x;
+    }
+
+    /// print the window of line number n that starts at window_column in row y.
+    void print_window_row(const unsigned y, const line_number_t n, const rendered_line& rl, const unsigned line_num_width)
+    {
+	const unsigned text_x = print_row_prefix(y, n, true, rl.length_, line_num_width);
+	if (text_x >= screen_width) {
+	    return;
+	}
+
+	// skip the characters left of the window
+	const std::wstring& wline = rl.text_;
+	size_t i = 0;
+	uint64_t col = rl.column_;
+	while (i < wline.size() && col < window_column) {
+	    col += (wline[i] == '\t') ? tab_width - col % tab_width : 1;
+	    ++i;
+	}
+
+	curses_attr a(gray_on_black);
+	// a tab character crosses the left edge of the window
+	unsigned x = text_x;
+	for (; col > window_column + (x - text_x) && x < screen_width; ++x) {
+	    mvaddch(y, x, ' ');
+	}
+	const unsigned tab_offset = (col % tab_width + tab_width - x % tab_width) % tab_width;
+	screen_rows[y] = screen_row_t { n, i, x, tab_offset };
+	x = rl.print(i, y, x, screen_width, tab_width, tab_offset);
+	fill(y, x);
+
+	// show how many columns are hidden left and right of the window
+	curses_attr r(A_REVERSE | color(COLOR_WHITE, COLOR_BLACK));
+	if (window_column > 0 && rl.columns_ > 0) {
+	    const std::string m = "<" + std::to_string(std::min(window_column, rl.columns_));
+	    mvaddnstr(y, text_x, m.c_str(), screen_width - text_x);
+	}
+	const uint64_t end_col = window_column + (screen_width - text_x);
+	if (rl.columns_ > end_col) {
+	    const std::string m = std::to_string(rl.columns_ - end_col) + ">";
+	    if (m.size() <= screen_width - text_x) {
+		mvaddstr(y, screen_width - m.size(), m.c_str());
+	    }
+	}
+    }
+
     void refresh_lines_window()
     {
 	assert(tab_width > 0);
-	link.clear();
-	email.clear();
+	screen_rows.assign(w_lines_height, screen_row_t { 0, 0, 0, 0 });
 	clear_word_set();
 
 	middle_line_number = 0;
 	unsigned y = 0;
+	line_number_t prev_line_num = 0;
 	if (display_info->start()) {
 	    while (y < w_lines_height) {
 		const line_number_t current_line_num = display_info->current();
+
+		// with context lines, separate groups of lines like grep does
+		if (has_group_separators() && prev_line_num != 0 && current_line_num != prev_line_num + 1) {
+		    print_group_separator(y, line_layout::prefix_width(current_line_num, tab_width));
+		    if (++y >= w_lines_height) {
+			// the current line is not displayed
+			display_info->prev();
+			return;
+		    }
+		}
+		prev_line_num = current_line_num;
+
 		if (y < w_lines_height / 2) {
 		    middle_line_number = current_line_num;
 		}
 
-		line_t line = f_idx->line(current_line_num);
-		assert(current_line_num == line.num_);
+		const unsigned line_num_width = line_layout::prefix_width(current_line_num, tab_width);
+		auto rl = render_line(current_line_num);
+		const std::wstring& wline = rl->text_;
 
-		unsigned line_num_width = digits(current_line_num);
-		if (line_num_width < tab_width) {
-		    line_num_width = tab_width;
-		}
-		if (line_num_width < 8) {
-		    line_num_width = 8;
-		}
+		// print a window of the line in a single row
+		if (! wrap_lines) {
+		    print_window_row(y, current_line_num, *rl, line_num_width);
+		    add_to_word_set(std::shared_ptr<const std::string>(rl, &rl->line_));
 
-		// apply Replace Display Filters
-		if (! line.empty()) {
-		    static std::string l;
-		    l = line.to_string();
-
-		    for (auto df : regex_vec) {
-			if (df->replace_df_rgx_) {
-			    l = std::regex_replace(l, *(df->replace_df_rgx_), df->replace_df_text_);
-			}
+		    // are we at the end of the lines window?
+		    if (++y >= w_lines_height) {
+			return;
+		    }
+		    if (display_info->next()) {
+			continue;
+		    }
+		    else {
+			break;
 		    }
-
-		    line.assign(l);
 		}
 
 		// handle empty line
-		if (line.empty()) {
-		    unsigned x = print_line_prefix(y, line.num_, 0, line_num_width);
+		if (wline.empty()) {
+		    unsigned x = print_line_prefix(y, current_line_num, 0, line_num_width);
 		    fill(y, x);
 
 		    // are we at the end of the lines window?
@@ -321,127 +672,16 @@ namespace {
 		    }
 		}
 
-		add_to_word_set(line.to_string());
-		auto wline = to_wide(line.to_string());
-
-		// map of pointers into the line and a corresponding curses attribute for the character
-		std::map<std::wstring::iterator, curses_attr_t> character_attr;
-
-		// apply Attribute Display Filters
-		for(auto df : regex_vec) {
-		    if (df->attribute_df_rgx_) {
-			for(auto it = std::wsregex_iterator(wline.begin(), wline.end(), *(df->attribute_df_rgx_)), it_end = std::wsregex_iterator(); it != it_end; ++it) {
-			    std::wstring::iterator b = wline.begin() + it->position();
-			    std::wstring::iterator e = b + it->length();
-			    assert(b <= e);
-			    // set character attribute for all matched characters
-			    for (std::wstring::iterator i = b; i != e; ++i) {
-				character_attr[i] &= ~A_COLOR; // clear any previous color
-				character_attr[i] |= df->attribute_df_attr_; // set new attribute and color
-			    }
-			}
-		    }
-		}
-
-		// apply search?
-		if (search_err.empty()) {
-		    // apply search regex to line
-		    for (auto it = std::wsregex_iterator(wline.begin(), wline.end(), search_rgx); it != std::wsregex_iterator(); ++it) {
-			std::wstring::iterator b = wline.begin() + it->position();
-			std::wstring::iterator e = b + it->length();
-			assert(b <= e);
-			// set character attribute for all matched characters
-			for (std::wstring::iterator i = b; i != e; ++i) {
-			    character_attr[i] &= ~A_COLOR; // clear any previous color
-			    character_attr[i] |= (use_color() ? (color(COLOR_GREEN, COLOR_BLACK) | A_BOLD) : A_REVERSE);
-			}
-		    }
-		}
-
-		// look for links
-		std::map<std::wstring::iterator, std::wstring> iterator2link;
-		for (auto it = std::wsregex_iterator(wline.begin(), wline.end(), link_rgx); it != std::wsregex_iterator(); ++it) {
-		    std::wstring::iterator b = wline.begin() + it->position();
-		    std::wstring::iterator e = b + it->length();
-		    assert(b <= e);
-		    std::wstring l(b, e);
-		    // set character attribute for all matched characters
-		    for (std::wstring::iterator i = b; i != e; ++i) {
-			character_attr[i] |= A_UNDERLINE;
-			iterator2link[i] = l;
-		    }
-		}
-		// look for emails
-		std::map<std::wstring::iterator, std::wstring> iterator2email;
-		for (auto it = std::wsregex_iterator(wline.begin(), wline.end(), email_rgx); it != std::wsregex_iterator(); ++it) {
-		    std::wstring::iterator b = wline.begin() + it->position();
-		    std::wstring::iterator e = b + it->length();
-		    assert(b <= e);
-		    std::wstring l(b, e);
-		    // set character attribute for all matched characters
-		    for (std::wstring::iterator i = b; i != e; ++i) {
-			character_attr[i] |= A_UNDERLINE;
-			iterator2email[i] = l;
-		    }
-		}
+		add_to_word_set(std::shared_ptr<const std::string>(rl, &rl->line_));
 
 		// print the current line
-		auto it = wline.begin();
-		while (it != wline.end() && y < w_lines_height) {
-		    unsigned x = 0;
-		    // block to print left info column
-		    {
-			// are we at the start of the line?
-			if (it == wline.begin()) {
-			    // print line number
-			    x += print_line_prefix(y, line.num_, wline.size(), line_num_width);
-			}
-			else {
-			    // print empty space
-			    curses_attr a(A_REVERSE | color(COLOR_WHITE, COLOR_BLACK));
-			    for (; x < line_num_width; ++x) {
-				mvaddch(y, x, ' ');
-			    }
-			}
-			// on the upper line, print percentage of position into file
-			if (y == 0) {
-			    curses_attr a(A_REVERSE | A_BOLD | color(COLOR_WHITE, COLOR_BLACK));
-			    mvprintw(y, 0, "%u%%", static_cast<unsigned>(current_line_num * 100llu / display_info->lastLineNum()));
-			}
-		    }
+		size_t i = 0;
+		while (i < wline.size() && y < w_lines_height) {
+		    unsigned x = print_row_prefix(y, current_line_num, i == 0, wline.size(), line_num_width);
 		    // print line in chunks of screen width
 		    curses_attr a(gray_on_black);
-		    for (; it != wline.end() && x < screen_width; ++it) {
-			// check for link
-			auto i = iterator2link.find(it);
-			if (i != iterator2link.end()) {
-			    link.emplace(std::make_pair(x, y), i->second);
-			}
-			// check for email
-			i = iterator2email.find(it);
-			if (i != iterator2email.end()) {
-			    email.emplace(std::make_pair(x, y), i->second);
-			}
-
-			auto c = *it;
-			// handle tab character
-			if (c == '\t') {
-			    do {
-				mvaddch(y, x++, ' ');
-			    } while (x % tab_width);
-			}
-			else {
-			    // replace non printable characters with a space
-			    if (iswprint(c)) {
-				curses_attr a(character_attr[it]);
-				mvaddwch(y, x, c);
-			    }
-			    else {
-				mvaddwch(y, x, L'\uFFFD');
-			    }
-			    ++x;
-			}
-		    }
+		    screen_rows[y] = screen_row_t { current_line_num, i, x, 0 };
+		    x = rl->print(i, y, x, screen_width, tab_width);
 		    fill(y, x);
 
 		    // are we at the end of the lines window?
@@ -451,7 +691,7 @@ namespace {
 		}
 
 		// did we display the full line?
-		if (it == wline.end()) {
+		if (i == wline.size()) {
 		    // do we have another line to display?
 		    if (display_info->next()) {
 			continue; // there is a next line to display
@@ -544,7 +784,13 @@ namespace {
 		    if (num != 1) {
 			s += "es";
 		    }
-		    s += ", " + std::to_string(num * 100llu / f_idx->size()) + "%)";
+		    s += ", " + std::to_string(num * 100llu / f_idx->size()) + "%";
+		    if (verbose) {
+			// compare the memory of the compressed line set with a plain vector of line numbers
+			s += ", " + memory_size_str(c->ri_->lines().memory_usage());
+			s += " vs " + memory_size_str(num * sizeof(line_number_t)) + " as vector";
+		    }
+		    s += ")";
 
 		    X += print_string(y, X, s);
 		}
@@ -571,6 +817,18 @@ namespace {
 	    refresh_lines_window();
 	    refresh_regex_window(filter_y);
 
+	    if (!filter_expr_str.empty()) {
+		curses_attr a(A_BOLD);
+		std::string s = "Filter: " + filter_expr_str;
+		if (! filter_expr_err.empty()) {
+		    s += " : " + filter_expr_err;
+		} else {
+		    s += display_info->has_counts() ? " (" + std::to_string(display_info->size()) + " lines)" : std::string(" (counting lines)");
+		}
+		mvprintw(filter_expr_y, 0, "%s", s.c_str());
+		fill(filter_expr_y, s.size());
+	    }
+
 	    if (!search_str.empty()) {
 		curses_attr a(A_BOLD);
 		mvprintw(search_y, 0, "Search: %s %s", search_str.c_str(), search_err.c_str());
@@ -603,6 +861,9 @@ namespace {
 
 	w_lines_height = screen_height;
 	w_lines_height -= regex_vec.size();
+	if (!filter_expr_str.empty()) {
+	    --w_lines_height;
+	}
 	if (!search_str.empty()) {
 	    --w_lines_height;
 	}
@@ -620,6 +881,8 @@ namespace {
 	    y += regex_vec.size();
 	}
 
+	filter_expr_y = y;
+
 	search_y = screen_height - 1;
     }
 }
@@ -637,7 +900,10 @@ namespace {
 	nonl();
 	intrflush(stdscr, false);
 	keypad(stdscr, true);
+#if ! WAIT_FOR_EVENTS
+	// poll for events of background jobs
 	halfdelay(3);
+#endif
 	mousemask(BUTTON1_CLICKED, nullptr);
 	curs_set(0); // disable cursor
 
@@ -657,6 +923,34 @@ namespace {
 	endwin();
     }
 
+    /**
+     * wait until a key was pressed or a background job added an event.
+     * @param timeout_ms the maximum time to wait in milliseconds; -1 to wait without a timeout.
+     * @return the key; ERR if no key was pressed.
+     */
+    int wait_for_key(const int timeout_ms)
+    {
+#if WAIT_FOR_EVENTS
+	// curses may have buffered keys, which poll() does not see
+	nodelay(stdscr, true);
+	int key = getch();
+	if (key == ERR) {
+	    struct pollfd fds[2];
+	    fds[0].fd = STDIN_FILENO;
+	    fds[0].events = POLLIN;
+	    fds[1].fd = eventFd();
+	    fds[1].events = POLLIN;
+	    // a signal like SIGWINCH interrupts poll(), getch() then returns KEY_RESIZE
+	    poll(fds, 2, timeout_ms);
+	    key = getch();
+	}
+	nodelay(stdscr, false);
+	return key;
+#else
+	return getch();
+#endif
+    }
+
 namespace {
     void key_up()
     {
@@ -698,21 +992,8 @@ namespace {
 	} else if (display_info->isFirstLineDisplayed()) {
 	    info = "moved to top";
 	} else {
-	    const line_number_t oldTopLineNum = display_info->current();
-
-	    // scroll up one page, even if it is too far.
-	    for(unsigned i = 0; i < w_lines_height - 1; ++i) {
-		display_info->up();
-	    }
-
-	    // render lines
-	    refresh_lines_window();
-
-	    // now scroll down, until old top line is at the bottom
-	    while(display_info->bottomLineNum() < oldTopLineNum) {
-		display_info->down();
-		refresh_lines_window();
-	    }
+	    // scroll up one page, so the old top line is the bottom line
+	    display_info->go_to(layout_top_above(display_info->topLineNum(), w_lines_height - 1));
 	}
 
 	refresh_lines_window();
@@ -739,18 +1020,8 @@ namespace {
 	} else if (display_info->isLastLineDisplayed()) {
 	    info = "moved to bottom";
 	} else {
-	    const line_number_t lastLineNum = display_info->lastLineNum();
-	    display_info->go_to(lastLineNum);
-	    // scroll up until we don't print the last line any more
-	    while (!display_info->isFirstLineDisplayed()) {
-		display_info->up();
-		refresh_lines_window();
-		if (display_info->bottomLineNum() != lastLineNum) {
-		    break;
-		}
-	    }
-	    // now scroll down again one line, so we see the last line
-	    display_info->down();
+	    // show as many lines above the last line as fit on the screen
+	    display_info->go_to(layout_top_above(display_info->lastLineNum(), w_lines_height - 1));
 	}
 	refresh_lines_window();
 	refresh();
@@ -773,44 +1044,209 @@ namespace {
 	}
 	// scroll up until the old middle line number is the bottom line
 	const line_number_t old_mln = middle_line_number;
-	while (!display_info->isFirstLineDisplayed() && display_info->bottomLineNum() > old_mln) {
-	    display_info->up();
-	    refresh_lines_window();
+	layout.configure(screen_width, tab_width, display_generation, wrap_lines);
+	const unsigned r = layout.rows(old_mln, displayed_text);
+	const line_number_t top = layout.top_covering(*display_info->lines(), old_mln, (r < w_lines_height) ? w_lines_height - r : 0, has_group_separators(), displayed_text);
+	if (top < display_info->topLineNum()) {
+	    display_info->go_to(top);
 	}
+	refresh_lines_window();
 	refresh();
     }
 
-    // \todo maybe background search?
-    void key_n()
+    /// the matches of the search regex in the displayed lines, built in the background.
+    search_index::ptr_t search_idx;
+    /// the search_generation of search_idx.
+    unsigned search_idx_generation = 0;
+    /// the DisplayInfo::generation() of the lines of search_idx.
+    unsigned search_idx_display = 0;
+    /// number of running threads that build a search_index.
+    std::atomic<unsigned> search_index_builders(0);
+    /// a search that waits for search_idx: 1 for the next match, -1 for the previous match, 0 for none.
+    int pending_search = 0;
+
+    /// a percentage that waits until the displayed lines are counted; -1 for none.
+    int pending_perc = -1;
+
+    /// a parallel search for the match nearest to a pending search, used until search_idx knows the match.
+    struct nearest_search_t
     {
-	info = "searching...";
-	refresh_lines_window();
-	refresh_info();
-	refresh();
-	if (! search_next(search_rgx, display_info, f_idx)) {
-	    info = "did not find any next search match";
-	} else {
-	    info = "next match found";
+	/// the index whose regex and lines are searched.
+	const search_index::ptr_t idx_;
+	/// the pending_search value.
+	const int dir_;
+	/// the line number where the search starts.
+	const line_number_t start_;
+	std::atomic<bool> cancel_;
+	/// set after found_ and line_ are valid.
+	std::atomic<bool> done_;
+	bool found_;
+	line_number_t line_;
+
+	nearest_search_t(search_index::ptr_t idx, int dir, line_number_t start) :
+	    idx_(idx),
+	    dir_(dir),
+	    start_(start),
+	    cancel_(false),
+	    done_(false),
+	    found_(false),
+	    line_(0)
+	{}
+    };
+    std::shared_ptr<nearest_search_t> nearest_search;
+
+    /// number of running threads of nearest searches.
+    std::atomic<unsigned> nearest_searches(0);
+
+    /// stop a running nearest_search.
+    void cancel_nearest_search()
+    {
+	if (nearest_search) {
+	    nearest_search->cancel_ = true;
+	    nearest_search.reset();
 	}
-	refresh_lines_window();
-	refresh_info();
-	refresh();
     }
 
-    void key_N()
+    /**
+     * ask nearest_search for the match of the pending search and start it in a background thread if needed.
+     * @return search_index::unknown while the search is running.
+     */
+    search_index::result_t nearest_search_result(const line_number_t top, line_number_t& out)
     {
-	info = "searching...";
-	refresh_lines_window();
-	refresh_info();
-	refresh();
-	if (! search_prev(search_rgx, display_info, f_idx)) {
-	    info = "did not find any next search match";
+	if (nearest_search && (nearest_search->idx_ != search_idx || nearest_search->dir_ != pending_search || nearest_search->start_ != top)) {
+	    cancel_nearest_search();
+	}
+	if (! nearest_search) {
+	    auto s = std::make_shared<nearest_search_t>(search_idx, pending_search, top);
+	    auto fi = f_idx;
+	    ++nearest_searches;
+	    std::thread t([s, fi]() mutable {
+		    s->found_ = search_nearest(s->idx_->rgx(), *s->idx_->lines(), *fi, s->start_, s->dir_ > 0, s->line_, &s->cancel_);
+		    s->done_ = true;
+		    if (! s->cancel_) {
+			// wake up the main loop
+			eventAdd(event(std::string()));
+		    }
+		    // realmain() waits for the searches before it releases the memory map
+		    s.reset();
+		    fi.reset();
+		    --nearest_searches;
+		});
+	    t.detach();
+	    nearest_search = s;
+	    return search_index::unknown;
+	}
+	if (! nearest_search->done_) {
+	    return search_index::unknown;
+	}
+	out = nearest_search->line_;
+	return nearest_search->found_ ? search_index::found : search_index::not_found;
+    }
+
+    /// build search_idx in a background thread if the search regex or the displayed lines changed.
+    void update_search_index()
+    {
+	if (search_str.empty() || ! search_err.empty()) {
+	    if (search_idx) {
+		search_idx->cancel();
+		search_idx.reset();
+	    }
+	    return;
+	}
+	const display_snapshot snap = display_info->snapshot();
+	if (search_idx && search_idx_display == snap.generation_ && search_idx_generation == search_generation) {
+	    return;
+	}
+	if (search_idx) {
+	    search_idx->cancel();
+	}
+	try {
+	    search_idx = std::make_shared<search_index>(snap.lines_, search_str, display_info->topLineNum());
+	} catch (std::exception& e) {
+	    search_idx.reset();
+	    search_err = std::string(": ") + e.what();
+	    return;
+	}
+	search_idx_generation = search_generation;
+	search_idx_display = snap.generation_;
+	auto idx = search_idx;
+	auto fi = f_idx;
+	++search_index_builders;
+	std::thread t([idx, fi]() mutable {
+		if (idx->build(*fi)) {
+		    // wake up the main loop for a pending search
+		    eventAdd(event(std::string()));
+		}
+		// realmain() waits for the builders before it releases the memory map
+		idx.reset();
+		fi.reset();
+		--search_index_builders;
+	    });
+	t.detach();
+    }
+
+    /**
+     * go to the search match in the direction of pending_search, if search_idx knows it.
+     * @return true if the search is still pending.
+     */
+    bool resolve_pending_search()
+    {
+	if (pending_search == 0) {
+	    return false;
+	}
+	if (! search_idx) {
+	    pending_search = 0;
+	    cancel_nearest_search();
+	    return false;
+	}
+	line_number_t n = 0;
+	const line_number_t top = display_info->topLineNum();
+	auto r = (pending_search > 0) ? search_idx->next(top, n) : search_idx->prev(top, n);
+	if (r == search_index::unknown) {
+	    // search the remaining lines in parallel, which is faster than waiting for the index
+	    r = nearest_search_result(top, n);
+	}
+	if (r == search_index::unknown) {
+	    info = "searching... " + std::to_string(search_idx->perc()) + "%";
+	    return true;
+	}
+	cancel_nearest_search();
+	if (r == search_index::not_found) {
+	    info = (pending_search > 0) ? "did not find any next search match" : "did not find any previous search match";
 	} else {
-	    info = "prev match found";
+	    const bool b = display_info->go_to(n);
+	    assert(b);
+	    if (search_idx->complete()) {
+		info = "match " + std::to_string(search_idx->rank(n)) + " of " + std::to_string(search_idx->size());
+	    } else {
+		info = "match found, counting " + std::to_string(search_idx->perc()) + "%";
+	    }
 	}
+	pending_search = 0;
 	refresh_lines_window();
-	refresh_info();
-	refresh();
+	return false;
+    }
+
+    /// go to the next (dir 1) or previous (dir -1) search match.
+    void search(const int dir)
+    {
+	// restart an index that was aborted
+	if (search_idx && search_idx->canceled()) {
+	    search_idx.reset();
+	}
+	update_search_index();
+	pending_search = dir;
+	resolve_pending_search();
+    }
+
+    void key_n()
+    {
+	search(1);
+    }
+
+    void key_N()
+    {
+	search(-1);
     }
 
     void key_h()
@@ -845,66 +1281,221 @@ namespace {
 	if (getmouse(&e) != OK) {
 	    return;
 	}
-	if (e.bstate & BUTTON1_CLICKED) {
-	    // check for link
-	    auto it = link.find(std::make_pair(static_cast<unsigned>(e.x), static_cast<unsigned>(e.y)));
-	    if (it != link.end()) {
-		const std::string l = to_utf8(it->second);
-		if (click_link(l, info)) {
-		    info = "opened " + l + " in browser";
-		}
-		refresh_lines_window();
-		refresh();
+	if (! (e.bstate & BUTTON1_CLICKED) || link_mode == links_off) {
+	    return;
+	}
+	if (e.y < 0 || static_cast<size_t>(e.y) >= screen_rows.size() || e.x < 0) {
+	    return;
+	}
+	const screen_row_t& row = screen_rows[e.y];
+	if (row.n_ == 0) {
+	    return;
+	}
+	auto rl = render_line(row.n_);
+	// detect the links and emails of the clicked line once, the render cache keeps them
+	if (! rl->targets_detected_) {
+	    auto l = std::make_shared<rendered_line>(*rl);
+	    detect_targets(*l);
+	    rendered.add(row.n_, l);
+	    rl = l;
+	}
+	const size_t i = rl->index_at(row.i_, row.x_, e.x, screen_width, tab_width, row.tab_offset_);
+	if (const rendered_line::target *t = rendered_line::find_target(rl->link_, i)) {
+	    const std::string l = to_utf8(t->str_);
+	    if (click_link(l, info)) {
+		info = "opened " + l + " in browser";
 	    }
-	    // check for emails
-	    it = email.find(std::make_pair(static_cast<unsigned>(e.x), static_cast<unsigned>(e.y)));
-	    if (it != email.end()) {
-		const std::string e = to_utf8(it->second);
-		if (click_email(e, command_line_filename, info)) {
-		    info = "created email to " + e;
-		}
-		refresh_lines_window();
-		refresh();
+	}
+	else if (const rendered_line::target *t = rendered_line::find_target(rl->email_, i)) {
+	    const std::string e = to_utf8(t->str_);
+	    if (click_email(e, command_line_filename, info)) {
+		info = "created email to " + e;
 	    }
 	}
+	refresh_lines_window();
+	refresh();
     }
 
+    /// intersects the lines filters and caches partial results.
+    std::shared_ptr<filter_engine> intersect_engine = std::make_shared<filter_engine>();
+
     /**
-     * provision the display_info object.
-     * use the lines from f_idx and filter with the regular expression vector filter_vec.
+     * compute the lines to display.
+     * @param expr if not nullptr, combine the slots with this expression instead of intersecting all slots.
+     * @param slots the line sets of the lines filters, nullptr for slots without a lines filter.
+     * @param fi the file. Without lines filters all lines of fi are displayed, which grow with the file index.
+     * @param size number of lines in the file.
+     * @param before number of context lines before each selected line.
+     * @param after number of context lines after each selected line.
+     * @param cancel if set to true, the computation stops early.
+     * @return the lines of the file that are selected by the slots, widened by the context lines.
+     * @throws std::runtime_error if expr uses a slot without a lines filter.
      */
-    void intersect_regex(ProgressFunctor *func)
+    display_set::ptr_t filter_lines(filter_engine& engine, const filter_expression *expr, const std::vector<filter_engine::set_ptr>& slots, file_index::ptr_t fi, const line_number_t size, const unsigned before, const unsigned after, const std::atomic<bool> *cancel)
     {
-	// set up a vector regex_index lineNum_vector iterator pairs
-	std::shared_ptr<regex_index> ri;
-	lineNum_vector_intersect_vector_t v;
+	filter_engine::set_ptr s;
+	if (expr) {
+	    s = std::make_shared<line_set>(expr->evaluate(slots, size));
+	} else {
+	    s = engine.intersect(slots, cancel);
+	}
+	// if there are no lines filters, show the complete file
+	if (! s) {
+	    return std::make_shared<identity_display>(fi);
+	}
+	// add context lines
+	if (before > 0 || after > 0) {
+	    return std::make_shared<line_set_display>(s->dilate(before, after, size));
+	}
+	// a single lines filter is displayed without a copy
+	return std::make_shared<line_set_display>(s);
+    }
+
+    /// @return the line sets of all regex slots, nullptr for slots without a lines filter.
+    std::vector<filter_engine::set_ptr> filter_slots()
+    {
+	std::vector<filter_engine::set_ptr> v;
 	for(auto c : regex_vec) {
 	    if (c->ri_) {
-		ri = c->ri_;
-		const auto& s = ri->lineNum_vector();
-		v.push_back(std::make_pair(s.begin(), s.end()));
+		// the line set is owned by the regex_index object
+		v.push_back(filter_engine::set_ptr(c->ri_, &(c->ri_->lines())));
+	    } else {
+		v.push_back(filter_engine::set_ptr());
 	    }
 	}
+	return v;
+    }
 
-	lineNum_vector_t s;
+    /**
+     * enforce the memory budget of the filter cache. The cached
+     * intersections of filters that are no longer in a slot are dropped
+     * first, otherwise they keep the filters resident.
+     */
+    void trim_filter_cache()
+    {
+	intersect_engine->retain(filter_slots());
+	regex_cache.trim();
+    }
 
-	// if there are no regex_index objects found, show the complete file
-	if (v.empty()) {
-	    s = f_idx->lineNum_vector();
-	} else if (v.size() == 1) {
-	    // if there is only a single regex_index object, use that one
-	    s = ri->lineNum_vector();
-	} else {
-	    multiple_set_intersect(v.begin(), v.end(), std::back_insert_iterator<lineNum_vector_t>(s));
+    /**
+     * @param expr a filter expression.
+     * @param slots the line sets of the lines filters, see filter_slots().
+     * @return an error message if expr uses a slot without a lines filter; an empty string otherwise.
+     */
+    std::string check_filter_slots(const filter_expression& expr, const std::vector<filter_engine::set_ptr>& slots)
+    {
+	for(auto u : expr.slots()) {
+	    if (u >= slots.size() || ! slots[u]) {
+		return "slot " + std::to_string(u + 1) + " is not a lines filter";
+	    }
 	}
+	return std::string();
+    }
 
-	display_info->assign(std::move(s));
+    /**
+     * provision the display_info object.
+     * use the lines from f_idx and filter with the regular expression vector filter_vec.
+     */
+    void intersect_regex()
+    {
+	display_info->assign(filter_lines(*intersect_engine, filter_expr.get(), filter_slots(), f_idx, f_idx->size(), context_before, context_after, nullptr));
     }
 
-    void intersect_regex_curses()
+    /// generation of the most recent background intersection.
+    unsigned intersect_generation = 0;
+    /// cancel flag of the running background intersection.
+    std::shared_ptr<std::atomic<bool>> intersect_cancel;
+    /// number of running threads of background intersections.
+    std::atomic<unsigned> intersections(0);
+
+    /**
+     * compute the lines to display in a background thread.
+     * The intersection of several lines filters is displayed right
+     * away, otherwise the display_info object keeps the previous
+     * lines until process_event_queue() receives the result.
+     */
+    void intersect_regex_background()
+    {
+	auto slots = filter_slots();
+	auto expr = filter_expr;
+	if (expr) {
+	    // wait until all slots used by the filter expression have finished matching
+	    filter_expr_err = check_filter_slots(*expr, slots);
+	    if (! filter_expr_err.empty()) {
+		return;
+	    }
+	}
+
+	if (intersect_cancel) {
+	    *intersect_cancel = true;
+	}
+
+	// display the intersection of the lines filters right away, it
+	// is computed around the displayed lines until the complete
+	// intersection has been computed in the background.
+	if (! expr && context_before == 0 && context_after == 0) {
+	    std::vector<intersection_display::set_ptr> sets;
+	    for(auto& p : slots) {
+		if (p) {
+		    sets.push_back(p);
+		}
+	    }
+	    if (sets.size() > 1) {
+		display_info->assign(std::make_shared<intersection_display>(sets));
+	    }
+	}
+
+	intersect_cancel = std::make_shared<std::atomic<bool>>(false);
+	const unsigned gen = ++intersect_generation;
+	const line_number_t size = f_idx->size();
+	auto cancel = intersect_cancel;
+	auto engine = intersect_engine;
+	auto fi = f_idx;
+	const unsigned before = context_before, after = context_after;
+	++intersections;
+	std::thread t([engine, expr, slots, fi, size, before, after, cancel, gen]() mutable {
+		auto s = filter_lines(*engine, expr.get(), slots, fi, size, before, after, cancel.get());
+		if (! *cancel) {
+		    eventAdd(event(s, gen));
+		}
+		// realmain() waits for the intersections before it releases the memory map
+		s.reset();
+		slots.clear();
+		engine.reset();
+		fi.reset();
+		--intersections;
+	    });
+	t.detach();
+	info = "intersecting...";
+    }
+
+    /// cancel flag of the running background vocabulary count.
+    std::shared_ptr<std::atomic<bool>> vocabulary_cancel;
+    /// number of words in the vocabulary.
+    size_t vocabulary_words = 0;
+    /// number of running threads that count the vocabulary.
+    std::atomic<unsigned> vocabulary_builders(0);
+
+    /// count the words of the whole file in a background thread for the tab completion.
+    void build_vocabulary_background()
     {
-	CursesProgressFunctor func(screen_height / 2, screen_width / 2 - 10, A_REVERSE|A_BOLD, " intersect regex: ");
-	intersect_regex(&func);
+	vocabulary_cancel = std::make_shared<std::atomic<bool>>(false);
+	auto cancel = vocabulary_cancel;
+	// fi keeps the memory mapped file [b..e) alive
+	auto fi = f_idx;
+	const char *b = fi->line(1).beg_;
+	const char *e = fi->line(fi->size()).end_;
+	++vocabulary_builders;
+	std::thread t([fi, b, e, cancel]() mutable {
+		auto v = build_vocabulary(b, e, 1 << 18, cancel.get());
+		if (v) {
+		    eventAdd(event(std::shared_ptr<const word_table>(v)));
+		}
+		// realmain() waits for the builders before it releases the memory map
+		fi.reset();
+		--vocabulary_builders;
+	    });
+	t.detach();
     }
 
     class CursesCursorHelper
@@ -924,8 +1515,15 @@ namespace {
 
     History::ptr_t line_edit_history;
 
-    /// the function pointer type of an autocomplete function.
-    typedef std::set<std::string> (*autocomplete_f)(std::string& path, std::string& err);
+    /// the function pointer type of an autocomplete function. The completions are displayed in the order returned.
+    typedef std::vector<std::string> (*autocomplete_f)(std::string& path, std::string& err);
+
+    /// complete_filename() as an autocomplete_f.
+    std::vector<std::string> complete_filename_list(std::string& path, std::string& err)
+    {
+	const auto s = complete_filename(path, err);
+	return std::vector<std::string>(s.begin(), s.end());
+    }
 
     /**
      * read an input string with curses.
@@ -1199,9 +1797,11 @@ namespace {
      * when done, add an event.
      * This function will be executed in a background thread.
      */
-    void parse_regex(std::shared_ptr<file_index> fi, std::shared_ptr<regex_index> ri, const unsigned idx)
+    void parse_regex(std::shared_ptr<file_index> fi, std::shared_ptr<regex_index> ri, const unsigned idx, std::shared_ptr<AtomicProgressFunctor> progress)
     {
-	if (fi->parse_all_in_background(ri, idx)) {
+	const bool finished = fi->parse_all_in_background(ri, idx, progress.get());
+	progress->finish();
+	if (finished) {
 	    eventAdd(event(ri, idx));
 	}
     }
@@ -1232,11 +1832,12 @@ namespace {
 	// do we have the regex container already in the cache?
 	const bool isFilterRgx = is_filter_regex(rgx);
 	if (isFilterRgx) {
-	    auto it = filter_cache.find(rgx);
-	    if (it != filter_cache.end()) {
-		// check that cache key really matches the value rgx_
-		assert(it->first == it->second->rgx_);
-		regex_vec[regex_num] = it->second;
+	    auto ri = regex_cache.find(rgx);
+	    if (ri) {
+		auto c = std::make_shared<regex_container_t>();
+		c->rgx_ = rgx;
+		c->ri_ = ri;
+		regex_vec[regex_num] = c;
 		info = "found regex in cache";
 		return foundInCache;
 	    }
@@ -1253,8 +1854,21 @@ namespace {
 
 	    if (isFilterRgx) {
 		// Lines Filter
-		auto ri = std::make_shared<regex_index>(rgx);
-		std::thread t(parse_regex, f_idx, ri, regex_num);
+		std::shared_ptr<regex_index> ri;
+		if (idx_cache) {
+		    ri = idx_cache->load_regex(real_filename, *f_idx, rgx);
+		}
+		if (ri && ri->restored() >= f_idx->size()) {
+		    c->ri_ = ri;
+		    regex_cache.add(rgx, ri);
+		    info = "found regex in index cache";
+		    return foundInCache;
+		}
+		if (! ri) {
+		    ri = std::make_shared<regex_index>(rgx);
+		}
+		c->progress_ = std::make_shared<AtomicProgressFunctor>();
+		std::thread t(parse_regex, f_idx, ri, regex_num, c->progress_);
 		t.detach();
 		info = "matching...";
 		return startedBackgroundMatch;
@@ -1311,6 +1925,11 @@ namespace {
     void edit_regex(unsigned& y, const unsigned regex_num)
     {
 	assert(regex_num < max_regex_num);
+	// the filter expression uses the row of the last regex slot
+	if (regex_num + 1 == max_regex_num && ! filter_expr_str.empty()) {
+	    info = "remove the filter expression to use regex " + std::to_string(max_regex_num);
+	    return;
+	}
 	regex_vec_resize(regex_num + 1);
 
 	// abort any currently running job for this regex number
@@ -1329,6 +1948,9 @@ namespace {
 	}
 
 	bool should_intersect = true;
+	if (rgx != c->rgx_) {
+	    ++display_generation;
+	}
 	if (rgx.empty()) {
 	    regex_vec[regex_num] = std::make_shared<regex_container_t>(); // overwrite with new/empty container object
 	    // pop regular expression container from vector if they're empty
@@ -1348,7 +1970,7 @@ namespace {
 	}
 
 	if (should_intersect) {
-	    intersect_regex_curses();
+	    intersect_regex_background();
 	}
 	create_windows();
     }
@@ -1383,8 +2005,10 @@ namespace {
 	int64_t p = atoll(perc.c_str());
 	if (p < 0) {
 	    info = "invalid percentage: " + perc;
-	} else {
-	    display_info->go_to_perc(static_cast<unsigned>(p));
+	} else if (! display_info->go_to_perc(static_cast<unsigned>(std::min<int64_t>(p, 100)))) {
+	    // go there when the background intersection has counted the lines
+	    pending_perc = static_cast<int>(std::min<int64_t>(p, 100));
+	    info = "counting...";
 	}
 	refresh_windows();
     }
@@ -1426,6 +2050,8 @@ namespace {
     {
 	search_str = normalize_regex(str);
 	search_err = compile_regex(str, search_rgx);
+	++display_generation;
+	++search_generation;
 	if (! search_err.empty()) {
 	    search_err = ": " + search_err;
 	}
@@ -1442,6 +2068,98 @@ namespace {
 	create_windows();
     }
 
+    /**
+     * parse the filter expression.
+     * If str is empty or can not be parsed, all lines filters are combined with AND.
+     */
+    void compile_filter_expression(const std::string& str)
+    {
+	filter_expr_str = str;
+	filter_expr.reset();
+	filter_expr_err.clear();
+	if (str.empty()) {
+	    return;
+	}
+	try {
+	    filter_expr = std::make_shared<filter_expression>(str);
+	} catch (std::runtime_error& e) {
+	    filter_expr_err = e.what();
+	}
+    }
+
+    void edit_filter_expression()
+    {
+	{
+	    curses_attr a(A_BOLD);
+	    const std::string title = "Filter Expression: ";
+	    mvprintw(search_y, 0, title.c_str());
+	    const std::string s = line_edit(search_y, title.size(), filter_expr_str, screen_width - title.size(), nullptr);
+	    if (s == filter_expr_str) {
+		create_windows();
+		return;
+	    }
+	    // the filter expression uses the row of the last regex slot
+	    if (! s.empty() && regex_vec.size() >= max_regex_num) {
+		info = "remove regex " + std::to_string(max_regex_num) + " to use a filter expression";
+		create_windows();
+		return;
+	    }
+	    compile_filter_expression(s);
+	}
+	intersect_regex_background();
+	create_windows();
+    }
+
+    /// parse a number of context lines, which only consists of digits.
+    bool parse_context_lines(const std::string& str, unsigned& num)
+    {
+	const std::regex r("\\s*(\\d{1,9})\\s*");
+	std::smatch m;
+	if (! std::regex_match(str, m, r)) {
+	    return false;
+	}
+	num = atoi(m[1].str().c_str());
+	return true;
+    }
+
+    /// parse context lines: "N" for before and after, or "B,A".
+    bool parse_context(const std::string& str, unsigned& before, unsigned& after)
+    {
+	const std::regex r("\\s*(\\d{1,9})\\s*(,\\s*(\\d{1,9})\\s*)?");
+	std::smatch m;
+	if (! std::regex_match(str, m, r)) {
+	    return false;
+	}
+	before = after = atoi(m[1].str().c_str());
+	if (m[3].matched) {
+	    after = atoi(m[3].str().c_str());
+	}
+	return true;
+    }
+
+    void edit_context()
+    {
+	std::string c;
+	{
+	    curses_attr a(A_BOLD);
+	    const std::string title = "Context Lines (N or before,after): ";
+	    mvprintw(search_y, 0, title.c_str());
+	    c = line_edit(search_y, title.size(), "", screen_width - title.size(), nullptr);
+	}
+	if (c.empty()) {
+	    c = "0";
+	}
+	unsigned before = 0, after = 0;
+	if (! parse_context(c, before, after)) {
+	    info = "invalid context lines: " + c;
+	} else if (before != context_before || after != context_after) {
+	    context_before = before;
+	    context_after = after;
+	    intersect_regex_background();
+	}
+	create_windows();
+    }
+
     void edit_shell_cmd()
     {
 	static std::string lastcmd;
@@ -1471,6 +2189,30 @@ namespace {
 #endif
     }
 
+    /**
+     * set the info string to the progress of the running background matches.
+     * @return true if a background match is running.
+     */
+    bool refresh_progress()
+    {
+	std::string s;
+	for(unsigned idx = 0; idx < regex_vec.size(); ++idx) {
+	    const auto& p = regex_vec[idx]->progress_;
+	    if (! p || p->finished()) {
+		continue;
+	    }
+	    if (! s.empty()) {
+		s += ' ';
+	    }
+	    s += "#" + std::to_string(idx + 1u) + " matching line " + std::to_string(p->num()) + " " + std::to_string(p->perc()) + "%";
+	}
+	if (s.empty()) {
+	    return false;
+	}
+	info = s;
+	return true;
+    }
+
     void process_event_queue()
     {
 	bool do_refresh_windows = false;
@@ -1478,47 +2220,86 @@ namespace {
 
 	while(eventPending()) {
 	    event e = eventGet();
+	    if (e.lines_) {
+		// ignore results of superseded background intersections
+		if (e.lines_gen_ == intersect_generation) {
+		    display_info->assign(e.lines_);
+		    intersect_cancel.reset();
+		    if (pending_perc >= 0 && display_info->go_to_perc(static_cast<unsigned>(pending_perc))) {
+			pending_perc = -1;
+		    }
+		    // filters that are no longer used can be evicted now
+		    trim_filter_cache();
+		    do_refresh_windows = true;
+		    info.erase();
+		}
+	    }
 	    if (e.ri_) {
 		assert(e.ri_idx_ < regex_vec.size());
 
 		// get the regex_container_t
 		auto c = regex_vec[e.ri_idx_];
 		c->ri_ = e.ri_;
-		filter_cache[c->rgx_] = c;
+		c->progress_.reset();
+		regex_cache.add(c->rgx_, c->ri_);
+		trim_filter_cache();
+		if (c->ri_->restored() < index_cache::complete_lines(*f_idx)) {
+		    save_index_cache(false, cached_regex_vec_t{std::make_pair(c->rgx_, c->ri_)});
+		}
 
 		do_intersect = true;
 		do_refresh_windows = true;
 		info.erase();
 	    }
+	    if (e.vocabulary_) {
+		set_vocabulary(e.vocabulary_);
+		vocabulary_words = e.vocabulary_->size();
+		vocabulary_cancel.reset();
+	    }
 	    if (! e.info_.empty()) {
 		info = e.info_;
 	    }
 	}
 
 	if (do_intersect) {
-	    intersect_regex_curses();
+	    intersect_regex_background();
 	}
 	if (do_refresh_windows) {
 	    refresh_windows();
 	}
     }
 
+    /// number of running threads that save lines to a file.
+    std::atomic<unsigned> file_savers(0);
+
     void key_S()
     {
 	do {
 	    curses_attr a(A_BOLD);
 	    const std::string title = "Save to File: ";
 	    mvprintw(search_y, 0, title.c_str());
-	    const std::string filename = line_edit(search_y, title.size(), "", screen_width - title.size(), complete_filename);
+	    const std::string filename = line_edit(search_y, title.size(), "", screen_width - title.size(), complete_filename_list);
 	    if (filename.empty()) {
 		break;
 	    }
-	    if (display_info->save(filename, *f_idx)) {
-		info = "save success";
-	    } else {
-		info = "save failed: ";
-		info += errno_str();
-	    }
+	    // save a snapshot of the displayed lines, while the filters can be changed
+	    display_snapshot snap = display_info->snapshot();
+	    auto fi = f_idx;
+	    ++file_savers;
+	    std::thread t([snap, fi, filename]() mutable {
+		    std::string err;
+		    if (snap.save(filename, *fi, &err)) {
+			eventAdd(event("save success"));
+		    } else {
+			eventAdd(event("save failed: " + err));
+		    }
+		    // realmain() waits for the savers before it releases the memory map
+		    snap.lines_.reset();
+		    fi.reset();
+		    --file_savers;
+		});
+	    t.detach();
+	    info = "saving " + filename + "...";
 	} while(0);
 
 	refresh_windows();
@@ -1527,9 +2308,70 @@ namespace {
     void key_A()
     {
 	file_index::abort_background_parse();
+	if (search_idx) {
+	    search_idx->cancel();
+	}
+	pending_search = 0;
+	cancel_nearest_search();
+	if (vocabulary_cancel) {
+	    *vocabulary_cancel = true;
+	}
 	info = "aborted background jobs";
     }
 
+    /// toggle between wrapping long lines and displaying a window of each line in a single row.
+    void key_W()
+    {
+	wrap_lines = ! wrap_lines;
+	window_column = 0;
+	rendered.clear();
+	info = wrap_lines ? "wrap long lines" : "chop long lines";
+	refresh_lines_window();
+	refresh();
+    }
+
+    /// @return the name of a link mode, as used by the --links argument.
+    const char* link_mode_str(const link_mode_t m)
+    {
+	switch (m) {
+	case links_off: return "off";
+	case links_click: return "click";
+	case links_select: return "select";
+	}
+	return "";
+    }
+
+    /// cycle the link mode between off, click and select.
+    void key_L()
+    {
+	link_mode = (link_mode == links_off) ? links_click : (link_mode == links_click) ? links_select : links_off;
+	rendered.clear();
+	info = std::string("link detection: ") + link_mode_str(link_mode);
+	refresh_lines_window();
+	refresh();
+    }
+
+    /// scroll the window of the lines half a screen to the left or right.
+    void scroll_window(const bool right)
+    {
+	if (wrap_lines) {
+	    info = "long lines are wrapped, press W to chop long lines";
+	    return;
+	}
+	const uint64_t step = std::max(1u, screen_width / 2);
+	if (right) {
+	    window_column += step;
+	} else if (window_column == 0) {
+	    info = "moved to first column";
+	    return;
+	} else {
+	    window_column -= std::min(step, window_column);
+	}
+	rendered.clear();
+	refresh_lines_window();
+	refresh();
+    }
+
 #if defined(__unix__)
     // check for terminated child process
     void check_for_zombies()
@@ -1594,6 +2436,13 @@ int realmain_impl(int argc, char * const argv[])
 	opt_goto,
 	opt_help,
 	opt_color,
+	opt_filter,
+	opt_after_context,
+	opt_before_context,
+	opt_context,
+	opt_cache_mem,
+	opt_chop_long_lines,
+	opt_links,
     };
     const struct option longopts[] = {
 	{ "tabwidth", required_argument, nullptr, opt_tabwidth },
@@ -1602,13 +2451,20 @@ int realmain_impl(int argc, char * const argv[])
 	{ "goto", required_argument, nullptr, opt_goto },
 	{ "help", no_argument, nullptr, opt_help },
 	{ "color", no_argument, nullptr, opt_color },
+	{ "filter", required_argument, nullptr, opt_filter },
+	{ "after-context", required_argument, nullptr, opt_after_context },
+	{ "before-context", required_argument, nullptr, opt_before_context },
+	{ "context", required_argument, nullptr, opt_context },
+	{ "cache-mem", required_argument, nullptr, opt_cache_mem },
+	{ "chop-long-lines", no_argument, nullptr, opt_chop_long_lines },
+	{ "links", required_argument, nullptr, opt_links },
 	{ nullptr, 0, nullptr, 0 }
     };
 
     line_number_t topLine = 0;
     std::vector<std::string> command_line_filter_regex;
     int key;
-    while((key = getopt_long(argc, argv, "vh?", longopts, nullptr)) > 0) {
+    while((key = getopt_long(argc, argv, "vh?A:B:C:S", longopts, nullptr)) > 0) {
 	switch(key) {
 	case '?':
 	case 'h':
@@ -1641,6 +2497,69 @@ int realmain_impl(int argc, char * const argv[])
 	    compile_search_regex(optarg);
 	    break;
 
+	case 'A':
+	case opt_after_context:
+	    if (! parse_context_lines(optarg, context_after)) {
+		std::cerr << "--after-context number of lines is invalid: " << optarg << std::endl;
+		return EX_USAGE;
+	    }
+	    break;
+
+	case 'B':
+	case opt_before_context:
+	    if (! parse_context_lines(optarg, context_before)) {
+		std::cerr << "--before-context number of lines is invalid: " << optarg << std::endl;
+		return EX_USAGE;
+	    }
+	    break;
+
+	case 'C':
+	case opt_context:
+	    if (! parse_context_lines(optarg, context_before)) {
+		std::cerr << "--context number of lines is invalid: " << optarg << std::endl;
+		return EX_USAGE;
+	    }
+	    context_after = context_before;
+	    break;
+
+	case 'S':
+	case opt_chop_long_lines:
+	    wrap_lines = false;
+	    break;
+
+	case opt_links: {
+	    const std::string m = optarg;
+	    if (m == "off") {
+		link_mode = links_off;
+	    } else if (m == "click") {
+		link_mode = links_click;
+	    } else if (m == "select") {
+		link_mode = links_select;
+	    } else {
+		std::cerr << "--links must be off, click or select: " << optarg << std::endl;
+		return EX_USAGE;
+	    }
+	    break;
+	}
+
+	case opt_cache_mem: {
+	    uint64_t bytes = 0;
+	    if (! parse_memory_size(optarg, bytes)) {
+		std::cerr << "--cache-mem size is invalid: " << optarg << std::endl;
+		return EX_USAGE;
+	    }
+	    regex_cache.budget(bytes);
+	    break;
+	}
+
+	case opt_filter:
+	    compile_filter_expression(optarg);
+	    if (! filter_expr_err.empty()) {
+		std::cerr << "--filter expression is invalid: " << filter_expr_err << std::endl;
+		return EX_USAGE;
+	    }
+	    break;
+
 	case opt_tabwidth:
 	    tab_width = atoi(optarg);
 	    if (tab_width > 80) {
@@ -1663,6 +2582,12 @@ int realmain_impl(int argc, char * const argv[])
 	}
     }
 
+    // the filter expression uses the row of the last regex slot
+    if (! filter_expr_str.empty() && command_line_filter_regex.size() >= max_regex_num) {
+	std::cerr << "can only add up to " << max_regex_num - 1 << " regular expressions with the --regex argument if --filter is used" << std::endl;
+	return EX_USAGE;
+    }
+
     if (optind < argc) {
 	command_line_filename = argv[optind];
     }
@@ -1709,25 +2634,63 @@ int realmain_impl(int argc, char * const argv[])
     setlocale(LC_ALL, "");
     display_info = std::make_shared<DisplayInfo>();
 
+    // a temporary file of STDIN is not opened again
+    if (command_line_filename != "-") {
+	const std::string dir = index_cache::default_dir();
+	if (! dir.empty()) {
+	    std::string size;
+	    uint64_t max_bytes = index_cache::default_max_bytes;
+	    if (getenv_str("FEWCACHESIZE", size) && ! size.empty() && ! parse_memory_size(size, max_bytes)) {
+		std::cerr << "FEWCACHESIZE is invalid: " << size << std::endl;
+		return EX_USAGE;
+	    }
+	    idx_cache = std::make_shared<index_cache>(dir, max_bytes);
+	}
+    }
+
     f_idx = std::make_shared<file_index>(real_filename);
     {
+	line_number_t cached_lines = 0;
+	if (idx_cache) {
+	    cached_lines = idx_cache->load_lines(real_filename, *f_idx);
+	    if (verbose && cached_lines > 0) {
+		std::clog << "restored " << cached_lines << " lines from " << idx_cache->dir() << std::endl;
+	    }
+	}
 	file_index::regex_index_vec_t v;
+	cached_regex_vec_t filters;
 	for(auto rgx_ : command_line_filter_regex) {
 	    auto rgx = normalize_regex(rgx_);
-	    if (filter_cache.count(rgx) > 0) {
+	    if (regex_cache.contains(rgx)) {
 		std::clog << "--regex '" << rgx << "' seen more than once." << std::endl;
 		continue;
 	    }
-	    auto ri = std::make_shared<regex_index>(rgx);
+	    std::shared_ptr<regex_index> ri;
+	    if (idx_cache && is_filter_regex(rgx)) {
+		ri = idx_cache->load_regex(real_filename, *f_idx, rgx);
+	    }
+	    if (! ri) {
+		ri = std::make_shared<regex_index>(rgx);
+	    }
 	    v.push_back(ri);
 
-	    auto c = std::make_shared<regex_container_t>();
-	    c->rgx_ = rgx;
-	    c->ri_ = ri;
-	    filter_cache[rgx] = c;
+	    regex_cache.add(rgx, ri);
+	    if (is_filter_regex(rgx)) {
+		filters.push_back(std::make_pair(rgx, ri));
+	    }
 	}
 	OStreamProgressFunctor func(std::clog, "parsing line: ");
 	f_idx->parse_all(v, &func);
+
+	// write the parts that were not restored from the index cache
+	const line_number_t complete = index_cache::complete_lines(*f_idx);
+	cached_regex_vec_t regexes;
+	for(const auto& r : filters) {
+	    if (r.second->restored() < complete) {
+		regexes.push_back(r);
+	    }
+	}
+	save_index_cache(cached_lines < complete, regexes);
     }
     for(unsigned u = 0; u != command_line_filter_regex.size(); ++u) {
 	const add_regex_status s = add_regex(u, command_line_filter_regex[u], nullptr);
@@ -1739,13 +2702,15 @@ int realmain_impl(int argc, char * const argv[])
 	    return EX_SOFTWARE;
 	}
     }
-    {
-	std::shared_ptr<OStreamProgressFunctor> func;
-	if (command_line_filter_regex.size() > 0 && verbose) {
-	    func = std::make_shared<OStreamProgressFunctor>(std::clog, "intersect regular expressions: ");
+    if (filter_expr) {
+	const std::string err = check_filter_slots(*filter_expr, filter_slots());
+	if (! err.empty()) {
+	    std::cerr << "--filter expression is invalid: " << err << std::endl;
+	    return EX_USAGE;
 	}
-	intersect_regex(func.get());
     }
+    intersect_regex();
+    build_vocabulary_background();
 
     const std::string stdinfo = command_line_filename + " (" + std::to_string(f_idx->size()) + " lines)";
     info = stdinfo;
@@ -1773,15 +2738,33 @@ int realmain_impl(int argc, char * const argv[])
     while (true) {
 	// loop until a key was pressed
 	do {
+	    update_search_index();
+	    // sample the progress of running background matches a few times per second
+	    bool running = refresh_progress();
+	    running = resolve_pending_search() || running;
 	    refresh_info();
-	    key = getch();
+	    key = wait_for_key(running ? 250 : -1);
 	    process_event_queue();
 	} while(key == ERR);
 
+	// a search that waits for the search index is replaced by any other key
+	if (key != 'n' && key != 'N') {
+	    pending_search = 0;
+	    cancel_nearest_search();
+	}
+	// and so is a percentage that waits for the lines to be counted
+	pending_perc = -1;
+
 	if (verbose) {
 	    info= stdinfo + " "
-		+ std::to_string(f_idx->perc(display_info->topLineNum())) + "%"
+		+ (display_info->has_counts() ? std::to_string(display_info->position(display_info->topLineNum())) + " of " + std::to_string(display_info->size())
+		   + " " + std::to_string(display_info->perc(display_info->topLineNum())) + "%" : std::string("counting..."))
 		+ " use " + std::to_string(getCurrentRSS()/1024/1024) + " MB"
+		+ " display " + display_info->lines()->info()
+		+ " render cache " + std::to_string(rendered.hits()) + "/" + std::to_string(rendered.hits() + rendered.misses()) + " hits"
+		+ " intersect cache " + std::to_string(intersect_engine->hits()) + "/" + std::to_string(intersect_engine->hits() + intersect_engine->misses()) + " hits"
+		+ " " + regex_cache.info()
+		+ " vocabulary " + (vocabulary_cancel ? std::string("counting...") : std::to_string(vocabulary_words) + " words")
 		;
 	} else {
 	    info = stdinfo;
@@ -1791,6 +2774,12 @@ int realmain_impl(int argc, char * const argv[])
 #endif
 	// process key presses
 	if (key == 'q' || key == 'Q') {
+	    // a file that is saved is completed before few exits
+	    if (file_savers > 0) {
+		info = "waiting until the file is saved...";
+		refresh_info();
+		refresh();
+	    }
 	    break;
 	}
 	switch(key) {
@@ -1885,6 +2874,30 @@ int realmain_impl(int argc, char * const argv[])
 	    key_A();
 	    break;
 
+	case 'W':
+	    key_W();
+	    break;
+
+	case 'L':
+	    key_L();
+	    break;
+
+	case KEY_LEFT:
+	    scroll_window(false);
+	    break;
+
+	case KEY_RIGHT:
+	    scroll_window(true);
+	    break;
+
+	case '&':
+	    edit_filter_expression();
+	    break;
+
+	case 'C':
+	    edit_context();
+	    break;
+
 	case '1':
 	case '2':
 	case '3':
@@ -1939,12 +2952,38 @@ int realmain_impl(int argc, char * const argv[])
 	std::cout << " --regex '" << c->rgx_ << "'";
     }
 
+    if (! filter_expr_str.empty()) {
+	std::cout << " --filter '" << filter_expr_str << "'";
+    }
+
     if (! search_str.empty()) {
 	std::cout << " --search '" << search_str << "'";
     }
 
     display_info->start();
 
+    if (context_before > 0 && context_before == context_after) {
+	std::cout << " -C " << context_before;
+    } else {
+	if (context_before > 0) {
+	    std::cout << " -B " << context_before;
+	}
+	if (context_after > 0) {
+	    std::cout << " -A " << context_after;
+	}
+    }
+
+    if (regex_cache.budget() > 0) {
+	std::cout << " --cache-mem '" << memory_size_str(regex_cache.budget()) << "'";
+    }
+
+    if (! wrap_lines) {
+	std::cout << " -S";
+    }
+    if (link_mode != links_click) {
+	std::cout << " --links " << link_mode_str(link_mode);
+    }
+
     std::cout << " --tabwidth " << tab_width;
     if (display_info->current() > 0) {
 	std::cout << " --goto " << display_info->current();
@@ -1960,6 +2999,10 @@ int realmain_impl(int argc, char * const argv[])
     // print comment line for ack
     bool first_ack = true;
     for(auto c : regex_vec) {
+        // ack can only AND the filter regular expressions
+        if (filter_expr) {
+            break;
+        }
         // only use filter regular expressions for ack
         if (! c->ri_) {
             continue;
@@ -2022,6 +3065,26 @@ int realmain(int argc, char * const argv[])
 	std::cerr << std::endl << exit_msg << std::endl;
     }
 
+    // release the memory map of the file before the static objects of memorymap.cc are destroyed
+    wait_for_threads(file_savers);
+    idx_cache_cancel = true;
+    wait_for_threads(idx_cache_writers);
+    cancel_nearest_search();
+    if (search_idx) {
+	search_idx->cancel();
+	search_idx = nullptr;
+    }
+    if (vocabulary_cancel) {
+	*vocabulary_cancel = true;
+    }
+    if (intersect_cancel) {
+	*intersect_cancel = true;
+    }
+    wait_for_threads(search_index_builders);
+    wait_for_threads(nearest_searches);
+    wait_for_threads(vocabulary_builders);
+    wait_for_threads(intersections);
+    display_info = nullptr;
     f_idx = nullptr;
     return exit_status;
 }
@@ -78,6 +78,27 @@ TEST_F(realmainTest, recognizes_tab_width_too_small)
     ASSERT_EQ(EX_USAGE, realmain(3,const_cast<char * const *>(argv)));
 }
 
+TEST_F(realmainTest, recognizes_invalid_context_lines)
+{
+    const char* const args[][2] = {
+	{ "-C", "-1" },
+	{ "-C", "foo" },
+	{ "-A", "2x" },
+	{ "-B", "" },
+	{ "--context", "99999999999" },
+    };
+    for(auto a : args) {
+	const char* const argv[] = {
+	    "few",
+	    a[0],
+	    a[1],
+	    NULL
+	};
+	optind = 1;
+	ASSERT_EQ(EX_USAGE, realmain(3,const_cast<char * const *>(argv))) << a[0] << " " << a[1];
+    }
+}
+
 TEST_F(realmainTest, recognizes_tab_width_0)
 {
     const char* const argv[] = {
@@ -4,7 +4,9 @@
  */
 #include "regex_index.h"
 #include "normalize_regex.h"
-#include <iostream>
+#include "to_wide.h"
+#include <cctype>
+#include <cstring>
 
 void convert(const std::string& flags, std::regex_constants::syntax_option_type& fl, bool& positiveMatch)
 {
@@ -25,7 +27,59 @@ void convert(const std::string& flags, std::regex_constants::syntax_option_type&
     fl = flg;
 }
 
-regex_index::regex_index(std::string rgx) :
+namespace {
+    /**
+     * convert a regular expression without special characters into the string it matches.
+     * A backslash followed by a punctuation character matches that character.
+     * @return true if rgx is a literal string, which was stored in literal.
+     */
+    bool literal_string(const std::string& rgx, std::string& literal)
+    {
+	literal.clear();
+	for(size_t i = 0; i < rgx.size(); ++i) {
+	    const char c = rgx[i];
+	    if (c == '\\') {
+		if (++i == rgx.size() || ! ispunct(static_cast<unsigned char>(rgx[i]))) {
+		    return false;
+		}
+		literal += rgx[i];
+		continue;
+	    }
+	    if (strchr("^$.|?*+()[]{}", c)) {
+		return false;
+	    }
+	    literal += c;
+	}
+	return ! literal.empty();
+    }
+
+    /**
+     * @return true if rgx can match a multi byte character differently
+     *         than the same regular expression on wide characters:
+     *         non ASCII characters, '.', negated brackets, character
+     *         classes and the escapes that depend on word or space characters.
+     */
+    bool needs_wide(const std::string& rgx)
+    {
+	for(size_t i = 0; i < rgx.size(); ++i) {
+	    const char c = rgx[i];
+	    if (static_cast<unsigned char>(c) >= 0x80 || c == '.') {
+		return true;
+	    }
+	    if (c == '[' && i + 1 < rgx.size() && (rgx[i + 1] == '^' || rgx[i + 1] == '[')) {
+		return true;
+	    }
+	    if (c == '\\' && ++i < rgx.size() && rgx[i] != 0 && strchr("wWsSdDbB", rgx[i])) {
+		return true;
+	    }
+	}
+	return false;
+    }
+}
+
+line_regex::line_regex(std::string rgx, const encoding_t encoding) :
+    is_literal_(false),
+    is_wide_(false),
     positive_match_(true)
 {
     rgx = normalize_regex(rgx);
@@ -34,17 +88,57 @@ regex_index::regex_index(std::string rgx) :
     std::regex_constants::syntax_option_type fl;
     convert(flags, fl, positive_match_);
     rgx_.assign(rgx, fl);
+    is_literal_ = ! (fl & std::regex::icase) && literal_string(rgx, literal_);
+    if (encoding == characters && ! is_literal_ && needs_wide(rgx)) {
+	wrgx_.assign(to_wide(rgx), fl);
+	is_wide_ = true;
+    }
+}
+
+bool
+line_regex::search(const char *beg, const char *end) const
+{
+    if (is_wide_) {
+	std::wstring s;
+	to_wide(beg, end - beg, s);
+	return std::regex_search(s, wrgx_);
+    }
+    if (! is_literal_) {
+	return std::regex_search(beg, end, rgx_);
+    }
+    // look for the first character with memchr() and compare the rest
+    const size_t len = literal_.size();
+    const char first = literal_[0];
+    while(static_cast<size_t>(end - beg) >= len) {
+	const char *p = static_cast<const char*>(memchr(beg, first, end - beg - len + 1));
+	if (! p) {
+	    return false;
+	}
+	if (memcmp(p + 1, literal_.data() + 1, len - 1) == 0) {
+	    return true;
+	}
+	beg = p + 1;
+    }
+    return false;
+}
+
+regex_index::regex_index(std::string rgx) :
+    rgx_(rgx),
+    restored_(0)
+{
+}
+
+regex_index::regex_index(std::string rgx, line_set&& lines, line_number_t restored) :
+    regex_index(rgx)
+{
+    lines_ = std::move(lines);
+    restored_ = restored;
 }
 
 void
 regex_index::match(const line_t& line)
 {
-    //std::clog << line.num_ << ":" << line.to_string();
-    const bool res = std::regex_search(line.beg_, line.end_, rgx_);
-    if (( positive_match_ &&  res) ||
-	(!positive_match_ && !res)) {
-	lineNum_vector_.push_back(line.num_);
-	//std::clog << " !match!";
-    }
-    //std::clog << std::endl;
+    if (rgx_.match(line)) {
+	lines_.push_back(line.num_);
+    }
 }
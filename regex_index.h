@@ -4,6 +4,7 @@
  */
 #pragma once
 #include "line.h"
+#include "line_set.h"
 #include <memory>
 #include <regex>
 
@@ -17,12 +18,66 @@
  */
 void convert(const std::string& flags, std::regex_constants::syntax_option_type& fl, bool& positiveMatch);
 
-class regex_index
+/**
+ * a regular expression that is matched on the bytes of a line.
+ *
+ * A regular expression without special characters and without the 'i'
+ * flag is found with a literal string search instead of
+ * std::regex_search(), which is many times faster.
+ *
+ * In the characters encoding, a regular expression that would match a
+ * multi byte character differently than the wide regular expression
+ * used for highlighting is matched on the wide characters of the line.
+ */
+class line_regex
 {
-    lineNum_vector_t lineNum_vector_;
+public:
+    /// how the lines are matched.
+    enum encoding_t {
+	/// match the bytes of the lines.
+	bytes,
+	/// match the wide characters of the lines if the result could differ from matching the bytes.
+	characters,
+    };
+
+private:
     std::regex rgx_;
+    /// the regular expression if is_wide_ is true.
+    std::wregex wrgx_;
+    /// the string to search for if is_literal_ is true.
+    std::string literal_;
+    bool is_literal_;
+    bool is_wide_;
     bool positive_match_;
 
+public:
+    /**
+     * @param rgx a (normalized) regular expression string.
+     * @param encoding how the lines are matched.
+     * @throws std::runtime_error if regular expression could not be parsed.
+     */
+    explicit line_regex(std::string rgx, encoding_t encoding = bytes);
+
+    /// @return true if [beg..end) contains a match of the regular expression. The '!' flag is ignored.
+    bool search(const char *beg, const char *end) const;
+
+    /// @return true if the line contains a match and the '!' flag is not set, or if it contains no match and the '!' flag is set.
+    bool match(const line_t& line) const { return search(line.beg_, line.end_) == positive_match_; }
+
+    /// @return true if the regular expression is searched as a literal string.
+    bool is_literal() const { return is_literal_; }
+
+    /// @return true if the regular expression is matched on wide characters.
+    bool is_wide() const { return is_wide_; }
+};
+
+class regex_index
+{
+    line_set lines_;
+    line_regex rgx_;
+    /// number of lines at the start of the file whose matches are included in lines_ without calling match().
+    line_number_t restored_;
+
 public:
     /**
      * create regular expression index object.
@@ -31,10 +86,24 @@ public:
      */
     explicit regex_index(std::string rgx);
 
+    /**
+     * create regular expression index object with previously matched lines.
+     * @param rgx a (normalized) regular expression string.
+     * @param lines the lines matched by rgx.
+     * @param restored if > 0, lines contains the matches of the first restored lines of the file,
+     *        and match() only needs to be called for the following lines.
+     * @throws std::runtime_error if regular expression could not be parsed.
+     */
+    regex_index(std::string rgx, line_set&& lines, line_number_t restored = 0);
+
     /// match line against the provisioned regular expression. If it matches add the line (number) to the set.
     void match(const line_t& line);
 
-    unsigned size() const { return lineNum_vector_.size(); }
+    unsigned size() const { return lines_.size(); }
+
+    /// @return the number of lines at the start of the file that do not need to be matched.
+    line_number_t restored() const { return restored_; }
 
-    const lineNum_vector_t& lineNum_vector() { return lineNum_vector_; }
+    /// @return the set of matched line numbers.
+    const line_set& lines() const { return lines_; }
 };
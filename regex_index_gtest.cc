@@ -6,6 +6,7 @@
 #include "gtest/gtest.h"
 #include "file_index.h"
 #include "intersect.h"
+#include "normalize_regex.h"
 #include <iterator>
 
 TEST(regex_index, does_filter_non_empty_lines)
@@ -42,8 +43,8 @@ TEST(regex_index, intersect_works)
     auto b = std::make_shared<regex_index>("contains");
     fi->parse_all(b);
 
-    lineNum_vector_intersect_vector_t v = { std::make_pair(a->lineNum_vector().begin(), a->lineNum_vector().end()),
-					    std::make_pair(b->lineNum_vector().begin(), b->lineNum_vector().end()) };
+    std::vector<std::pair<line_set::const_iterator, line_set::const_iterator>> v = { std::make_pair(a->lines().begin(), a->lines().end()),
+										     std::make_pair(b->lines().begin(), b->lines().end()) };
     lineNum_vector_t s;
     ASSERT_EQ(1u, multiple_set_intersect(v.begin(), v.end(), std::back_insert_iterator<lineNum_vector_t>(s)));
     ASSERT_EQ(1u, s.size());
@@ -52,8 +53,86 @@ TEST(regex_index, intersect_works)
     fi->parse_all(c);
     ASSERT_EQ(0u, c->size());
 
-    v[1] = std::make_pair(c->lineNum_vector().begin(), c->lineNum_vector().end());
+    v[1] = std::make_pair(c->lines().begin(), c->lines().end());
     s.clear();
     ASSERT_EQ(0u, multiple_set_intersect(v.begin(), v.end(), std::back_insert_iterator<lineNum_vector_t>(s)));
     ASSERT_EQ(0u, s.size());
 }
+
+TEST(regex_index, intersect_line_sets)
+{
+    auto fi = std::make_shared<file_index>("test.txt");
+
+    auto a = std::make_shared<regex_index>("/#/!");
+    fi->parse_all(a);
+
+    auto b = std::make_shared<regex_index>("contains");
+    fi->parse_all(b);
+
+    ASSERT_EQ(1u, line_set::intersect(a->lines(), b->lines()).size());
+}
+
+namespace {
+    bool search(const line_regex& r, const std::string& s)
+    {
+	return r.search(s.data(), s.data() + s.size());
+    }
+}
+
+TEST(line_regex, literal_strings_are_searched_without_regex)
+{
+    ASSERT_TRUE(line_regex("error").is_literal());
+    ASSERT_TRUE(line_regex("/a\\.b/").is_literal());
+    ASSERT_TRUE(line_regex("/host-1/!").is_literal());
+    ASSERT_FALSE(line_regex("/error/i").is_literal());
+    ASSERT_FALSE(line_regex("a.b").is_literal());
+    ASSERT_FALSE(line_regex("\\d").is_literal());
+    ASSERT_FALSE(line_regex("a|b").is_literal());
+    // an escaped backslash
+    ASSERT_TRUE(line_regex("/a\\\\/").is_literal());
+    ASSERT_TRUE(search(line_regex("/a\\\\/"), "a\\"));
+}
+
+TEST(line_regex, literal_and_regex_search_agree)
+{
+    const char *lines[] = { "", "e", "err", "error", "an error", "errerror", "error at the end: error", "erro", "a.b", "axb", "a\xC3\xA4" "b" };
+    const char *rgx[] = { "error", "/a\\.b/", "r", "\xC3\xA4", "/erro/" };
+    for(auto r : rgx) {
+	line_regex l(r);
+	ASSERT_TRUE(l.is_literal()) << r;
+	// the same regular expression with a group is not a literal string
+	line_regex g(std::string("/(") + get_regex_str(normalize_regex(r)) + ")/");
+	ASSERT_FALSE(g.is_literal()) << r;
+	for(auto s : lines) {
+	    ASSERT_EQ(search(g, s), search(l, s)) << r << " " << s;
+	}
+    }
+}
+
+TEST(line_regex, characters_encoding_matches_wide_characters_if_needed)
+{
+    ASSERT_FALSE(line_regex("a.b").is_wide());
+    ASSERT_TRUE(line_regex("a.b", line_regex::characters).is_wide());
+    ASSERT_TRUE(line_regex("/[^x]/", line_regex::characters).is_wide());
+    ASSERT_TRUE(line_regex("/a\\w/", line_regex::characters).is_wide());
+    ASSERT_TRUE(line_regex("/[[:alpha:]]/", line_regex::characters).is_wide());
+    ASSERT_TRUE(line_regex("/(\xC3\xA4|x)/", line_regex::characters).is_wide());
+    // these match the same bytes and wide characters
+    ASSERT_FALSE(line_regex("/a\\.b/", line_regex::characters).is_wide());
+    ASSERT_FALSE(line_regex("/\xC3\xA4/", line_regex::characters).is_wide());
+    ASSERT_FALSE(line_regex("/(error|warn)[0-9]+/", line_regex::characters).is_wide());
+
+    line_regex r("a.b", line_regex::characters);
+    ASSERT_TRUE(search(r, "xaxb"));
+    ASSERT_FALSE(search(r, "ab"));
+}
+
+TEST(line_regex, not_flag)
+{
+    line_regex r("/error/!");
+    line_t l;
+    const std::string s = "no problem";
+    l.assign(s);
+    ASSERT_TRUE(r.match(l));
+    ASSERT_FALSE(search(r, s));
+}
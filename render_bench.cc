@@ -0,0 +1,118 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+
+#include "gtest/gtest.h"
+#include "render_cache.h"
+#include "timeGetTime.h"
+#include <cstdio>
+#include <iostream>
+#include <random>
+
+namespace {
+    const unsigned screen_width = 300;
+    const unsigned screen_height = 80;
+    const unsigned frames = 200;
+
+    /// create lines that fill the screen, with highlighted words and links.
+    std::vector<rendered_line> lines()
+    {
+	std::mt19937 gen(1);
+	std::vector<rendered_line> v(screen_height);
+	for(auto& l : v) {
+	    while (l.text_.size() < screen_width) {
+		const size_t b = l.text_.size();
+		if (gen() % 10 == 0) {
+		    l.text_ += L"http://example.com/path";
+		    l.link_.push_back(rendered_line::target { b, l.text_.size(), l.text_.substr(b) });
+		    l.add_attr(b, l.text_.size(), 0, A_UNDERLINE);
+		} else {
+		    l.text_ += std::wstring(1 + gen() % 8, L'a' + gen() % 26);
+		    if (gen() % 4 == 0) {
+			l.add_attr(b, l.text_.size(), A_COLOR, A_BOLD);
+		    }
+		}
+		l.text_ += L' ';
+	    }
+	}
+	return v;
+    }
+
+    /// print a line like the lines window did before attribute runs: one curses call per character.
+    unsigned print_per_character(const rendered_line& l, const unsigned y)
+    {
+	unsigned x = 0;
+	for(size_t i = 0; i < l.text_.size() && x < screen_width; ++i, ++x) {
+	    curses_attr a(l.attr(i));
+	    const wchar_t wc[2] = { l.text_[i], 0 };
+	    mvaddwstr(y, x, wc);
+	}
+	return x;
+    }
+
+    /// @return the characters and attributes of row y of the screen.
+    std::vector<std::pair<std::wstring, attr_t>> screen_row(const unsigned y)
+    {
+	std::vector<std::pair<std::wstring, attr_t>> v;
+	for(unsigned x = 0; x < screen_width; ++x) {
+	    cchar_t c;
+	    mvin_wch(y, x, &c);
+	    wchar_t wc[CCHARW_MAX + 1];
+	    attr_t a;
+	    short pair;
+	    getcchar(&c, wc, &a, &pair, nullptr);
+	    v.push_back(std::make_pair(std::wstring(wc), a));
+	}
+	return v;
+    }
+}
+
+TEST(render_bench, frame_300x80)
+{
+    FILE *out = fopen("/dev/null", "w");
+    ASSERT_NE(nullptr, out);
+    SCREEN *scr = newterm(const_cast<char*>("xterm"), out, stdin);
+    if (! scr) {
+	std::clog << "could not initialize curses, skipping benchmark" << std::endl;
+	fclose(out);
+	return;
+    }
+    resizeterm(screen_height, screen_width);
+
+    const auto v = lines();
+    uint32_t t = timeGetTime();
+    for(unsigned f = 0; f < frames; ++f) {
+	for(unsigned y = 0; y < screen_height; ++y) {
+	    print_per_character(v[y], y);
+	}
+	wnoutrefresh(stdscr);
+    }
+    const uint32_t per_character_ms = timeGetTime() - t;
+    std::vector<std::vector<std::pair<std::wstring, attr_t>>> expected;
+    for(unsigned y = 0; y < screen_height; ++y) {
+	expected.push_back(screen_row(y));
+    }
+
+    erase();
+    t = timeGetTime();
+    for(unsigned f = 0; f < frames; ++f) {
+	for(unsigned y = 0; y < screen_height; ++y) {
+	    size_t i = 0;
+	    v[y].print(i, y, 0, screen_width, 8);
+	}
+	wnoutrefresh(stdscr);
+    }
+    const uint32_t runs_ms = timeGetTime() - t;
+
+    // both ways print the same screen
+    for(unsigned y = 0; y < screen_height; ++y) {
+	ASSERT_EQ(expected[y], screen_row(y));
+    }
+
+    endwin();
+    delscreen(scr);
+    fclose(out);
+
+    std::clog << screen_width << "x" << screen_height << " frame: per character " << per_character_ms * 1000 / frames << " us, attribute runs " << runs_ms * 1000 / frames << " us" << std::endl;
+}
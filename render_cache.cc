@@ -0,0 +1,205 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+
+#include "render_cache.h"
+#include <algorithm>
+#include <cassert>
+#include <wchar.h>
+#include <wctype.h>
+
+void
+rendered_line::split_attr(size_t pos)
+{
+    auto r = std::upper_bound(attr_.begin(), attr_.end(), pos, [](size_t p, const run& r) { return p < r.end_; });
+    if (r == attr_.end() || r->begin_ == pos) {
+	return;
+    }
+    run left = *r;
+    left.end_ = pos;
+    r->begin_ = pos;
+    attr_.insert(r, left);
+}
+
+void
+rendered_line::add_attr(size_t begin, size_t end, curses_attr_t clear, curses_attr_t set)
+{
+    assert(begin <= end);
+    assert(end <= text_.size());
+    if (begin == end) {
+	return;
+    }
+    if (attr_.empty()) {
+	attr_.push_back(run { 0, text_.size(), 0 });
+    }
+    split_attr(begin);
+    split_attr(end);
+    for(auto& r : attr_) {
+	if (r.begin_ >= begin && r.end_ <= end) {
+	    r.attr_ = (r.attr_ & ~clear) | set;
+	}
+    }
+    // join neighbouring runs with the same attribute
+    size_t j = 0;
+    for(size_t i = 1; i < attr_.size(); ++i) {
+	if (attr_[i].attr_ == attr_[j].attr_) {
+	    attr_[j].end_ = attr_[i].end_;
+	} else {
+	    attr_[++j] = attr_[i];
+	}
+    }
+    attr_.resize(j + 1);
+    if (attr_.size() == 1 && attr_[0].attr_ == 0) {
+	attr_.clear();
+    }
+}
+
+curses_attr_t
+rendered_line::attr(size_t i) const
+{
+    auto r = std::upper_bound(attr_.begin(), attr_.end(), i, [](size_t p, const run& r) { return p < r.end_; });
+    return (r == attr_.end()) ? 0 : r->attr_;
+}
+
+namespace {
+    /// @return true if c is printed in a single screen column.
+    bool single_column(wchar_t c)
+    {
+#if defined(_WIN32)
+	return c >= 0x20 && c < 0x300;
+#else
+	return wcwidth(c) == 1;
+#endif
+    }
+}
+
+unsigned
+rendered_line::print(size_t& i, const unsigned y, unsigned x, const unsigned screen_width, const unsigned tab_width, const unsigned tab_offset) const
+{
+    auto r = std::upper_bound(attr_.begin(), attr_.end(), i, [](size_t p, const run& r) { return p < r.end_; });
+
+    while (i < text_.size() && x < screen_width) {
+	while (r != attr_.end() && r->end_ <= i) {
+	    ++r;
+	}
+	const curses_attr_t a = (r == attr_.end()) ? 0 : r->attr_;
+	const wchar_t c = text_[i];
+
+	// handle tab character
+	if (c == '\t') {
+	    do {
+		mvaddch(y, x++, ' ');
+	    } while ((x + tab_offset) % tab_width);
+	    ++i;
+	    continue;
+	}
+	// replace non printable characters
+	if (! iswprint(c)) {
+	    const wchar_t wc[2] = { L'\uFFFD', 0 };
+	    mvaddwstr(y, x++, wc);
+	    ++i;
+	    continue;
+	}
+
+	// the characters up to the end of the run or the screen are printed at once
+	size_t end = std::min(text_.size(), i + (screen_width - x));
+	if (r != attr_.end()) {
+	    end = std::min(end, r->end_);
+	}
+	size_t j = i + 1;
+	if (single_column(c)) {
+	    while (j < end && text_[j] != '\t' && iswprint(text_[j]) && single_column(text_[j])) {
+		++j;
+	    }
+	}
+
+	curses_attr ca(a);
+	mvaddnwstr(y, x, text_.data() + i, static_cast<int>(j - i));
+	x += j - i;
+	i = j;
+    }
+    return x;
+}
+
+size_t
+rendered_line::index_at(size_t i, unsigned x, const unsigned column, const unsigned screen_width, const unsigned tab_width, const unsigned tab_offset) const
+{
+    // advance like print() does
+    while (i < text_.size() && x < screen_width) {
+	unsigned w = 1;
+	if (text_[i] == '\t') {
+	    while ((x + w + tab_offset) % tab_width) {
+		++w;
+	    }
+	}
+	if (column < x + w) {
+	    return (column >= x) ? i : std::string::npos;
+	}
+	x += w;
+	++i;
+    }
+    return std::string::npos;
+}
+
+const rendered_line::target*
+rendered_line::find_target(const std::vector<target>& v, size_t i)
+{
+    auto it = std::upper_bound(v.begin(), v.end(), i, [](size_t p, const target& t) { return p < t.end_; });
+    if (it != v.end() && it->begin_ <= i) {
+	return &*it;
+    }
+    return nullptr;
+}
+
+render_cache::render_cache(size_t max_entries) :
+    max_entries_(max_entries),
+    generation_(0),
+    hits_(0),
+    misses_(0)
+{ }
+
+void
+render_cache::generation(unsigned g)
+{
+    if (g != generation_) {
+	clear();
+	generation_ = g;
+    }
+}
+
+render_cache::ptr_t
+render_cache::find(line_number_t n)
+{
+    auto i = map_.find(n);
+    if (i == map_.end()) {
+	++misses_;
+	return ptr_t();
+    }
+    ++hits_;
+    lru_.splice(lru_.begin(), lru_, i->second);
+    return i->second->second;
+}
+
+void
+render_cache::add(line_number_t n, ptr_t l)
+{
+    auto i = map_.find(n);
+    if (i != map_.end()) {
+	lru_.erase(i->second);
+	map_.erase(i);
+    }
+    lru_.emplace_front(n, l);
+    map_[n] = lru_.begin();
+    while (lru_.size() > max_entries_) {
+	map_.erase(lru_.back().first);
+	lru_.pop_back();
+    }
+}
+
+void
+render_cache::clear()
+{
+    lru_.clear();
+    map_.clear();
+}
@@ -0,0 +1,155 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#pragma once
+#include "types.h"
+#include "curses_attr.h"
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// a line prepared for the lines window.
+struct rendered_line
+{
+    /// a range of characters [begin_, end_) of the displayed text.
+    struct run
+    {
+	size_t begin_;
+	size_t end_;
+	/// curses attribute of the characters.
+	curses_attr_t attr_;
+    };
+
+    /// a link or email address in the displayed text.
+    struct target
+    {
+	size_t begin_;
+	size_t end_;
+	std::wstring str_;
+    };
+
+    /// the line after applying the Replace Display Filters.
+    std::string line_;
+
+    /// the displayed text.
+    std::wstring text_;
+
+    /// column of the first character of text_ in the line; 0 unless only a window of the line was rendered.
+    uint64_t column_;
+
+    /// number of characters of the whole line.
+    size_t length_;
+
+    /// number of columns of the whole line; only set if a window of the line was rendered.
+    uint64_t columns_;
+
+    /**
+     * runs of characters with the same attribute, sorted and covering the whole displayed text.
+     * Empty if no character has an attribute.
+     */
+    std::vector<run> attr_;
+
+    /// true if link_ and email_ have been detected.
+    bool targets_detected_;
+
+    /// links, sorted and not overlapping.
+    std::vector<target> link_;
+
+    /// email addresses, sorted and not overlapping.
+    std::vector<target> email_;
+
+    rendered_line() :
+	column_(0),
+	length_(0),
+	columns_(0),
+	targets_detected_(false)
+    { }
+
+private:
+    /// split the attribute run that contains pos, so a run starts at pos.
+    void split_attr(size_t pos);
+
+public:
+    /**
+     * change the attribute of the characters [begin..end).
+     * Highlights from several sources are merged by calling this function for each of them in order.
+     * @param clear attribute bits to clear.
+     * @param set attribute bits to set after clearing.
+     */
+    void add_attr(size_t begin, size_t end, curses_attr_t clear, curses_attr_t set);
+
+    /// @return the attribute of character i.
+    curses_attr_t attr(size_t i) const;
+
+    /**
+     * print one screen row of the displayed text.
+     * Characters with the same attribute are printed with a single curses call.
+     * @param[in,out] i index of the first character to print; index of the first character that was not printed afterwards.
+     * @param y screen row.
+     * @param x screen column of the first character.
+     * @param screen_width characters are printed while the column is less than screen_width.
+     * @param tab_width a tab character advances to the next column x where x + tab_offset is a multiple of tab_width.
+     * @param tab_offset aligns the tab stops with the columns of the line if the line does not start at the left of the screen.
+     * @return the column after the last printed character.
+     */
+    unsigned print(size_t& i, unsigned y, unsigned x, unsigned screen_width, unsigned tab_width, unsigned tab_offset = 0) const;
+
+    /**
+     * find the character that print() displays at a screen column.
+     * @param i, x, screen_width, tab_width, tab_offset the arguments of print().
+     * @param column a screen column.
+     * @return the index of the character at column; std::string::npos if no character is printed there.
+     */
+    size_t index_at(size_t i, unsigned x, unsigned column, unsigned screen_width, unsigned tab_width, unsigned tab_offset = 0) const;
+
+    /// @return the link or email target that contains character i; nullptr if there is none.
+    static const target* find_target(const std::vector<target>& v, size_t i);
+};
+
+/**
+ * LRU cache of rendered lines.
+ *
+ * Rendering a line applies the display filters, the search and the
+ * link detection regular expressions, which is much slower than
+ * printing it. Scrolling by one line only needs to render the newly
+ * displayed line. The cache is cleared when the generation changes,
+ * i.e. when a display filter or the search regex has been edited.
+ */
+class render_cache
+{
+public:
+    typedef std::shared_ptr<const rendered_line> ptr_t;
+
+private:
+    typedef std::list<std::pair<line_number_t, ptr_t>> lru_t;
+
+    size_t max_entries_;
+    unsigned generation_;
+    /// most recently used line first.
+    lru_t lru_;
+    std::unordered_map<line_number_t, lru_t::iterator> map_;
+    uint64_t hits_;
+    uint64_t misses_;
+
+public:
+    /// @param max_entries maximum number of cached lines.
+    explicit render_cache(size_t max_entries = 1024);
+
+    /// set the generation and clear the cache if it changed.
+    void generation(unsigned g);
+
+    /// @return the rendered line number n; nullptr if it is not cached.
+    ptr_t find(line_number_t n);
+
+    /// add the rendered line number n.
+    void add(line_number_t n, ptr_t l);
+
+    void clear();
+
+    size_t size() const { return lru_.size(); }
+    uint64_t hits() const { return hits_; }
+    uint64_t misses() const { return misses_; }
+};
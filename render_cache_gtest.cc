@@ -0,0 +1,146 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+
+#include "gtest/gtest.h"
+#include "render_cache.h"
+
+namespace {
+    render_cache::ptr_t line(const std::wstring& s)
+    {
+	auto l = std::make_shared<rendered_line>();
+	l->text_ = s;
+	return l;
+    }
+}
+
+TEST(rendered_line, add_attr)
+{
+    rendered_line l;
+    l.text_ = L"abcdefgh";
+    l.add_attr(1, 3, 0, 1);
+    l.add_attr(3, 4, 0, 2);
+    l.add_attr(6, 8, 0, 2);
+    ASSERT_EQ(5u, l.attr_.size());
+    ASSERT_EQ(0u, l.attr_[0].begin_);
+    ASSERT_EQ(1u, l.attr_[0].end_);
+    ASSERT_EQ(0u, l.attr_[0].attr_);
+    ASSERT_EQ(3u, l.attr_[2].begin_);
+    ASSERT_EQ(4u, l.attr_[2].end_);
+    ASSERT_EQ(2u, l.attr_[2].attr_);
+    ASSERT_EQ(8u, l.attr_[4].end_);
+
+    // overlapping spans are merged
+    l.add_attr(2, 7, 3, 2);
+    ASSERT_EQ(3u, l.attr_.size());
+    ASSERT_EQ(1u, l.attr_[1].attr_);
+    ASSERT_EQ(2u, l.attr_[2].begin_);
+    ASSERT_EQ(2u, l.attr_[2].attr_);
+
+    // clearing all attributes removes the runs
+    l.add_attr(0, 8, 3, 0);
+    ASSERT_TRUE(l.attr_.empty());
+    l.add_attr(4, 4, 0, 1);
+    ASSERT_TRUE(l.attr_.empty());
+}
+
+#include <random>
+TEST(rendered_line, add_attr_matches_attributes_per_character)
+{
+    std::mt19937 gen(1);
+    for(unsigned n = 0; n < 200; ++n) {
+	rendered_line l;
+	l.text_ = std::wstring(1 + gen() % 100, 'x');
+	std::vector<curses_attr_t> expected(l.text_.size());
+	for(unsigned k = gen() % 10; k > 0; --k) {
+	    size_t b = gen() % l.text_.size();
+	    size_t e = b + gen() % (l.text_.size() - b + 1);
+	    const curses_attr_t clear = gen() % 16, set = gen() % 16;
+	    l.add_attr(b, e, clear, set);
+	    for(size_t i = b; i < e; ++i) {
+		expected[i] = (expected[i] & ~clear) | set;
+	    }
+	}
+	for(size_t i = 0; i < expected.size(); ++i) {
+	    ASSERT_EQ(expected[i], l.attr(i));
+	}
+	// the runs cover the text and neighbours have different attributes
+	if (! l.attr_.empty()) {
+	    ASSERT_EQ(0u, l.attr_.front().begin_);
+	    ASSERT_EQ(l.text_.size(), l.attr_.back().end_);
+	    for(size_t i = 1; i < l.attr_.size(); ++i) {
+		ASSERT_EQ(l.attr_[i-1].end_, l.attr_[i].begin_);
+		ASSERT_NE(l.attr_[i-1].attr_, l.attr_[i].attr_);
+	    }
+	}
+    }
+}
+
+TEST(render_cache, find_and_evict_least_recently_used)
+{
+    render_cache c(2);
+    ASSERT_EQ(nullptr, c.find(1));
+    c.add(1, line(L"one"));
+    c.add(2, line(L"two"));
+    ASSERT_EQ(L"one", c.find(1)->text_);
+    // line 2 is the least recently used line
+    c.add(3, line(L"three"));
+    ASSERT_EQ(2u, c.size());
+    ASSERT_EQ(nullptr, c.find(2));
+    ASSERT_EQ(L"one", c.find(1)->text_);
+    ASSERT_EQ(L"three", c.find(3)->text_);
+    ASSERT_EQ(3u, c.hits());
+    ASSERT_EQ(2u, c.misses());
+
+    // replace a line
+    c.add(3, line(L"3"));
+    ASSERT_EQ(2u, c.size());
+    ASSERT_EQ(L"3", c.find(3)->text_);
+}
+
+TEST(render_cache, generation_clears_the_cache)
+{
+    render_cache c;
+    c.generation(1);
+    c.add(1, line(L"one"));
+    c.generation(1);
+    ASSERT_EQ(1u, c.size());
+    c.generation(2);
+    ASSERT_EQ(0u, c.size());
+    ASSERT_EQ(nullptr, c.find(1));
+}
+
+TEST(rendered_line, index_at)
+{
+    rendered_line l;
+    l.text_ = L"a\tbc";
+    // a at column 10, the tab at 11, b at 12, c at 13
+    ASSERT_EQ(std::string::npos, l.index_at(0, 10, 9, 20, 4));
+    ASSERT_EQ(0u, l.index_at(0, 10, 10, 20, 4));
+    ASSERT_EQ(1u, l.index_at(0, 10, 11, 20, 4));
+    ASSERT_EQ(2u, l.index_at(0, 10, 12, 20, 4));
+    ASSERT_EQ(3u, l.index_at(0, 10, 13, 20, 4));
+    ASSERT_EQ(std::string::npos, l.index_at(0, 10, 14, 20, 4));
+    // c is not printed on the screen
+    ASSERT_EQ(std::string::npos, l.index_at(0, 10, 13, 13, 4));
+    // the tab covers 11..13 if tab stops are shifted by 2
+    ASSERT_EQ(1u, l.index_at(0, 10, 13, 20, 4, 2));
+    ASSERT_EQ(2u, l.index_at(0, 10, 14, 20, 4, 2));
+    // start with the second row of a line
+    ASSERT_EQ(3u, l.index_at(2, 0, 1, 20, 4));
+}
+
+TEST(rendered_line, find_target)
+{
+    std::vector<rendered_line::target> v;
+    v.push_back(rendered_line::target { 2, 5, L"abc" });
+    v.push_back(rendered_line::target { 7, 8, L"d" });
+    ASSERT_EQ(nullptr, rendered_line::find_target(v, 1));
+    ASSERT_EQ(L"abc", rendered_line::find_target(v, 2)->str_);
+    ASSERT_EQ(L"abc", rendered_line::find_target(v, 4)->str_);
+    ASSERT_EQ(nullptr, rendered_line::find_target(v, 5));
+    ASSERT_EQ(L"d", rendered_line::find_target(v, 7)->str_);
+    ASSERT_EQ(nullptr, rendered_line::find_target(v, 8));
+    ASSERT_EQ(nullptr, rendered_line::find_target(v, std::string::npos));
+}
@@ -4,43 +4,137 @@
  */
 
 #include "search.h"
-#include "to_wide.h"
+#include "worker_pool.h"
 #include <cassert>
+#include <limits>
+
+namespace {
+    /**
+     * match the displayed lines in [first..last] in ascending order and store the first match in best, if it is smaller.
+     * Stops at lines >= best.
+     */
+    void search_chunk_forward(const line_regex& rgx, const display_set& lines, const file_index& fi, line_number_t first, line_number_t last, std::atomic<line_number_t>& best, const std::atomic<bool> *cancel)
+    {
+	line_number_t n;
+	if (! lines.ceiling(first, n)) {
+	    return;
+	}
+	while(n <= last && n < best) {
+	    if (cancel && *cancel) {
+		return;
+	    }
+	    const line_t& l = fi.parsed_line(n);
+	    if (rgx.search(l.beg_, l.end_)) {
+		line_number_t b = best;
+		while(n < b && ! best.compare_exchange_weak(b, n)) {
+		}
+		return;
+	    }
+	    if (! lines.next(n, n)) {
+		return;
+	    }
+	}
+    }
+
+    /**
+     * match the displayed lines in [first..last] in descending order and store the first match in best, if it is larger.
+     * Stops at lines <= best.
+     */
+    void search_chunk_backward(const line_regex& rgx, const display_set& lines, const file_index& fi, line_number_t first, line_number_t last, std::atomic<line_number_t>& best, const std::atomic<bool> *cancel)
+    {
+	line_number_t n;
+	if (! lines.floor(last, n)) {
+	    return;
+	}
+	while(n >= first && n > best) {
+	    if (cancel && *cancel) {
+		return;
+	    }
+	    const line_t& l = fi.parsed_line(n);
+	    if (rgx.search(l.beg_, l.end_)) {
+		line_number_t b = best;
+		while(n > b && ! best.compare_exchange_weak(b, n)) {
+		}
+		return;
+	    }
+	    if (! lines.prev(n, n)) {
+		return;
+	    }
+	}
+    }
+}
 
 bool
-search_next(std::wregex rgx, DisplayInfo::ptr_t di, file_index::ptr_t fi)
+search_nearest(const line_regex& rgx, const display_set& lines, const file_index& fi, line_number_t n, bool forward, line_number_t& out, const std::atomic<bool> *cancel)
 {
-    if (! di->start()) {
+    const line_number_t C = search_chunk_lines;
+    if (forward) {
+	const line_number_t last = lines.last();
+	if (n >= last) {
+	    return false;
+	}
+	// chunk i covers [n+1 + i*C .. n + (i+1)*C]
+	const unsigned num = static_cast<unsigned>((last - n - 1) / C + 1);
+	const line_number_t none = std::numeric_limits<line_number_t>::max();
+	std::atomic<line_number_t> best(none);
+	parallel_for(num, [&](unsigned i) {
+		const line_number_t first = n + 1 + i * C;
+		// a chunk after a match can not contain a nearer match
+		if (first >= best) {
+		    return;
+		}
+		search_chunk_forward(rgx, lines, fi, first, (last - first < C) ? last : first + (C - 1), best, cancel);
+	    });
+	if ((cancel && *cancel) || best == none) {
+	    return false;
+	}
+	out = best;
+	return true;
+    }
+
+    const line_number_t first = lines.first();
+    if (first == 0 || n <= first) {
 	return false;
     }
-    while(di->next()) {
-	const line_number_t num = di->current();
-	const line_t line = fi->line(num);
-	std::wstring s = to_wide(line.to_string());
-	if (std::regex_search(s, rgx)) {
-	    const bool b = di->go_to(line.num_);
-	    assert(b);
-	    return true;
-	}
+    // chunk i covers [n-1 - (i+1)*C+1 .. n-1 - i*C]
+    const unsigned num = static_cast<unsigned>((n - 1 - first) / C + 1);
+    // line numbers start with 1
+    const line_number_t none = 0;
+    std::atomic<line_number_t> best(none);
+    parallel_for(num, [&](unsigned i) {
+	    const line_number_t last = n - 1 - i * C;
+	    if (last <= best) {
+		return;
+	    }
+	    search_chunk_backward(rgx, lines, fi, (last > C) ? last - (C - 1) : 1, last, best, cancel);
+	});
+    if ((cancel && *cancel) || best == none) {
+	return false;
     }
-    return false;
+    out = best;
+    return true;
 }
 
 bool
-search_prev(std::wregex rgx, DisplayInfo::ptr_t di, file_index::ptr_t fi)
+search_next(const line_regex& rgx, DisplayInfo::ptr_t di, file_index::ptr_t fi)
 {
-    if (! di->start()) {
+    line_number_t n;
+    if (! search_nearest(rgx, *di->lines(), *fi, di->topLineNum(), true, n)) {
 	return false;
     }
-    while(di->prev()) {
-	const line_number_t num = di->current();
-	const line_t line = fi->line(num);
-	std::wstring s = to_wide(line.to_string());
-	if (std::regex_search(s, rgx)) {
-	    const bool b = di->go_to(line.num_);
-	    assert(b);
-	    return true;
-	}
+    const bool b = di->go_to(n);
+    assert(b);
+    return true;
+}
+
+bool
+search_prev(const line_regex& rgx, DisplayInfo::ptr_t di, file_index::ptr_t fi)
+{
+    line_number_t n;
+    if (! search_nearest(rgx, *di->lines(), *fi, di->topLineNum(), false, n)) {
+	return false;
     }
-    return false;
+    const bool b = di->go_to(n);
+    assert(b);
+    return true;
 }
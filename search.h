@@ -5,16 +5,40 @@
 #pragma once
 #include "display_info.h"
 #include "file_index.h"
-#include <regex>
+#include "regex_index.h"
+#include <atomic>
+
+/// number of line numbers in a chunk of search_nearest().
+const line_number_t search_chunk_lines = 1 << 16;
+
+/**
+ * search the displayed lines for the match of rgx that is nearest to n.
+ * The displayed lines after (or before) n are split into chunks of
+ * search_chunk_lines line numbers, which are matched in parallel,
+ * the chunks near n first. A chunk stops as soon as it can not
+ * contain a match nearer than a match found by another chunk.
+ * The regular expression is matched on the bytes of the lines, the '!' flag is ignored.
+ * @param rgx the search regular expression.
+ * @param lines the displayed lines.
+ * @param fi the file index, all lines of lines must be parsed.
+ * @param n the line number where the search starts, n itself is not matched.
+ * @param forward if true search for the smallest match > n; if false search for the largest match < n.
+ * @param[out] out the matching line number.
+ * @param cancel if set to true, the search stops early and returns false.
+ * @return true if a match was found; false otherwise.
+ */
+bool search_nearest(const line_regex& rgx, const display_set& lines, const file_index& fi, line_number_t n, bool forward, line_number_t& out, const std::atomic<bool> *cancel = nullptr);
 
 /**
  * search for the next occurance of the regular expression rgx in di using the lines from fi.
+ * The regular expression is matched on the bytes of the lines.
  * @return true if a match was found; false otherwise.
  */
-bool search_next(std::wregex rgx, DisplayInfo::ptr_t di, file_index::ptr_t fi);
+bool search_next(const line_regex& rgx, DisplayInfo::ptr_t di, file_index::ptr_t fi);
 
 /**
  * search for the previous occurance of the regular expression rgx in di using the lines from fi.
+ * The regular expression is matched on the bytes of the lines.
  * @return true if a match was found; false otherwise.
  */
-bool search_prev(std::wregex rgx, DisplayInfo::ptr_t di, file_index::ptr_t fi);
+bool search_prev(const line_regex& rgx, DisplayInfo::ptr_t di, file_index::ptr_t fi);
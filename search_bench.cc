@@ -0,0 +1,105 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+
+#include "gtest/gtest.h"
+#include "regex_index.h"
+#include "search.h"
+#include "temporary_file.h"
+#include "to_wide.h"
+#include "timeGetTime.h"
+#include "worker_pool.h"
+#include <iostream>
+#include <random>
+#include <regex>
+
+namespace {
+    std::vector<std::string> log_lines(unsigned num)
+    {
+	std::mt19937 gen(1);
+	std::vector<std::string> v;
+	for(unsigned u = 0; u < num; ++u) {
+	    std::string s = "2024-01-01 12:00:" + std::to_string(u % 60) + " host" + std::to_string(gen() % 100) + " ";
+	    const unsigned n = 40 + gen() % 100;
+	    for(unsigned i = 0; i < n; ++i) {
+		s += static_cast<char>('a' + gen() % 26);
+	    }
+	    v.push_back(s);
+	}
+	return v;
+    }
+
+    /// search lines with the wide regex used before and with line_regex and print the time.
+    void bench(const std::vector<std::string>& lines, const std::string& rgx)
+    {
+	std::wregex wrgx(to_wide(rgx));
+	unsigned wide_matches = 0, byte_matches = 0;
+	uint32_t t = timeGetTime();
+	std::wstring w;
+	for(const auto& l : lines) {
+	    to_wide(l.data(), l.size(), w);
+	    if (std::regex_search(w, wrgx)) {
+		++wide_matches;
+	    }
+	}
+	const uint32_t wide_ms = timeGetTime() - t;
+
+	line_regex r('/' + rgx + '/');
+	t = timeGetTime();
+	for(const auto& l : lines) {
+	    if (r.search(l.data(), l.data() + l.size())) {
+		++byte_matches;
+	    }
+	}
+	const uint32_t byte_ms = timeGetTime() - t;
+
+	ASSERT_EQ(wide_matches, byte_matches);
+	std::clog << '/' << rgx << "/: wide " << wide_ms << " ms, " << (r.is_literal() ? "literal " : "bytes ") << byte_ms << " ms, " << byte_matches << " matches" << std::endl;
+    }
+}
+
+TEST(search_bench, wide_and_byte_search)
+{
+    const auto lines = log_lines(300000);
+    bench(lines, "host42 ");
+    bench(lines, "zzzz");
+    bench(lines, "host4[0-9] ab");
+}
+
+TEST(search_bench, nearest_match)
+{
+    TemporaryFile tmp;
+    FILE *f = tmp.file();
+    ASSERT_TRUE(f != nullptr);
+    const unsigned num = 2000000;
+    for(const auto& l : log_lines(num)) {
+	fprintf(f, "%s\n", l.c_str());
+    }
+    fprintf(f, "needle1\n");
+    tmp.close();
+    auto fi = std::make_shared<file_index>(to_utf8(tmp.filename()));
+    fi->parse_all();
+    identity_display lines(fi);
+    const line_regex rgx("/ne+dle[0-9]/");
+
+    uint32_t t = timeGetTime();
+    line_number_t seq = 0;
+    for(line_number_t n = 1; n <= lines.last(); ++n) {
+	const line_t& l = fi->parsed_line(n);
+	if (rgx.search(l.beg_, l.end_)) {
+	    seq = n;
+	    break;
+	}
+    }
+    const uint32_t seq_ms = timeGetTime() - t;
+
+    t = timeGetTime();
+    line_number_t par = 0;
+    ASSERT_TRUE(search_nearest(rgx, lines, *fi, 0, true, par));
+    const uint32_t par_ms = timeGetTime() - t;
+
+    ASSERT_EQ(num + 1, seq);
+    ASSERT_EQ(seq, par);
+    std::clog << "nearest match after " << num << " lines: sequential " << seq_ms << " ms, search_nearest " << par_ms << " ms with " << worker_threads() << " threads" << std::endl;
+}
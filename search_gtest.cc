@@ -0,0 +1,105 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "gtest/gtest.h"
+#include "search.h"
+#include "numbered_file_gtest.h"
+#include <random>
+
+namespace {
+    /// a file with 300000 lines, lines 5, 70000, 70001 and 250000 contain "match".
+    class search_fix : public numbered_file_fix {
+    protected:
+	file_index::ptr_t fi_;
+
+	virtual void SetUp()
+	{
+	    create(300000, [](unsigned u) {
+		    const bool m = u == 5 || u == 70000 || u == 70001 || u == 250000;
+		    return m ? " match\n" : "\n";
+		});
+	    fi_ = parse_all();
+	}
+
+	/// @return the nearest match by a sequential search; 0 if there is none.
+	line_number_t sequential(const line_regex& rgx, const display_set& lines, line_number_t n, bool forward)
+	{
+	    while(forward ? lines.next(n, n) : lines.prev(n, n)) {
+		const line_t& l = fi_->parsed_line(n);
+		if (rgx.search(l.beg_, l.end_)) {
+		    return n;
+		}
+	    }
+	    return 0;
+	}
+    };
+}
+
+TEST_F(search_fix, finds_the_nearest_match)
+{
+    const line_regex rgx("/match/");
+    identity_display lines(fi_);
+    line_number_t n = 0;
+    ASSERT_TRUE(search_nearest(rgx, lines, *fi_, 0, true, n));
+    ASSERT_EQ(5u, n);
+    ASSERT_TRUE(search_nearest(rgx, lines, *fi_, 5, true, n));
+    ASSERT_EQ(70000u, n);
+    ASSERT_TRUE(search_nearest(rgx, lines, *fi_, 70000, true, n));
+    ASSERT_EQ(70001u, n);
+    ASSERT_TRUE(search_nearest(rgx, lines, *fi_, 70001, true, n));
+    ASSERT_EQ(250000u, n);
+    ASSERT_FALSE(search_nearest(rgx, lines, *fi_, 250000, true, n));
+    ASSERT_FALSE(search_nearest(rgx, lines, *fi_, 300000, true, n));
+
+    ASSERT_TRUE(search_nearest(rgx, lines, *fi_, 300000, false, n));
+    ASSERT_EQ(250000u, n);
+    ASSERT_TRUE(search_nearest(rgx, lines, *fi_, 250000, false, n));
+    ASSERT_EQ(70001u, n);
+    ASSERT_TRUE(search_nearest(rgx, lines, *fi_, 70001, false, n));
+    ASSERT_EQ(70000u, n);
+    ASSERT_TRUE(search_nearest(rgx, lines, *fi_, 70000, false, n));
+    ASSERT_EQ(5u, n);
+    ASSERT_FALSE(search_nearest(rgx, lines, *fi_, 5, false, n));
+    ASSERT_FALSE(search_nearest(rgx, lines, *fi_, 1, false, n));
+
+    ASSERT_FALSE(search_nearest(line_regex("/no such line/"), lines, *fi_, 1, true, n));
+}
+
+TEST_F(search_fix, agrees_with_a_sequential_search)
+{
+    std::mt19937 gen(1);
+    line_set s;
+    for(line_number_t n = 1; n <= 300000; n += 1 + gen() % 7) {
+	s.push_back(n);
+    }
+    const line_set_display lines(std::move(s));
+    const line_regex rgx("/(9999[05]|match)$/");
+    for(unsigned u = 0; u < 20; ++u) {
+	const line_number_t start = gen() % 300002;
+	for(int forward = 0; forward < 2; ++forward) {
+	    line_number_t n = 0;
+	    const line_number_t expected = sequential(rgx, lines, start, forward);
+	    ASSERT_EQ(expected != 0, search_nearest(rgx, lines, *fi_, start, forward, n)) << start;
+	    if (expected) {
+		ASSERT_EQ(expected, n) << start;
+	    }
+	}
+    }
+}
+
+TEST_F(search_fix, cancel)
+{
+    identity_display lines(fi_);
+    std::atomic<bool> cancel(true);
+    line_number_t n = 0;
+    ASSERT_FALSE(search_nearest(line_regex("/match/"), lines, *fi_, 0, true, n, &cancel));
+    ASSERT_FALSE(search_nearest(line_regex("/match/"), lines, *fi_, 300000, false, n, &cancel));
+}
+
+TEST_F(search_fix, empty_display)
+{
+    line_number_t n = 0;
+    ASSERT_FALSE(search_nearest(line_regex("/match/"), line_set_display(line_set()), *fi_, 0, true, n));
+    ASSERT_FALSE(search_nearest(line_regex("/match/"), line_set_display(line_set()), *fi_, 10, false, n));
+}
@@ -0,0 +1,149 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+
+#include "search_index.h"
+#include <cassert>
+
+search_index::search_index(display_set::ptr_t lines, const std::string& rgx, line_number_t start) :
+    lines_(lines),
+    rgx_(rgx, line_regex::characters),
+    start_(start),
+    done_(0),
+    cancel_(false)
+{
+    assert(lines_);
+    const line_number_t last = lines_->last();
+    if (last > 0) {
+	blocks_.resize((last >> block_bits) + 1);
+    }
+}
+
+line_set
+search_index::match_block(const file_index& fi, size_t b) const
+{
+    line_set s;
+    const line_number_t first = static_cast<line_number_t>(b << block_bits);
+    const line_number_t last = first + ((1u << block_bits) - 1);
+    line_number_t n;
+    if (! lines_->ceiling(first, n)) {
+	return s;
+    }
+    while(n <= last) {
+	const line_t& l = fi.parsed_line(n);
+	if (rgx_.search(l.beg_, l.end_)) {
+	    s.push_back(n);
+	}
+	if (! lines_->next(n, n)) {
+	    break;
+	}
+    }
+    return s;
+}
+
+bool
+search_index::build(const file_index& fi)
+{
+    const size_t num = blocks_.size();
+    const size_t start = std::min<size_t>(start_ >> block_bits, num ? num - 1 : 0);
+    // match the block of start, then alternate between the following and the preceding blocks
+    for(size_t i = 0; i < 2 * num; ++i) {
+	const size_t d = (i + 1) / 2;
+	size_t b;
+	if (i % 2 == 0) {
+	    b = start + d;
+	    if (b >= num) {
+		continue;
+	    }
+	} else {
+	    if (d > start) {
+		continue;
+	    }
+	    b = start - d;
+	}
+	if (cancel_) {
+	    return false;
+	}
+	auto s = std::make_shared<line_set>(match_block(fi, b));
+	std::lock_guard<std::mutex> lock(mtx_);
+	blocks_[b] = s;
+	++done_;
+	if (done_ == num) {
+	    before_.resize(num);
+	    uint64_t sum = 0;
+	    for(size_t u = 0; u < num; ++u) {
+		before_[u] = sum;
+		sum += blocks_[u]->size();
+	    }
+	}
+    }
+    return true;
+}
+
+unsigned
+search_index::perc() const
+{
+    if (blocks_.empty()) {
+	return 100;
+    }
+    return static_cast<unsigned>(done_ * 100 / blocks_.size());
+}
+
+search_index::result_t
+search_index::next(line_number_t n, line_number_t& out) const
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    for(size_t b = n >> block_bits; b < blocks_.size(); ++b) {
+	const auto& s = blocks_[b];
+	if (! s) {
+	    return unknown;
+	}
+	if (s->next(n, out)) {
+	    return found;
+	}
+    }
+    return not_found;
+}
+
+search_index::result_t
+search_index::prev(line_number_t n, line_number_t& out) const
+{
+    if (n <= 1 || blocks_.empty()) {
+	return not_found;
+    }
+    std::lock_guard<std::mutex> lock(mtx_);
+    for(size_t b = std::min<size_t>((n - 1) >> block_bits, blocks_.size() - 1) + 1; b-- > 0; ) {
+	const auto& s = blocks_[b];
+	if (! s) {
+	    return unknown;
+	}
+	if (s->prev(n, out)) {
+	    return found;
+	}
+    }
+    return not_found;
+}
+
+uint64_t
+search_index::size() const
+{
+    assert(complete());
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (blocks_.empty()) {
+	return 0;
+    }
+    return before_.back() + blocks_.back()->size();
+}
+
+uint64_t
+search_index::rank(line_number_t n) const
+{
+    assert(complete());
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (blocks_.empty()) {
+	return 0;
+    }
+    const size_t b = std::min<size_t>(n >> block_bits, blocks_.size() - 1);
+    return before_[b] + blocks_[b]->rank(n);
+}
@@ -0,0 +1,110 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#pragma once
+#include "display_set.h"
+#include "file_index.h"
+#include "regex_index.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * the displayed lines that match the search regular expression.
+ *
+ * The index is built by build() in a background thread. The displayed
+ * lines are matched in blocks of 65536 line numbers, starting with the
+ * block of the line that was displayed when the search started and
+ * then alternating between the following and the preceding blocks, so
+ * the matches near the display are known first. next() and prev()
+ * answer from the finished blocks while the index is incomplete.
+ *
+ * Like a lines filter, the regular expression is matched on the bytes
+ * of the lines, without converting them into wide characters, unless
+ * it could match a multi byte character differently than the
+ * highlighting of the search matches.
+ */
+class search_index
+{
+public:
+    typedef std::shared_ptr<search_index> ptr_t;
+
+    /// the result of next() and prev().
+    enum result_t {
+	/// a match was found.
+	found,
+	/// there is no match.
+	not_found,
+	/// the blocks that could contain the match have not been matched yet.
+	unknown,
+    };
+
+    /// number of line numbers in a block, the same as a line_set chunk.
+    static const unsigned block_bits = 16;
+
+private:
+    const display_set::ptr_t lines_;
+    const line_regex rgx_;
+    const line_number_t start_;
+
+    mutable std::mutex mtx_;
+    /// the matches of each block; nullptr if the block has not been matched yet.
+    std::vector<std::shared_ptr<const line_set>> blocks_;
+    /// the number of matches in all previous blocks, computed when all blocks are matched.
+    std::vector<uint64_t> before_;
+
+    /// the number of matched blocks.
+    std::atomic<size_t> done_;
+    std::atomic<bool> cancel_;
+
+    /// @return the matches of the displayed lines in block b.
+    line_set match_block(const file_index& fi, size_t b) const;
+
+public:
+    /**
+     * @param lines the displayed lines, must not be nullptr.
+     * @param rgx a (normalized) search regular expression string. The '!' flag is ignored.
+     * @param start the line number where the search starts.
+     * @throws std::runtime_error if regular expression could not be parsed.
+     */
+    search_index(display_set::ptr_t lines, const std::string& rgx, line_number_t start);
+
+    /**
+     * match all blocks.
+     * @param fi the file index, parse_all() must have been called before.
+     * @return true if all blocks were matched; false if cancel() was called.
+     */
+    bool build(const file_index& fi);
+
+    /// stop build().
+    void cancel() { cancel_ = true; }
+
+    /// @return true if cancel() was called.
+    bool canceled() const { return cancel_; }
+
+    /// @return the displayed lines that are searched.
+    display_set::ptr_t lines() const { return lines_; }
+
+    /// @return the search regular expression.
+    const line_regex& rgx() const { return rgx_; }
+
+    /// @return true if all blocks are matched.
+    bool complete() const { return done_ == blocks_.size(); }
+
+    /// @return the percentage of matched blocks, between [0..100].
+    unsigned perc() const;
+
+    /// find the smallest match > n.
+    result_t next(line_number_t n, line_number_t& out) const;
+
+    /// find the largest match < n.
+    result_t prev(line_number_t n, line_number_t& out) const;
+
+    /// @return the number of matches. This function can only be called if complete() is true.
+    uint64_t size() const;
+
+    /// @return the number of matches <= n. This function can only be called if complete() is true.
+    uint64_t rank(line_number_t n) const;
+};
@@ -0,0 +1,86 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "gtest/gtest.h"
+#include "search_index.h"
+#include "numbered_file_gtest.h"
+
+namespace {
+    /// a file with 200000 lines, every 1000th line contains "match".
+    class search_index_fix : public numbered_file_fix {
+    protected:
+	file_index::ptr_t fi_;
+
+	virtual void SetUp()
+	{
+	    create(200000, [](unsigned u) { return (u % 1000) ? "\n" : " match\n"; });
+	    fi_ = parse_all();
+	}
+    };
+}
+
+TEST_F(search_index_fix, finds_matches_of_all_displayed_lines)
+{
+    search_index idx(std::make_shared<identity_display>(fi_), "match", 150000);
+    ASSERT_FALSE(idx.complete());
+    ASSERT_TRUE(idx.build(*fi_));
+    ASSERT_TRUE(idx.complete());
+    ASSERT_EQ(100u, idx.perc());
+    ASSERT_EQ(200u, idx.size());
+
+    line_number_t n = 0;
+    ASSERT_EQ(search_index::found, idx.next(1, n));
+    ASSERT_EQ(1000u, n);
+    ASSERT_EQ(search_index::found, idx.next(1000, n));
+    ASSERT_EQ(2000u, n);
+    ASSERT_EQ(search_index::found, idx.next(65535, n));
+    ASSERT_EQ(66000u, n);
+    ASSERT_EQ(search_index::not_found, idx.next(200000, n));
+    ASSERT_EQ(search_index::found, idx.prev(66000, n));
+    ASSERT_EQ(65000u, n);
+    ASSERT_EQ(search_index::found, idx.prev(200000, n));
+    ASSERT_EQ(199000u, n);
+    ASSERT_EQ(search_index::not_found, idx.prev(1000, n));
+    ASSERT_EQ(66u, idx.rank(66000));
+    ASSERT_EQ(65u, idx.rank(65999));
+}
+
+TEST_F(search_index_fix, searches_only_displayed_lines)
+{
+    line_set s;
+    for(line_number_t n = 1500; n <= 190000; n += 500) {
+	s.push_back(n);
+    }
+    search_index idx(std::make_shared<line_set_display>(std::move(s)), "match", 1);
+    ASSERT_TRUE(idx.build(*fi_));
+    line_number_t n = 0;
+    ASSERT_EQ(search_index::found, idx.next(1, n));
+    ASSERT_EQ(2000u, n);
+    ASSERT_EQ(search_index::not_found, idx.next(190000, n));
+    ASSERT_EQ(search_index::found, idx.prev(190000, n));
+    ASSERT_EQ(189000u, n);
+    ASSERT_EQ(189u, idx.size());
+}
+
+TEST_F(search_index_fix, incomplete_index_answers_from_matched_blocks)
+{
+    search_index idx(std::make_shared<identity_display>(fi_), "match", 150000);
+    line_number_t n = 0;
+    ASSERT_EQ(search_index::unknown, idx.next(150000, n));
+    ASSERT_EQ(search_index::unknown, idx.prev(150000, n));
+    idx.cancel();
+    ASSERT_FALSE(idx.build(*fi_));
+    ASSERT_FALSE(idx.complete());
+}
+
+TEST_F(search_index_fix, empty_display)
+{
+    search_index idx(std::make_shared<line_set_display>(line_set()), "match", 0);
+    ASSERT_TRUE(idx.build(*fi_));
+    ASSERT_TRUE(idx.complete());
+    line_number_t n = 0;
+    ASSERT_EQ(search_index::not_found, idx.next(0, n));
+    ASSERT_EQ(search_index::not_found, idx.prev(10, n));
+    ASSERT_EQ(0u, idx.size());
+}
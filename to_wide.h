@@ -5,6 +5,11 @@
 #pragma once
 #include <string>
 std::wstring to_wide(const std::string& s);
+/**
+ * convert the multibyte string [s..s+len) to wide characters like to_wide().
+ * @param[out] out the converted characters replace its contents, its memory is reused.
+ */
+void to_wide(const char *s, size_t len, std::wstring& out);
 inline std::wstring to_wide(const std::wstring& s) { return s; }
 std::string to_utf8(const std::wstring& s);
 inline std::string to_utf8(const std::string& s) { return s; }
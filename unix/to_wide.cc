@@ -3,10 +3,12 @@
  * :indentSize=4:tabSize=8:
  */
 #include "to_wide.h"
+#include "utf8.h"
 #include <cassert>
 #include <cstring>
 #include <cstdlib>
 #include <errno.h>
+#include <langinfo.h>
 
 std::wstring to_wide(const std::string& s)
 {
@@ -42,6 +44,16 @@ std::wstring to_wide(const std::string& s)
     return out;
 }
 
+void to_wide(const char *s, size_t len, std::wstring& out)
+{
+    // decode directly, unless the locale uses another encoding
+    if (strcmp(nl_langinfo(CODESET), "UTF-8") == 0) {
+	utf8_decode(s, len, out);
+    } else {
+	out = to_wide(std::string(s, len));
+    }
+}
+
 std::string to_utf8(const std::wstring& s)
 {
     auto len = wcstombs(nullptr, s.c_str(), 0);
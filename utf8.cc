@@ -0,0 +1,152 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+
+#include "utf8.h"
+#include <algorithm>
+#include <stdint.h>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define UTF8_SSE2 1
+#endif
+
+namespace {
+    /// @return true if b is a continuation byte.
+    inline bool cont(unsigned char b)
+    {
+	return (b & 0xC0) == 0x80;
+    }
+
+    /**
+     * decode the UTF-8 sequence at s.
+     * @param[out] c the decoded code point.
+     * @return the length of the sequence; 0 if s does not start a valid sequence.
+     */
+    inline size_t decode_one(const unsigned char *s, const unsigned char *end, uint32_t& c)
+    {
+	const unsigned char b0 = s[0];
+	if (b0 < 0x80) {
+	    c = b0;
+	    return 1;
+	}
+	// a continuation byte or an overlong two byte sequence
+	if (b0 < 0xC2) {
+	    return 0;
+	}
+	if (b0 < 0xE0) {
+	    if (end - s < 2 || ! cont(s[1])) {
+		return 0;
+	    }
+	    c = ((b0 & 0x1Fu) << 6) | (s[1] & 0x3Fu);
+	    return 2;
+	}
+	if (b0 < 0xF0) {
+	    if (end - s < 3 || ! cont(s[1]) || ! cont(s[2])) {
+		return 0;
+	    }
+	    c = ((b0 & 0x0Fu) << 12) | ((s[1] & 0x3Fu) << 6) | (s[2] & 0x3Fu);
+	    if (c < 0x800 || (c >= 0xD800 && c < 0xE000)) {
+		return 0;
+	    }
+	    return 3;
+	}
+	// like glibc, accept the four to six byte sequences of ISO 10646 up to 0x7FFFFFFF
+	size_t n;
+	uint32_t min;
+	if (b0 < 0xF8) {
+	    n = 4;
+	    min = 0x10000;
+	    c = b0 & 0x07u;
+	} else if (b0 < 0xFC) {
+	    n = 5;
+	    min = 0x200000;
+	    c = b0 & 0x03u;
+	} else if (b0 < 0xFE) {
+	    n = 6;
+	    min = 0x4000000;
+	    c = b0 & 0x01u;
+	} else {
+	    return 0;
+	}
+	if (static_cast<size_t>(end - s) < n) {
+	    return 0;
+	}
+	for(size_t i = 1; i < n; ++i) {
+	    if (! cont(s[i])) {
+		return 0;
+	    }
+	    c = (c << 6) | (s[i] & 0x3Fu);
+	}
+	if (c < min || (sizeof(wchar_t) == 2 && c > 0x10FFFF)) {
+	    return 0;
+	}
+	return n;
+    }
+
+    /// store the code point c at o.
+    inline wchar_t* put(wchar_t *o, uint32_t c)
+    {
+	if (sizeof(wchar_t) == 2 && c >= 0x10000) {
+	    c -= 0x10000;
+	    *o++ = static_cast<wchar_t>(0xD800 + (c >> 10));
+	    *o++ = static_cast<wchar_t>(0xDC00 + (c & 0x3FF));
+	} else {
+	    *o++ = static_cast<wchar_t>(c);
+	}
+	return o;
+    }
+}
+
+void
+utf8_decode(const char *str, size_t len, std::wstring& out)
+{
+    // every byte decodes to at most one wchar_t, a four byte sequence to at most two
+    out.resize(len);
+    if (len == 0) {
+	return;
+    }
+    const unsigned char *s = reinterpret_cast<const unsigned char*>(str);
+    const unsigned char *end = s + len;
+    wchar_t *o = &out[0];
+    while (s < end) {
+#if UTF8_SSE2
+	// convert blocks of 16 ASCII characters
+	const __m128i zero = _mm_setzero_si128();
+	while (end - s >= 16) {
+	    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+	    if (_mm_movemask_epi8(v)) {
+		break;
+	    }
+	    const __m128i lo = _mm_unpacklo_epi8(v, zero);
+	    const __m128i hi = _mm_unpackhi_epi8(v, zero);
+	    __m128i *p = reinterpret_cast<__m128i*>(o);
+	    if (sizeof(wchar_t) == 2) {
+		_mm_storeu_si128(p, lo);
+		_mm_storeu_si128(p + 1, hi);
+	    } else {
+		_mm_storeu_si128(p, _mm_unpacklo_epi16(lo, zero));
+		_mm_storeu_si128(p + 1, _mm_unpackhi_epi16(lo, zero));
+		_mm_storeu_si128(p + 2, _mm_unpacklo_epi16(hi, zero));
+		_mm_storeu_si128(p + 3, _mm_unpackhi_epi16(hi, zero));
+	    }
+	    s += 16;
+	    o += 16;
+	}
+#endif
+	// decode a block that contains non ASCII characters
+	const unsigned char *block_end = s + std::min<size_t>(end - s, 16);
+	while (s < block_end) {
+	    uint32_t c;
+	    const size_t n = decode_one(s, end, c);
+	    if (n == 0) {
+		*o++ = L'\uFFFD';
+		++s;
+	    } else {
+		o = put(o, c);
+		s += n;
+	    }
+	}
+    }
+    out.resize(o - &out[0]);
+}
@@ -0,0 +1,26 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#pragma once
+#include <cstddef>
+#include <string>
+
+/**
+ * decode the UTF-8 string [s..s+len) into wide characters.
+ *
+ * Every byte that does not start a valid UTF-8 sequence is decoded as
+ * U+FFFD and decoding continues with the next byte, like to_wide()
+ * does in a UTF-8 locale. Overlong sequences and surrogates are
+ * invalid; like glibc, the five and six byte sequences of ISO 10646
+ * are decoded. A NUL byte is decoded as U+0000. If wchar_t has 16
+ * bits, code points above U+FFFF are decoded as surrogate pairs and
+ * code points above U+10FFFF are invalid.
+ *
+ * Blocks of ASCII characters are converted with SSE2 if available.
+ *
+ * @param[out] out the decoded characters replace the contents of out.
+ *             The memory of out is reused, so pass the same string when
+ *             decoding many lines.
+ */
+void utf8_decode(const char *s, size_t len, std::wstring& out);
@@ -0,0 +1,77 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+
+#include "gtest/gtest.h"
+#include "utf8.h"
+#include "to_wide.h"
+#include "timeGetTime.h"
+#include <clocale>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+namespace {
+    /// decode lines with to_wide, which uses mbsrtowcs, and with utf8_decode and print the time.
+    void bench(const std::string& name, const std::vector<std::string>& lines, unsigned rounds)
+    {
+	size_t chars_to_wide = 0, chars_decode = 0;
+	uint32_t t = timeGetTime();
+	for(unsigned r = 0; r < rounds; ++r) {
+	    for(const auto& l : lines) {
+		chars_to_wide += to_wide(l).size();
+	    }
+	}
+	const uint32_t to_wide_ms = timeGetTime() - t;
+
+	std::wstring w;
+	t = timeGetTime();
+	for(unsigned r = 0; r < rounds; ++r) {
+	    for(const auto& l : lines) {
+		utf8_decode(l.data(), l.size(), w);
+		chars_decode += w.size();
+	    }
+	}
+	const uint32_t decode_ms = timeGetTime() - t;
+
+	ASSERT_EQ(chars_to_wide, chars_decode);
+	std::clog << name << ": to_wide " << to_wide_ms << " ms, utf8_decode " << decode_ms << " ms, " << chars_decode << " characters" << std::endl;
+    }
+}
+
+TEST(utf8_bench, decode)
+{
+    if (! setlocale(LC_ALL, "C.UTF-8") && ! setlocale(LC_ALL, "en_US.UTF-8")) {
+	std::clog << "no UTF-8 locale, skipping benchmark" << std::endl;
+	return;
+    }
+
+    std::vector<std::string> demo;
+    std::ifstream f("UTF-8-demo.txt");
+    std::string line;
+    while (std::getline(f, line)) {
+	demo.push_back(line);
+    }
+    bench("UTF-8-demo.txt", demo, 2000);
+
+    std::mt19937 gen(1);
+    std::vector<std::string> ascii;
+    for(unsigned u = 0; u < 100000; ++u) {
+	std::string s;
+	const unsigned n = 20 + gen() % 200;
+	for(unsigned i = 0; i < n; ++i) {
+	    s += static_cast<char>(' ' + gen() % 95);
+	}
+	ascii.push_back(s);
+    }
+    bench("ASCII lines", ascii, 5);
+
+    std::vector<std::string> json(1, std::string());
+    for(unsigned u = 0; u < 500000; ++u) {
+	json[0] += "{\"id\": " + std::to_string(u) + ", \"name\": \"n\xC3\xA4me\"}, ";
+    }
+    bench("long line", json, 5);
+
+    setlocale(LC_ALL, "C");
+}
@@ -0,0 +1,134 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "gtest/gtest.h"
+#include "utf8.h"
+#include "to_wide.h"
+#include <clocale>
+#include <fstream>
+#include <random>
+
+namespace {
+    std::wstring decode(const std::string& s)
+    {
+	std::wstring w;
+	utf8_decode(s.data(), s.size(), w);
+	return w;
+    }
+}
+
+TEST(utf8, decode)
+{
+    ASSERT_EQ(L"", decode(""));
+    ASSERT_EQ(L"abc", decode("abc"));
+    ASSERT_EQ(L"\u20AC", decode("\xE2\x82\xAC"));
+    ASSERT_EQ(L"\u00A2\u20AC", decode("\xC2\xA2\xE2\x82\xAC"));
+    ASSERT_EQ(std::wstring(1, L'\0'), decode(std::string(1, '\0')));
+#if !defined(_WIN32)
+    ASSERT_EQ(L"\U0001F600", decode("\xF0\x9F\x98\x80"));
+    // above U+10FFFF
+    ASSERT_EQ(std::wstring(1, 0x110000), decode("\xF4\x90\x80\x80"));
+    ASSERT_EQ(std::wstring(1, 0x4000000), decode("\xFC\x84\x80\x80\x80\x80"));
+#endif
+}
+
+TEST(utf8, invalid_bytes_are_replaced)
+{
+    // overlong
+    ASSERT_EQ(L"\u20AC\uFFFD\uFFFD\uFFFD\uFFFD\u00A2", decode("\u20AC" "\xF0\x82\x82\xAC" "\u00A2"));
+    ASSERT_EQ(L"\uFFFD\uFFFD", decode("\xC0\xAF"));
+    // truncated
+    ASSERT_EQ(L"Dirk\uFFFDWrites", decode("Dirk" "\xF4" "Writes"));
+    ASSERT_EQ(L"\uFFFD\uFFFDa", decode("\xE2\x82" "a"));
+    ASSERT_EQ(L"\uFFFD", decode("\xC2"));
+    // surrogate
+    ASSERT_EQ(L"\uFFFD\uFFFD\uFFFD", decode("\xED\xA0\x80"));
+    // overlong five byte sequence
+    ASSERT_EQ(L"\uFFFD\uFFFD\uFFFD\uFFFD\uFFFD", decode("\xF8\x80\x80\x80\xAF"));
+    ASSERT_EQ(L"\uFFFD\uFFFD", decode("\xFE\xFF"));
+    // continuation byte
+    ASSERT_EQ(L"a\uFFFDb", decode("a\x80" "b"));
+}
+
+TEST(utf8, ascii_blocks)
+{
+    for(size_t len = 0; len < 70; ++len) {
+	for(size_t pos = 0; pos <= len; ++pos) {
+	    std::string s(len, 'x');
+	    std::wstring expected(len, L'x');
+	    s.insert(pos, "\xE2\x82\xAC");
+	    expected.insert(pos, L"\u20AC");
+	    ASSERT_EQ(expected, decode(s));
+	}
+    }
+}
+
+TEST(utf8, reuses_the_buffer)
+{
+    std::wstring w;
+    const std::string s(1000, 'a');
+    utf8_decode(s.data(), s.size(), w);
+    ASSERT_EQ(1000u, w.size());
+    const size_t capacity = w.capacity();
+    utf8_decode("b", 1, w);
+    ASSERT_EQ(L"b", w);
+    ASSERT_EQ(capacity, w.capacity());
+}
+
+#if !defined(_WIN32)
+/// compare utf8_decode with to_wide, which uses mbsrtowcs.
+class utf8_to_wide_fix : public ::testing::Test {
+protected:
+    bool utf8_locale_;
+
+    virtual void SetUp()
+    {
+	utf8_locale_ = setlocale(LC_ALL, "C.UTF-8") || setlocale(LC_ALL, "en_US.UTF-8");
+    }
+    virtual void TearDown()
+    {
+	setlocale(LC_ALL, "C");
+    }
+};
+
+TEST_F(utf8_to_wide_fix, demo_file)
+{
+    if (! utf8_locale_) {
+	return;
+    }
+    std::ifstream f("UTF-8-demo.txt");
+    ASSERT_TRUE(f.good());
+    std::string line;
+    std::wstring w;
+    unsigned lines = 0;
+    while (std::getline(f, line)) {
+	to_wide(line.data(), line.size(), w);
+	ASSERT_EQ(to_wide(line), w) << line;
+	ASSERT_EQ(to_wide(line), decode(line)) << line;
+	++lines;
+    }
+    ASSERT_LT(200u, lines);
+}
+
+TEST_F(utf8_to_wide_fix, random_bytes)
+{
+    if (! utf8_locale_) {
+	return;
+    }
+    std::mt19937 gen(1);
+    const char *pieces[] = { "a", "\xC2\xA2", "\xE2\x82\xAC", "\xF0\x9F\x98\x80", "\xED\xA0\x80", "\xF4\x90\x80\x80", "\xC0\xAF", "\x80", "\xE2\x82", "\xFF", "\xFC\x84\x80\x80\x80\x80" };
+    for(unsigned u = 0; u < 2000; ++u) {
+	std::string s;
+	const unsigned n = gen() % 40;
+	for(unsigned i = 0; i < n; ++i) {
+	    if (gen() % 2) {
+		s += pieces[gen() % 11];
+	    } else {
+		s += static_cast<char>(1 + gen() % 255);
+	    }
+	}
+	ASSERT_EQ(to_wide(s), decode(s));
+    }
+}
+#endif
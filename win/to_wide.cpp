@@ -47,6 +47,11 @@ std::wstring to_wide(const std::string& s)
     return out;
 }
 
+void to_wide(const char *s, size_t len, std::wstring& out)
+{
+    out = to_wide(std::string(s, len));
+}
+
 std::string to_utf8(const std::wstring& s)
 {
     // first get size of target UTF-8 string
@@ -3,64 +3,326 @@
  * :indentSize=4:tabSize=8:
  */
 #include "word_set.h"
+#include "worker_pool.h"
+#include <algorithm>
 #include <cctype>
 #include <cassert>
+#include <cstring>
+#include <list>
+#include <mutex>
 
-namespace {
-    std::set<std::string> word_set;
-
-    bool is_word_character(int c)
-    {
-	return isalnum(c) || c=='_' || c=='-';
-    }
+bool
+is_word_character(char c)
+{
+    return isalnum(static_cast<unsigned char>(c)) || c=='_' || c=='-';
 }
 
+word_table::word_table() :
+    sorted_(true)
+{ }
+
 void
-add_to_word_set(const std::string& line)
+word_table::add(const char *word, size_t len, uint64_t count)
 {
-    std::string::const_iterator it = line.begin();
-    std::string::const_iterator beg = it, end = it;
-    while(it != line.end()) {
+    words_.push_back(entry { arena_.size(), len, count });
+    arena_.append(word, len);
+    sorted_ = false;
+}
 
+void
+word_table::add_words(const char *it, const char *e)
+{
+    while(it != e) {
 	// search for start of word
-	while(it != line.end() && !is_word_character(*it)) {
+	while(it != e && !is_word_character(*it)) {
 	    ++it;
 	}
-	beg = it;
+	const char *beg = it;
 
 	// search for end of word
-	while(it != line.end() && is_word_character(*it)) {
+	while(it != e && is_word_character(*it)) {
 	    ++it;
 	}
-	end = it;
 
-	if (beg != end) {
-	    word_set.insert(std::string(beg,end));
+	if (beg != it) {
+	    add(beg, it - beg);
+	}
+    }
+}
+
+void
+word_table::add(const word_table& t)
+{
+    const size_t offset = arena_.size();
+    arena_ += t.arena_;
+    for(const auto& w : t.words_) {
+	words_.push_back(entry { offset + w.offset_, w.size_, w.count_ });
+    }
+    if (! t.words_.empty()) {
+	sorted_ = false;
+    }
+}
+
+void
+word_table::sort()
+{
+    if (sorted_) {
+	return;
+    }
+    const char *a = arena_.data();
+    auto less = [a](const entry& l, const entry& r) {
+	const int c = memcmp(a + l.offset_, a + r.offset_, std::min(l.size_, r.size_));
+	return c < 0 || (c == 0 && l.size_ < r.size_);
+    };
+    std::sort(words_.begin(), words_.end(), less);
+
+    // merge duplicates and copy the words into a new arena in sorted order
+    std::string arena;
+    std::vector<entry> words;
+    for(const auto& w : words_) {
+	if (! words.empty() && words.back().size_ == w.size_ && memcmp(arena.data() + words.back().offset_, a + w.offset_, w.size_) == 0) {
+	    words.back().count_ += w.count_;
+	    continue;
+	}
+	words.push_back(entry { arena.size(), w.size_, w.count_ });
+	arena.append(a + w.offset_, w.size_);
+    }
+    arena_.swap(arena);
+    words_.swap(words);
+    sorted_ = true;
+}
+
+void
+word_table::keep_most_frequent(size_t n)
+{
+    assert(sorted_);
+    if (words_.size() <= n) {
+	return;
+    }
+    // the index into words_ is the alphabetical order
+    std::vector<size_t> idx(words_.size());
+    for(size_t i = 0; i < idx.size(); ++i) {
+	idx[i] = i;
+    }
+    std::nth_element(idx.begin(), idx.begin() + n, idx.end(), [this](size_t l, size_t r) {
+	    return words_[l].count_ > words_[r].count_ || (words_[l].count_ == words_[r].count_ && l < r);
+	});
+    idx.resize(n);
+    std::sort(idx.begin(), idx.end());
+
+    std::string arena;
+    std::vector<entry> words;
+    words.reserve(n);
+    for(auto i : idx) {
+	const entry& w = words_[i];
+	words.push_back(entry { arena.size(), w.size_, w.count_ });
+	arena.append(arena_, w.offset_, w.size_);
+    }
+    arena_.swap(arena);
+    words_.swap(words);
+}
+
+void
+word_table::clear()
+{
+    arena_.clear();
+    words_.clear();
+    sorted_ = true;
+}
+
+std::pair<size_t, size_t>
+word_table::find_prefix(const std::string& prefix) const
+{
+    assert(sorted_);
+    const char *a = arena_.data();
+    const size_t p = prefix.size();
+    // compare only the first p characters, so all words with the prefix are equal to it
+    auto first = std::lower_bound(words_.begin(), words_.end(), prefix, [a, p](const entry& w, const std::string& s) {
+	    return memcmp(a + w.offset_, s.data(), std::min(w.size_, p)) < 0 || (w.size_ < p && memcmp(a + w.offset_, s.data(), w.size_) == 0);
+	});
+    auto last = std::upper_bound(first, words_.end(), prefix, [a, p](const std::string& s, const entry& w) {
+	    return memcmp(s.data(), a + w.offset_, std::min(w.size_, p)) < 0;
+	});
+    return std::make_pair(first - words_.begin(), last - words_.begin());
+}
+
+namespace {
+    /**
+     * @return the first position at or after p that is not inside a word.
+     * Both chunks next to a boundary compute the same position, so every word is counted once.
+     */
+    const char* word_boundary(const char *b, const char *p, const char *e)
+    {
+	if (p == b) {
+	    return p;
+	}
+	while(p != e && is_word_character(*p)) {
+	    ++p;
+	}
+	return p;
+    }
+
+    /// if t holds more than twice max_words words, keep the max_words most frequent words.
+    void bound(word_table& t, size_t max_words)
+    {
+	if (t.size() > 2 * max_words) {
+	    t.sort();
+	    t.keep_most_frequent(max_words);
 	}
     }
 }
 
+std::shared_ptr<word_table>
+build_vocabulary(const char *b, const char *e, size_t max_words, const std::atomic<bool> *cancel)
+{
+    // each chunk is parsed in blocks to check the memory bound and the cancel flag
+    const size_t block_size = 256 * 1024;
+    const size_t chunk_size = 16 * block_size;
+    const size_t len = e - b;
+    const unsigned chunks = static_cast<unsigned>((len + chunk_size - 1) / chunk_size);
+
+    // a chunk is counted into an accumulator table that is not used by
+    // another chunk at the same time. The following chunks reuse it, so
+    // there are only as many tables as chunks are counted in parallel.
+    std::mutex mtx;
+    std::list<word_table> tables;
+    std::vector<word_table*> idle;
+    parallel_for(chunks, [&](unsigned c) {
+	    word_table *t;
+	    {
+		std::lock_guard<std::mutex> lock(mtx);
+		if (idle.empty()) {
+		    tables.emplace_back();
+		    t = &tables.back();
+		} else {
+		    t = idle.back();
+		    idle.pop_back();
+		}
+	    }
+	    const char *chunk_end = word_boundary(b, b + std::min(len, (c + size_t(1)) * chunk_size), e);
+	    const char *p = word_boundary(b, b + c * chunk_size, e);
+	    while(p < chunk_end && ! (cancel && *cancel)) {
+		const char *block_end = word_boundary(b, p + std::min<size_t>(chunk_end - p, block_size), chunk_end);
+		t->add_words(p, block_end);
+		bound(*t, max_words);
+		p = block_end;
+	    }
+	    std::lock_guard<std::mutex> lock(mtx);
+	    idle.push_back(t);
+	});
+    if (cancel && *cancel) {
+	return nullptr;
+    }
+
+    auto v = std::make_shared<word_table>();
+    for(auto& t : tables) {
+	v->add(t);
+	t.clear();
+	bound(*v, max_words);
+    }
+    v->sort();
+    v->keep_most_frequent(max_words);
+    return v;
+}
+
+namespace {
+    /// the lines whose words are completed.
+    std::vector<std::shared_ptr<const std::string>> word_lines;
+
+    /// the words of word_lines, built when a completion is requested.
+    word_table words;
+
+    /// the words of the whole file.
+    std::shared_ptr<const word_table> vocabulary;
+}
+
+void
+set_vocabulary(std::shared_ptr<const word_table> v)
+{
+    vocabulary = std::move(v);
+}
+
+void
+add_to_word_set(std::shared_ptr<const std::string> line)
+{
+    word_lines.push_back(std::move(line));
+}
+
+void
+add_to_word_set(const std::string& line)
+{
+    add_to_word_set(std::make_shared<const std::string>(line));
+}
+
 void
 clear_word_set()
 {
-    word_set.clear();
+    word_lines.clear();
+    words.clear();
 }
 
-std::set<std::string>
+std::vector<std::string>
 complete_word_set(std::string& word, std::string& err)
 {
-    std::set<std::string> s;
-    if (word.empty()) {
-	s = word_set;
-    } else {
-	for(const auto& w : word_set) {
-	    if (w.find(word) == 0) {
-		s.insert(w);
+    // parse the lines that were added since the last completion
+    if (! word_lines.empty()) {
+	for(const auto& l : word_lines) {
+	    words.add_words(l->data(), l->data() + l->size());
+	}
+	word_lines.clear();
+	words.sort();
+    }
+
+    // the first and last matches of both sorted tables have the longest common prefix of all matches
+    std::set<std::string> ends;
+    // the count and the word of every match
+    std::vector<std::pair<uint64_t, std::string>> matches;
+    auto add_matches = [&](const word_table& t, bool skip_vocabulary) {
+	const auto r = t.find_prefix(word);
+	if (r.first == r.second) {
+	    return;
+	}
+	ends.insert(t.word(r.first));
+	ends.insert(t.word(r.second - 1));
+	// order the indexes of the matches by their count, only the most frequent are returned
+	std::vector<size_t> idx;
+	for(size_t i = r.first; i < r.second; ++i) {
+	    if (skip_vocabulary) {
+		const std::string w = t.word(i);
+		const auto v = vocabulary->find_prefix(w);
+		if (v.first != v.second && vocabulary->word(v.first) == w) {
+		    continue;
+		}
 	    }
+	    idx.push_back(i);
+	}
+	const size_t n = std::min(idx.size(), max_completions);
+	std::partial_sort(idx.begin(), idx.begin() + n, idx.end(), [&t](size_t l, size_t r) {
+		return t.count(l) > t.count(r) || (t.count(l) == t.count(r) && l < r);
+	    });
+	for(size_t i = 0; i < n; ++i) {
+	    matches.push_back(std::make_pair(t.count(idx[i]), t.word(idx[i])));
 	}
+    };
+    if (vocabulary) {
+	add_matches(*vocabulary, false);
+    }
+    // words that are displayed but not in the vocabulary, because it
+    // is still being built or the word is rare
+    add_matches(words, !!vocabulary);
+
+    std::sort(matches.begin(), matches.end(), [](const std::pair<uint64_t, std::string>& l, const std::pair<uint64_t, std::string>& r) {
+	    return l.first > r.first || (l.first == r.first && l.second < r.second);
+	});
+    if (matches.size() > max_completions) {
+	matches.resize(max_completions);
+    }
+    std::vector<std::string> s;
+    for(auto& m : matches) {
+	s.push_back(std::move(m.second));
     }
 
-    complete_longest_prefix(word, s);
+    complete_longest_prefix(word, ends);
     return s;
 }
 
@@ -4,29 +4,130 @@
  */
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <string>
 #include <set>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+/// @return true if c is part of a word.
+bool is_word_character(char c);
 
 /**
- * parse line for words and add to the word set.
- * the words are separated by white space or punctuation characters.
+ * a table of words stored in a single string arena.
+ *
+ * Words are appended unsorted, sort() sorts them and merges duplicates
+ * by adding their counts. A sorted table finds all words with a prefix
+ * by binary search.
  */
+class word_table
+{
+public:
+    struct entry
+    {
+	/// offset of the word in the arena.
+	size_t offset_;
+	size_t size_;
+	/// number of occurrences.
+	uint64_t count_;
+    };
+
+private:
+    std::string arena_;
+    std::vector<entry> words_;
+    bool sorted_;
+
+public:
+    word_table();
+
+    /// append a word.
+    void add(const char *word, size_t len, uint64_t count = 1);
+
+    /**
+     * parse [b..e) for words and append them.
+     * the words are separated by white space or punctuation characters.
+     */
+    void add_words(const char *b, const char *e);
+
+    /// append all words of t with their counts.
+    void add(const word_table& t);
+
+    /// sort the words and merge duplicates.
+    void sort();
+
+    /**
+     * keep only the n most frequent words of a sorted table.
+     * Words with equal counts are kept in alphabetical order.
+     */
+    void keep_most_frequent(size_t n);
+
+    void clear();
+
+    bool sorted() const { return sorted_; }
+    size_t size() const { return words_.size(); }
+    std::string word(size_t i) const { return arena_.substr(words_[i].offset_, words_[i].size_); }
+    uint64_t count(size_t i) const { return words_[i].count_; }
+
+    /**
+     * find the words that start with prefix in a sorted table.
+     * @return the index range [first, last) of the words.
+     */
+    std::pair<size_t, size_t> find_prefix(const std::string& prefix) const;
+};
+
+/**
+ * count the words of [b..e) in parallel chunks.
+ *
+ * The memory is bounded by max_words and the number of worker threads:
+ * every thread counts its chunks into one table, and whenever a table
+ * holds more than twice max_words distinct words, only the max_words
+ * most frequent words are kept. Rare words may therefore be missing
+ * from the vocabulary and their counts may be too low.
+ *
+ * @param cancel if set to true the counting stops early.
+ * @return a sorted table of the most frequent words;
+ *         nullptr if the counting was canceled.
+ */
+std::shared_ptr<word_table> build_vocabulary(const char *b, const char *e, size_t max_words = 1 << 18, const std::atomic<bool> *cancel = nullptr);
+
+/**
+ * set the vocabulary of the whole file.
+ * complete_word_set() completes words from the vocabulary and from the word set.
+ * @param v a sorted table, can be nullptr.
+ */
+void set_vocabulary(std::shared_ptr<const word_table> v);
+
+/**
+ * add the words of line to the word set.
+ * The line is kept and only parsed for words when a completion is requested.
+ */
+void add_to_word_set(std::shared_ptr<const std::string> line);
+
+/// parse line for words and add to the word set.
 void add_to_word_set(const std::string& line);
 
 /// clear the word set
 void clear_word_set();
 
+/// the maximum number of words returned by complete_word_set().
+const size_t max_completions = 100;
+
 /**
- * look up auto completitions from the word set.
+ * look up auto completitions from the word set and the vocabulary.
 
  * @param[in,out] word word that should be completed. The input value
  * is used to look up matches in the word set. The word may be
  * modified to the longest prefix of matches found.
  *
  * @param[out] err error string.
- * @return set of matched words.
+ * @return at most max_completions matched words, the most frequent
+ *         words first. Words of the vocabulary are ordered by their
+ *         count in the whole file, other words by their count in the
+ *         word set.
  */
-std::set<std::string> complete_word_set(std::string& word, std::string& err);
+std::vector<std::string> complete_word_set(std::string& word, std::string& err);
 
 /**
  * look up the longest prefix match of str in s and set str to that prefix.
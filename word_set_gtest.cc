@@ -125,3 +125,170 @@ TEST(word_set, sets_longest_matching_prefix)
     ASSERT_EQ(4u, s.size());
     ASSERT_EQ(std::string("aaa"), word);
 }
+
+TEST(word_set, lines_are_parsed_when_completing)
+{
+    std::string err, word;
+    clear_word_set();
+    add_to_word_set(std::make_shared<const std::string>("alpha beta"));
+    word = "a";
+    auto s = complete_word_set(word, err);
+    ASSERT_EQ(1u, s.size());
+    ASSERT_EQ(std::string("alpha"), word);
+
+    // lines added after a completion are parsed by the next completion
+    add_to_word_set("alphabet");
+    word = "a";
+    s = complete_word_set(word, err);
+    ASSERT_EQ(2u, s.size());
+    ASSERT_EQ(std::string("alpha"), word);
+}
+
+TEST(word_table, sort_merges_duplicates)
+{
+    word_table t;
+    ASSERT_TRUE(t.sorted());
+    const std::string l = "b a-b a_1 b b ab";
+    t.add_words(l.data(), l.data() + l.size());
+    ASSERT_FALSE(t.sorted());
+    ASSERT_EQ(6u, t.size());
+    t.sort();
+    ASSERT_EQ(4u, t.size());
+    ASSERT_EQ(std::string("a-b"), t.word(0));
+    ASSERT_EQ(std::string("a_1"), t.word(1));
+    ASSERT_EQ(std::string("ab"), t.word(2));
+    ASSERT_EQ(std::string("b"), t.word(3));
+    ASSERT_EQ(3u, t.count(3));
+    t.add("b", 1, 5);
+    t.sort();
+    ASSERT_EQ(8u, t.count(3));
+}
+
+TEST(word_table, find_prefix)
+{
+    word_table t;
+    const std::string l = "ab abc abd b ac a bcd";
+    t.add_words(l.data(), l.data() + l.size());
+    t.sort();
+    // a ab abc abd ac b bcd
+    ASSERT_EQ(std::make_pair(size_t(0), size_t(7)), t.find_prefix(""));
+    ASSERT_EQ(std::make_pair(size_t(0), size_t(5)), t.find_prefix("a"));
+    ASSERT_EQ(std::make_pair(size_t(1), size_t(4)), t.find_prefix("ab"));
+    ASSERT_EQ(std::make_pair(size_t(2), size_t(3)), t.find_prefix("abc"));
+    ASSERT_EQ(std::make_pair(size_t(3), size_t(3)), t.find_prefix("abca"));
+    ASSERT_EQ(std::make_pair(size_t(5), size_t(7)), t.find_prefix("b"));
+    ASSERT_EQ(std::make_pair(size_t(7), size_t(7)), t.find_prefix("c"));
+    ASSERT_EQ(std::make_pair(size_t(0), size_t(0)), t.find_prefix("0"));
+}
+
+TEST(word_table, keep_most_frequent)
+{
+    word_table t;
+    const std::string l = "d c c b b b a a e e e";
+    t.add_words(l.data(), l.data() + l.size());
+    t.sort();
+    t.keep_most_frequent(3);
+    // b and e have the same count and are kept in alphabetical order
+    ASSERT_EQ(3u, t.size());
+    ASSERT_TRUE(t.sorted());
+    ASSERT_EQ(std::string("a"), t.word(0));
+    ASSERT_EQ(2u, t.count(0));
+    ASSERT_EQ(std::string("b"), t.word(1));
+    ASSERT_EQ(std::string("e"), t.word(2));
+    ASSERT_EQ(3u, t.count(2));
+    ASSERT_EQ(std::make_pair(size_t(0), size_t(1)), t.find_prefix("a"));
+}
+
+TEST(word_table, add_table)
+{
+    word_table a, b;
+    a.add("x", 1, 2);
+    a.sort();
+    b.add("y", 1);
+    b.add("x", 1, 3);
+    a.add(b);
+    ASSERT_FALSE(a.sorted());
+    a.sort();
+    ASSERT_EQ(2u, a.size());
+    ASSERT_EQ(5u, a.count(0));
+    ASSERT_EQ(std::string("y"), a.word(1));
+}
+
+TEST(vocabulary, counts_words_across_chunks)
+{
+    // a file of several chunks, the words cross the chunk boundaries
+    std::string f;
+    for(unsigned u = 0; u < 600000; ++u) {
+	f += "service" + std::to_string(u % 7) + " error-" + std::to_string(u % 1000) + "\n";
+    }
+    auto v = build_vocabulary(f.data(), f.data() + f.size());
+    ASSERT_TRUE(v != nullptr);
+    ASSERT_TRUE(v->sorted());
+    ASSERT_EQ(1007u, v->size());
+    uint64_t total = 0;
+    for(size_t i = 0; i < v->size(); ++i) {
+	total += v->count(i);
+    }
+    ASSERT_EQ(1200000u, total);
+    auto r = v->find_prefix("service0");
+    ASSERT_EQ(1u, r.second - r.first);
+    ASSERT_EQ(85715u, v->count(r.first));
+}
+
+TEST(vocabulary, is_memory_bounded)
+{
+    std::string f;
+    for(unsigned u = 0; u < 100000; ++u) {
+	f += "frequent rare" + std::to_string(u) + ' ';
+    }
+    auto v = build_vocabulary(f.data(), f.data() + f.size(), 100);
+    ASSERT_EQ(100u, v->size());
+    auto r = v->find_prefix("frequent");
+    ASSERT_EQ(1u, r.second - r.first);
+    ASSERT_EQ(100000u, v->count(r.first));
+}
+
+TEST(vocabulary, can_be_canceled)
+{
+    const std::string f = "a b c";
+    std::atomic<bool> cancel(true);
+    ASSERT_TRUE(build_vocabulary(f.data(), f.data() + f.size(), 100, &cancel) == nullptr);
+    ASSERT_EQ(3u, build_vocabulary(f.data(), f.data() + f.size())->size());
+}
+
+TEST(vocabulary, completes_the_most_frequent_words_first)
+{
+    std::string err, word;
+    clear_word_set();
+    const std::string f = "host-a host-b host-b host-c host-c host-c other";
+    set_vocabulary(build_vocabulary(f.data(), f.data() + f.size()));
+    // a displayed word that is not in the vocabulary is completed as well
+    add_to_word_set("host-d host-b");
+    word = "h";
+    auto s = complete_word_set(word, err);
+    ASSERT_EQ(std::string("host-"), word);
+    ASSERT_EQ(4u, s.size());
+    ASSERT_EQ(std::string("host-c"), s[0]);
+    ASSERT_EQ(std::string("host-b"), s[1]);
+    ASSERT_EQ(std::string("host-a"), s[2]);
+    ASSERT_EQ(std::string("host-d"), s[3]);
+
+    word = "o";
+    s = complete_word_set(word, err);
+    ASSERT_EQ(1u, s.size());
+    ASSERT_EQ(std::string("other"), word);
+
+    // at most max_completions words
+    std::string many;
+    for(unsigned u = 0; u < 1000; ++u) {
+	many += "w" + std::to_string(u) + ' ';
+    }
+    set_vocabulary(build_vocabulary(many.data(), many.data() + many.size()));
+    word = "w";
+    s = complete_word_set(word, err);
+    ASSERT_EQ(max_completions, s.size());
+    ASSERT_EQ(std::string("w"), word);
+
+    set_vocabulary(nullptr);
+    clear_word_set();
+}
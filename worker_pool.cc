@@ -0,0 +1,120 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "worker_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace {
+    /// one call of parallel_for().
+    class job
+    {
+	const std::function<void(unsigned)> f_;
+	const unsigned num_;
+	/// next index to process.
+	std::atomic<unsigned> next_;
+	/// number of finished calls.
+	unsigned done_;
+	std::mutex lock_;
+	std::condition_variable cv_;
+
+    public:
+	job(unsigned num, const std::function<void(unsigned)>& f) : f_(f), num_(num), next_(0), done_(0) {}
+
+	/// process indexes until all are taken.
+	void run()
+	{
+	    unsigned i;
+	    while ((i = next_++) < num_) {
+		f_(i);
+		std::lock_guard<std::mutex> _(lock_);
+		if (++done_ == num_) {
+		    cv_.notify_all();
+		}
+	    }
+	}
+
+	/// wait until all calls have finished.
+	void wait()
+	{
+	    std::unique_lock<std::mutex> l(lock_);
+	    cv_.wait(l, [this]{ return done_ == num_; });
+	}
+    };
+
+    class worker_pool
+    {
+	std::mutex lock_;
+	std::condition_variable cv_;
+	std::deque<std::shared_ptr<job>> q_;
+	unsigned threads_;
+
+	void worker()
+	{
+	    while (true) {
+		std::shared_ptr<job> j;
+		{
+		    std::unique_lock<std::mutex> l(lock_);
+		    cv_.wait(l, [this]{ return ! q_.empty(); });
+		    j = q_.front();
+		    q_.pop_front();
+		}
+		j->run();
+	    }
+	}
+
+    public:
+	worker_pool() : threads_(std::max(1u, std::thread::hardware_concurrency()))
+	{
+	    // the calling thread of parallel_for() is the remaining worker
+	    for(unsigned u = 1; u < threads_; ++u) {
+		std::thread(&worker_pool::worker, this).detach();
+	    }
+	}
+
+	unsigned threads() const { return threads_; }
+
+	/// let n pool threads help with j.
+	void submit(std::shared_ptr<job> j, unsigned n)
+	{
+	    std::lock_guard<std::mutex> _(lock_);
+	    for(unsigned u = 0; u < n; ++u) {
+		q_.push_back(j);
+	    }
+	    cv_.notify_all();
+	}
+    };
+
+    worker_pool& pool()
+    {
+	// the pool threads never terminate, so the pool object is never destroyed.
+	static worker_pool *p = new worker_pool;
+	return *p;
+    }
+}
+
+unsigned worker_threads()
+{
+    return pool().threads();
+}
+
+void parallel_for(unsigned num, const std::function<void(unsigned)>& f)
+{
+    if (num == 0) {
+	return;
+    }
+    if (num == 1) {
+	f(0);
+	return;
+    }
+    auto j = std::make_shared<job>(num, f);
+    pool().submit(j, std::min(num, worker_threads()) - 1);
+    j->run();
+    j->wait();
+}
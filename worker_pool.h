@@ -0,0 +1,17 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#pragma once
+#include <functional>
+
+/// @return the number of threads that execute parallel_for() work, including the calling thread.
+unsigned worker_threads();
+
+/**
+ * call f(i) for all i in [0..num).
+ * The calls are distributed over a pool of background threads and the
+ * calling thread. This function returns when all calls have finished.
+ * parallel_for() can be called from any thread, also from inside f.
+ */
+void parallel_for(unsigned num, const std::function<void(unsigned)>& f);
@@ -0,0 +1,36 @@
+/* -*- mode: C++; c-basic-offset: 4; tab-width: 8; -*-
+ * vi: set shiftwidth=4 tabstop=8:
+ * :indentSize=4:tabSize=8:
+ */
+#include "gtest/gtest.h"
+#include "worker_pool.h"
+#include <atomic>
+#include <vector>
+
+TEST(worker_pool, has_threads)
+{
+    ASSERT_GE(worker_threads(), 1u);
+}
+
+TEST(worker_pool, parallel_for_calls_every_index_once)
+{
+    for(unsigned num : { 0u, 1u, 2u, 7u, 1000u }) {
+	std::vector<std::atomic<unsigned>> calls(num);
+	for(auto& c : calls) {
+	    c = 0;
+	}
+	parallel_for(num, [&calls](unsigned i) { ++calls[i]; });
+	for(auto& c : calls) {
+	    ASSERT_EQ(1u, c);
+	}
+    }
+}
+
+TEST(worker_pool, nested_parallel_for)
+{
+    std::atomic<unsigned> sum(0);
+    parallel_for(8, [&sum](unsigned) {
+	    parallel_for(8, [&sum](unsigned j) { sum += j; });
+	});
+    ASSERT_EQ(8u * 28u, sum);
+}